@@ -0,0 +1,76 @@
+// =============================================================================
+// Created by yangb on 2021/4/21.
+// =============================================================================
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <string>
+#include "benchmark/benchmark.h"
+#include "../src/buffer/buffer.h"
+
+/// @brief 追加不同大小的数据块, 每轮结束后取出全部内容
+static void BM_BufferAppend(benchmark::State& state) {
+  const std::string chunk(state.range(0), 'x');
+  Buffer buff;
+  for (auto _ : state) {
+    for (int i = 0; i < 16; ++i) {
+      buff.Append(chunk);
+    }
+    benchmark::DoNotOptimize(buff.Peek());
+    buff.RetrieveAll();
+  }
+  state.SetBytesProcessed(state.iterations() * 16 * chunk.size());
+}
+BENCHMARK(BM_BufferAppend)->Arg(16)->Arg(128)->Arg(1024)->Arg(16 * 1024);
+
+/// @brief 追加后部分读取, 触发MakeSpace_中的数据搬移
+static void BM_BufferAppendRetrieve(benchmark::State& state) {
+  const std::string chunk(state.range(0), 'x');
+  Buffer buff;
+  for (auto _ : state) {
+    buff.Append(chunk);
+    buff.Retrieve(chunk.size() / 2);
+    if (buff.ReadableBytes() > 64 * 1024) {
+      buff.RetrieveAll();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * chunk.size());
+}
+BENCHMARK(BM_BufferAppendRetrieve)->Arg(64)->Arg(2048);
+
+/// @brief 从socket中读取: 对端每次写入range(0)个字节
+static void BM_BufferReadFd(benchmark::State& state) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+    state.SkipWithError("socketpair failed");
+    return;
+  }
+  int size = 1 << 20;
+  setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+  setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+  const std::string payload(state.range(0), 'x');
+  Buffer buff;
+  int err = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    if (write(fds[0], payload.data(), payload.size()) != static_cast<ssize_t>(payload.size())) {
+      state.SkipWithError("write failed");
+      break;
+    }
+    state.ResumeTiming();
+    size_t left = payload.size();
+    while (left > 0) {
+      ssize_t n = buff.ReadFd(fds[1], &err);
+      if (n <= 0) {
+        break;
+      }
+      left -= n;
+    }
+    buff.RetrieveAll();
+  }
+  state.SetBytesProcessed(state.iterations() * payload.size());
+  close(fds[0]);
+  close(fds[1]);
+}
+BENCHMARK(BM_BufferReadFd)->Arg(512)->Arg(4096)->Arg(128 * 1024);
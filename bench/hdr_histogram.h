@@ -0,0 +1,139 @@
+// =============================================================================
+// Created by yangb on 2021/4/20.
+// Reference: https://github.com/HdrHistogram/HdrHistogram_c
+// 高动态范围(HDR)直方图: 在固定的相对精度下记录延迟分布
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_BENCH_HDR_HISTOGRAM_H_
+#define WEBSERVERCPP11_BENCH_HDR_HISTOGRAM_H_
+
+#include <cassert>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+///
+/// @brief 对数-线性分桶的直方图, 与HdrHistogram的编码方式一致:
+///   [0, sub_bucket_count)           : 每个值一个桶(精确)
+///   [2^k * half, 2^k * sub_count)   : 每个区间再等分成half个子桶
+/// 因此任意值的记录误差不超过 1 / 10^significant_digits.
+///
+class HdrHistogram {
+ public:
+  /// @param highest 可记录的最大值(超出的值按最大值记录)
+  /// @param significant_digits 有效数字位数, 取值范围[1, 5]
+  explicit HdrHistogram(int64_t highest = 3600LL * 1000 * 1000, int significant_digits = 3)
+      : highest_(highest), total_(0), min_(INT64_MAX), max_(0), sum_(0) {
+    assert(highest >= 2);
+    assert(significant_digits >= 1 && significant_digits <= 5);
+    // 子桶数量需能区分 10^digits 个值, 取大于 2 * 10^digits 的2的幂
+    int64_t largest_single_unit = 2 * static_cast<int64_t>(std::pow(10, significant_digits));
+    sub_bucket_bits_ = 1;
+    while ((1LL << sub_bucket_bits_) < largest_single_unit) {
+      ++sub_bucket_bits_;
+    }
+    sub_bucket_count_ = 1LL << sub_bucket_bits_;
+    sub_bucket_half_ = sub_bucket_count_ / 2;
+    counts_.assign(static_cast<size_t>(IndexOf_(highest_) + 1), 0);
+  }
+
+  /// @brief 记录一个值
+  inline void Record(int64_t value, uint64_t count = 1) {
+    if (value < 0) {
+      value = 0;
+    } else if (value > highest_) {
+      value = highest_;
+    }
+    counts_[static_cast<size_t>(IndexOf_(value))] += count;
+    total_ += count;
+    sum_ += static_cast<double>(value) * count;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+
+  /// @brief 合并另一个直方图(两者的参数必须一致)
+  inline void Merge(const HdrHistogram& other) {
+    assert(other.counts_.size() == counts_.size());
+    for (size_t i = 0; i < counts_.size(); ++i) {
+      counts_[i] += other.counts_[i];
+    }
+    total_ += other.total_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+
+  /// @brief 百分位对应的值
+  /// @param percentile 取值范围[0, 100]
+  inline int64_t ValueAtPercentile(double percentile) const {
+    if (total_ == 0) {
+      return 0;
+    }
+    percentile = std::min(std::max(percentile, 0.0), 100.0);
+    auto target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * total_));
+    target = std::max<uint64_t>(target, 1);
+    uint64_t acc = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+      acc += counts_[i];
+      if (acc >= target) {
+        return std::min(HighestEquivalent_(static_cast<int64_t>(i)), max_);
+      }
+    }
+    return max_;
+  }
+
+  inline uint64_t TotalCount() const { return total_; }
+  inline int64_t Min() const { return total_ ? min_ : 0; }
+  inline int64_t Max() const { return max_; }
+  inline double Mean() const { return total_ ? sum_ / total_ : 0.0; }
+
+  inline void Reset() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    total_ = 0;
+    sum_ = 0;
+    min_ = INT64_MAX;
+    max_ = 0;
+  }
+
+ private:
+  /// @brief 最高有效位的位置(从0开始)
+  inline static int Msb_(int64_t v) {
+    return 63 - __builtin_clzll(static_cast<uint64_t>(v) | 1);
+  }
+
+  /// @brief 值 -> 桶下标
+  inline int64_t IndexOf_(int64_t value) const {
+    if (value < sub_bucket_count_) {
+      return value;
+    }
+    int shift = Msb_(value) - sub_bucket_bits_ + 1;
+    int64_t sub = value >> shift; // sub ∈ [half, count)
+    return sub_bucket_count_ + (shift - 1) * sub_bucket_half_ + (sub - sub_bucket_half_);
+  }
+
+  /// @brief 桶下标 -> 该桶能表示的最大值
+  inline int64_t HighestEquivalent_(int64_t index) const {
+    if (index < sub_bucket_count_) {
+      return index;
+    }
+    int64_t offset = index - sub_bucket_count_;
+    int shift = static_cast<int>(offset / sub_bucket_half_) + 1;
+    int64_t sub = offset % sub_bucket_half_ + sub_bucket_half_;
+    return (sub << shift) + (1LL << shift) - 1;
+  }
+
+ private:
+  int64_t highest_;
+  int sub_bucket_bits_;
+  int64_t sub_bucket_count_;
+  int64_t sub_bucket_half_;
+
+  std::vector<uint64_t> counts_;
+  uint64_t total_;
+  int64_t min_;
+  int64_t max_;
+  double sum_;
+};
+
+#endif //WEBSERVERCPP11_BENCH_HDR_HISTOGRAM_H_
@@ -0,0 +1,159 @@
+// =============================================================================
+// Created by yangb on 2021/4/21.
+// =============================================================================
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "../src/http/http_request.h"
+#include "../src/http/http_response.h"
+#include "../src/http/scan.h"
+
+namespace {
+
+/// 抓取自浏览器访问本服务器时的真实请求
+const std::vector<std::string> kRequestCorpus = {  // NOLINT
+    // Chrome 首页
+    "GET / HTTP/1.1\r\n"
+    "Host: 127.0.0.1:12345\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) "
+    "Chrome/89.0.4389.114 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,image/apng,*/*;q=0.8,"
+    "application/signed-exchange;v=b3;q=0.9\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "\r\n",
+    // Chrome 静态资源
+    "GET /css/bootstrap.min.css HTTP/1.1\r\n"
+    "Host: 127.0.0.1:12345\r\n"
+    "Connection: keep-alive\r\n"
+    "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) "
+    "Chrome/89.0.4389.114 Safari/537.36\r\n"
+    "Accept: text/css,*/*;q=0.1\r\n"
+    "Referer: http://127.0.0.1:12345/\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "\r\n",
+    // curl
+    "GET /images/profile-image.jpg HTTP/1.1\r\n"
+    "Host: 127.0.0.1:12345\r\n"
+    "User-Agent: curl/7.68.0\r\n"
+    "Accept: */*\r\n"
+    "\r\n",
+    // 表单提交(不触发数据库校验的路径)
+    "POST /picture HTTP/1.1\r\n"
+    "Host: 127.0.0.1:12345\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Length: 46\r\n"
+    "Content-Type: application/x-www-form-urlencoded\r\n"
+    "Origin: http://127.0.0.1:12345\r\n"
+    "\r\n"
+    "title=test&sub%5B%5D=1&sub%5B%5D=2&name=a+b+c",
+};
+
+/// 全局operator new的调用次数, 用于统计每次解析的内存分配
+std::atomic<int64_t> g_alloc_count{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+  g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+  void* p = malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+/// @brief 解析请求, allocs_per_iter: 预热后每次解析的内存分配次数(HttpRequest的arena复用后应为0)
+static void BM_HttpRequestParse(benchmark::State& state) {
+  const std::string& raw = kRequestCorpus[state.range(0)];
+  Buffer buff;
+  HttpRequest request;
+  for (int i = 0; i < 2; ++i) {  // 预热: arena和字符串的容量
+    buff.Append(raw);
+    request.Init();
+    request.Parse(buff);
+    buff.RetrieveAll();
+  }
+  int64_t allocs = g_alloc_count.load(std::memory_order_relaxed);
+  for (auto _ : state) {
+    buff.Append(raw);
+    request.Init();
+    benchmark::DoNotOptimize(request.Parse(buff));
+    buff.RetrieveAll();
+  }
+  allocs = g_alloc_count.load(std::memory_order_relaxed) - allocs;
+  state.counters["allocs_per_iter"] = benchmark::Counter(static_cast<double>(allocs) / state.iterations());
+  state.SetBytesProcessed(state.iterations() * raw.size());
+}
+BENCHMARK(BM_HttpRequestParse)->DenseRange(0, static_cast<int>(kRequestCorpus.size()) - 1);
+
+/// @brief 生成响应(状态行, 头部, mmap文件)
+static void BM_HttpResponseMakeResponse(benchmark::State& state) {
+  static const char* kPaths[] = {"/index.html", "/css/bootstrap.min.css", "/images/profile-image.jpg", "/nope.html"};
+  std::string path = kPaths[state.range(0)];
+  Buffer buff;
+  HttpResponse response;
+  for (auto _ : state) {
+    response.Init(WEBSERVER_RESOURCES_DIR, path, true, 200);
+    response.MakeResponse(buff);
+    benchmark::DoNotOptimize(response.File());
+    buff.RetrieveAll();
+    response.UnmapFile();
+  }
+  state.SetLabel(path);
+}
+BENCHMARK(BM_HttpResponseMakeResponse)->DenseRange(0, 3);
+
+/// @brief 查找请求头结束位置, range(0): Scan::Kernel
+static void BM_ScanHeaderEnd(benchmark::State& state) {
+  Scan::Kernel kernel = static_cast<Scan::Kernel>(state.range(0));
+  if (!Scan::Use(kernel)) {
+    state.SkipWithError("kernel not supported");
+    return;
+  }
+  const std::string& raw = kRequestCorpus[0];
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Scan::FindHeaderEnd(raw.data(), raw.data() + raw.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * raw.size());
+  state.SetLabel(Scan::Name(kernel));
+}
+BENCHMARK(BM_ScanHeaderEnd)->DenseRange(Scan::SCALAR, Scan::AVX2);
+
+/// @brief 表单的URL解码, range(0): Scan::Kernel, range(1): 0 转义密集(中文), 1 转义稀疏(英文)
+static void BM_ScanUrlDecode(benchmark::State& state) {
+  static const char* kForms[] = {
+      "username=%E5%BC%A0%E4%B8%89&comment=%E4%BD%A0%E5%A5%BD%EF%BC%8C%E4%B8%96%E7%95%8C",
+      "username=zhangsan&password=abcdefgh12345678&comment=this+is+a+fairly+long+comment+"
+      "from+the+register+form%2C+mostly+plain+ascii+with+only+a+few+escaped+characters",
+  };
+  Scan::Kernel kernel = static_cast<Scan::Kernel>(state.range(0));
+  if (!Scan::Use(kernel)) {
+    state.SkipWithError("kernel not supported");
+    return;
+  }
+  const std::string form = kForms[state.range(1)];
+  std::string out(form.size(), '\0');
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Scan::UrlDecode(form.data(), form.size(), &out[0]));
+  }
+  state.SetBytesProcessed(state.iterations() * form.size());
+  state.SetLabel(Scan::Name(kernel));
+}
+BENCHMARK(BM_ScanUrlDecode)->ArgsProduct({{Scan::SCALAR, Scan::SSE42, Scan::AVX2}, {0, 1}});
@@ -0,0 +1,624 @@
+// =============================================================================
+// Created by yangb on 2021/4/20.
+// 基于epoll的HTTP压测工具
+//   - 闭环(closed-loop): 每个连接上始终保持pipeline个在途请求, 测量最大吞吐;
+//   - 开环(open-loop): 以固定速率(-r)发出请求, 延迟从"计划发送时刻"算起,
+//     避免协调遗漏(coordinated omission)低估尾延迟.
+// 用法示例:
+//   ./bench -c 64 -d 10 -P 1 -R ./resources
+//   ./bench -c 64 -d 10 -r 20000 --server ./WebServerCpp11Src --root /path/to/repo
+// =============================================================================
+
+#include <getopt.h>
+#include <ftw.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cctype>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hdr_histogram.h"
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+
+inline int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(SteadyClock::now().time_since_epoch()).count();
+}
+
+struct Options {
+  std::string host = "127.0.0.1";
+  int port = 12345;
+  int connections = 64;
+  int threads = 1;
+  int duration_s = 10;
+  int warmup_s = 1;
+  bool keep_alive = true;
+  int pipeline = 1;           // 每个连接上的在途请求数
+  double rate = 0;            // 总请求速率(req/s), 0: 闭环
+  std::string resources = "./resources";
+  std::vector<std::string> paths;  // 显式指定的路径, 为空则遍历resources
+  std::string server;         // 需要在本地启动的服务器程序
+  std::string root = ".";     // 服务器的工作目录(需包含resources/)
+  unsigned seed = 1;
+};
+
+/// @brief 单个线程的统计数据
+struct Stats {
+  Stats() : latency_us(60LL * 1000 * 1000, 3) {}
+
+  HdrHistogram latency_us;
+  uint64_t completed = 0;
+  uint64_t errors = 0;
+  uint64_t connects = 0;
+  uint64_t bytes_read = 0;
+  uint64_t backlog = 0;       // 开环模式下结束时仍未发出的请求数
+  std::map<int, uint64_t> status;
+
+  void Merge(const Stats& other) {
+    latency_us.Merge(other.latency_us);
+    completed += other.completed;
+    errors += other.errors;
+    connects += other.connects;
+    bytes_read += other.bytes_read;
+    backlog += other.backlog;
+    for (const auto& item : other.status) {
+      status[item.first] += item.second;
+    }
+  }
+};
+
+struct Connection {
+  int fd = -1;
+  bool connected = false;
+  std::string out;
+  size_t out_offset = 0;
+  std::string in;
+  std::deque<int64_t> inflight; // 每个在途请求的开始时间(ns)
+
+  // 响应解析状态
+  bool in_body = false;
+  size_t body_left = 0;
+  int status = 0;
+  bool server_close = false;
+};
+
+std::vector<std::string> g_request_paths;  // NOLINT
+std::atomic<bool> g_stop{false};
+
+int CollectFile_(const char* path, const struct stat* sb, int type, struct FTW*) {
+  (void)sb;
+  if (type == FTW_F) {
+    g_request_paths.emplace_back(path);
+  }
+  return 0;
+}
+
+/// @brief 遍历资源目录, 生成请求路径列表(相对于资源目录)
+bool LoadRequestPaths(const Options& opt) {
+  if (!opt.paths.empty()) {
+    g_request_paths = opt.paths;
+    return true;
+  }
+  if (nftw(opt.resources.c_str(), CollectFile_, 16, FTW_PHYS) != 0) {
+    fprintf(stderr, "Walk resources dir %s failed: %s\n", opt.resources.c_str(), strerror(errno));
+    return false;
+  }
+  std::string prefix = opt.resources;
+  while (!prefix.empty() && prefix.back() == '/') {
+    prefix.pop_back();
+  }
+  for (auto& p : g_request_paths) {
+    p = p.substr(prefix.size());
+  }
+  std::sort(g_request_paths.begin(), g_request_paths.end());
+  return !g_request_paths.empty();
+}
+
+/// @brief 大小写不敏感地查找头部, 返回值的起始位置
+const char* FindHeader(const char* begin, const char* end, const char* name) {
+  size_t n = strlen(name);
+  for (const char* p = begin; p + n < end; ++p) {
+    if ((p == begin || p[-1] == '\n') && strncasecmp(p, name, n) == 0 && p[n] == ':') {
+      p += n + 1;
+      while (p < end && (*p == ' ' || *p == '\t')) {
+        ++p;
+      }
+      return p;
+    }
+  }
+  return nullptr;
+}
+
+class Worker {
+ public:
+  Worker(const Options& opt, int id, int conn_num, double rate)
+      : opt_(opt), rng_(opt.seed + id), conns_(conn_num), rate_(rate) {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    memset(&addr_, 0, sizeof(addr_));
+    addr_.sin_family = AF_INET;
+    addr_.sin_port = htons(opt.port);
+    inet_pton(AF_INET, opt.host.c_str(), &addr_.sin_addr);
+  }
+
+  ~Worker() {
+    for (auto& c : conns_) {
+      if (c.fd >= 0) {
+        close(c.fd);
+      }
+    }
+    close(epoll_fd_);
+  }
+
+  void Run(int64_t start_ns, int64_t measure_ns, int64_t end_ns) {
+    measure_ns_ = measure_ns;
+    next_send_ns_ = start_ns;
+    interval_ns_ = rate_ > 0 ? static_cast<int64_t>(1e9 / rate_) : 0;
+    for (auto& c : conns_) {
+      Connect_(c);
+    }
+
+    std::vector<epoll_event> events(256);
+    while (!g_stop) {
+      int64_t now = NowNs();
+      if (now >= end_ns) {
+        break;
+      }
+      if (interval_ns_ > 0) {
+        Schedule_(now);
+      }
+      int timeout_ms = 100;
+      if (interval_ns_ > 0) {
+        timeout_ms = static_cast<int>(std::max<int64_t>(0, (next_send_ns_ - now) / 1000000));
+      }
+      int n = epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), timeout_ms);
+      for (int i = 0; i < n; ++i) {
+        auto& c = conns_[events[i].data.u32];
+        uint32_t ev = events[i].events;
+        if (ev & (EPOLLERR | EPOLLHUP)) {
+          Fail_(c);
+          continue;
+        }
+        if ((ev & EPOLLOUT) && !OnWritable_(c)) {
+          continue;
+        }
+        if (ev & EPOLLIN) {
+          OnReadable_(c);
+        }
+      }
+    }
+    stats_.backlog = pending_.size();
+  }
+
+  const Stats& GetStats() const { return stats_; }
+
+ private:
+  const std::string& NextPath_() {
+    std::uniform_int_distribution<size_t> dist(0, g_request_paths.size() - 1);
+    return g_request_paths[dist(rng_)];
+  }
+
+  void Connect_(Connection& c) {
+    c = Connection();
+    c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c.fd < 0) {
+      ++stats_.errors;
+      return;
+    }
+    int one = 1;
+    setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    int ret = connect(c.fd, reinterpret_cast<sockaddr*>(&addr_), sizeof(addr_));
+    if (ret < 0 && errno != EINPROGRESS) {
+      ++stats_.errors;
+      close(c.fd);
+      c.fd = -1;
+      return;
+    }
+    ++stats_.connects;
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.u32 = static_cast<uint32_t>(&c - &conns_[0]);
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, c.fd, &ev);
+  }
+
+  void Reconnect_(Connection& c) {
+    if (c.fd >= 0) {
+      epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, c.fd, nullptr);
+      close(c.fd);
+    }
+    Connect_(c);
+  }
+
+  /// @brief 出错: 在途请求全部计为失败, 然后重连
+  void Fail_(Connection& c) {
+    stats_.errors += std::max<size_t>(1, c.inflight.size());
+    Reconnect_(c);
+  }
+
+  size_t Capacity_() const {
+    return opt_.keep_alive ? static_cast<size_t>(opt_.pipeline) : 1;
+  }
+
+  void Enqueue_(Connection& c, int64_t start_ns) {
+    c.out += "GET " + NextPath_() + " HTTP/1.1\r\nHost: " + opt_.host + "\r\n";
+    c.out += opt_.keep_alive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+    c.inflight.push_back(start_ns);
+  }
+
+  /// @brief 闭环模式下补满在途请求; 开环模式下从待发队列中取请求
+  void Fill_(Connection& c) {
+    if (c.fd < 0 || !c.connected) {
+      return;
+    }
+    while (c.inflight.size() < Capacity_()) {
+      if (interval_ns_ > 0) {
+        if (pending_.empty()) {
+          break;
+        }
+        Enqueue_(c, pending_.front());
+        pending_.pop_front();
+      } else {
+        Enqueue_(c, NowNs());
+      }
+    }
+    Flush_(c);
+  }
+
+  /// @brief 开环模式: 把到期的计划请求放进待发队列, 再分配给空闲连接
+  void Schedule_(int64_t now) {
+    while (next_send_ns_ <= now) {
+      pending_.push_back(next_send_ns_);
+      next_send_ns_ += interval_ns_;
+    }
+    for (auto& c : conns_) {
+      if (pending_.empty()) {
+        break;
+      }
+      Fill_(c);
+    }
+  }
+
+  bool Flush_(Connection& c) {
+    while (c.out_offset < c.out.size()) {
+      ssize_t n = send(c.fd, c.out.data() + c.out_offset, c.out.size() - c.out_offset, MSG_NOSIGNAL);
+      if (n < 0) {
+        if (errno == EAGAIN) {
+          return true;
+        }
+        Fail_(c);
+        return false;
+      }
+      c.out_offset += n;
+    }
+    c.out.clear();
+    c.out_offset = 0;
+    return true;
+  }
+
+  bool OnWritable_(Connection& c) {
+    if (!c.connected) {
+      int err = 0;
+      socklen_t len = sizeof(err);
+      getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+      if (err != 0) {
+        Fail_(c);
+        return false;
+      }
+      c.connected = true;
+      epoll_event ev{};
+      ev.events = EPOLLIN;
+      ev.data.u32 = static_cast<uint32_t>(&c - &conns_[0]);
+      epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, c.fd, &ev);
+      Fill_(c);
+      return c.fd >= 0;
+    }
+    return Flush_(c);
+  }
+
+  void OnReadable_(Connection& c) {
+    char buff[65536];
+    while (true) {
+      ssize_t n = recv(c.fd, buff, sizeof(buff), 0);
+      if (n > 0) {
+        stats_.bytes_read += n;
+        c.in.append(buff, n);
+        continue;
+      }
+      if (n < 0 && errno == EAGAIN) {
+        break;
+      }
+      // 对端关闭 or 出错
+      if (!c.inflight.empty() || n < 0) {
+        if (!ParseResponses_(c)) {
+          return;
+        }
+        if (!c.inflight.empty()) {
+          Fail_(c);
+          return;
+        }
+      }
+      Reconnect_(c);
+      Fill_(c);
+      return;
+    }
+    if (!ParseResponses_(c)) {
+      return;
+    }
+    Fill_(c);
+  }
+
+  /// @brief 解析收到的所有完整响应
+  /// @return false: 连接已被重建
+  bool ParseResponses_(Connection& c) {
+    size_t pos = 0;
+    while (true) {
+      if (!c.in_body) {
+        size_t header_end = c.in.find("\r\n\r\n", pos);
+        if (header_end == std::string::npos) {
+          break;
+        }
+        const char* begin = c.in.data() + pos;
+        const char* end = c.in.data() + header_end + 2;
+        c.status = 0;
+        if (end - begin > 12 && strncmp(begin, "HTTP/1.", 7) == 0) {
+          c.status = atoi(begin + 9);
+        }
+        const char* len = FindHeader(begin, end, "Content-Length");
+        c.body_left = len ? strtoul(len, nullptr, 10) : 0;
+        const char* conn = FindHeader(begin, end, "Connection");
+        c.server_close = conn && strncasecmp(conn, "close", 5) == 0;
+        c.in_body = true;
+        pos = header_end + 4;
+      }
+      size_t take = std::min(c.body_left, c.in.size() - pos);
+      c.body_left -= take;
+      pos += take;
+      if (c.body_left > 0) {
+        break;
+      }
+      c.in_body = false;
+      if (!OnResponse_(c)) {
+        return false;
+      }
+    }
+    c.in.erase(0, pos);
+    return true;
+  }
+
+  bool OnResponse_(Connection& c) {
+    if (c.inflight.empty()) { // 多余的响应
+      ++stats_.errors;
+      return true;
+    }
+    int64_t start = c.inflight.front();
+    c.inflight.pop_front();
+    int64_t now = NowNs();
+    if (start >= measure_ns_) {
+      ++stats_.completed;
+      ++stats_.status[c.status];
+      stats_.latency_us.Record((now - start) / 1000);
+    }
+    if (c.server_close || !opt_.keep_alive) {
+      stats_.errors += c.inflight.size();
+      Reconnect_(c);
+      Fill_(c);
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  const Options& opt_;
+  std::mt19937 rng_;
+  std::vector<Connection> conns_;
+  double rate_;
+  int epoll_fd_;
+  sockaddr_in addr_{};
+
+  int64_t measure_ns_ = 0;
+  int64_t next_send_ns_ = 0;
+  int64_t interval_ns_ = 0;
+  std::deque<int64_t> pending_;
+
+  Stats stats_;
+};
+
+void Usage(const char* prog) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  -H, --host HOST         server address (default 127.0.0.1)\n"
+          "  -p, --port PORT         server port (default 12345)\n"
+          "  -c, --connections N     concurrent connections (default 64)\n"
+          "  -t, --threads N         load generator threads (default 1)\n"
+          "  -d, --duration SEC      measured duration (default 10)\n"
+          "  -w, --warmup SEC        warmup, not measured (default 1)\n"
+          "  -P, --pipeline N        in-flight requests per connection (default 1)\n"
+          "  -r, --rate REQ/S        open-loop request rate, 0 for closed loop (default 0)\n"
+          "  -C, --close             disable keep-alive (one request per connection)\n"
+          "  -R, --resources DIR     request mix: all files under DIR (default ./resources)\n"
+          "  -u, --path PATH         request PATH instead (repeatable)\n"
+          "  -s, --server BIN        start BIN locally before the run, stop it afterwards\n"
+          "      --root DIR          working directory for --server (default .)\n"
+          "      --seed N            random seed of the request mix (default 1)\n",
+          prog);
+}
+
+bool ParseOptions(int argc, char** argv, Options* opt) {
+  static const struct option kLongOpts[] = {
+      {"host", required_argument, nullptr, 'H'},
+      {"port", required_argument, nullptr, 'p'},
+      {"connections", required_argument, nullptr, 'c'},
+      {"threads", required_argument, nullptr, 't'},
+      {"duration", required_argument, nullptr, 'd'},
+      {"warmup", required_argument, nullptr, 'w'},
+      {"pipeline", required_argument, nullptr, 'P'},
+      {"rate", required_argument, nullptr, 'r'},
+      {"close", no_argument, nullptr, 'C'},
+      {"resources", required_argument, nullptr, 'R'},
+      {"path", required_argument, nullptr, 'u'},
+      {"server", required_argument, nullptr, 's'},
+      {"root", required_argument, nullptr, 1},
+      {"seed", required_argument, nullptr, 2},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int ch;
+  while ((ch = getopt_long(argc, argv, "H:p:c:t:d:w:P:r:CR:u:s:h", kLongOpts, nullptr)) != -1) {
+    switch (ch) {
+      case 'H': opt->host = optarg; break;
+      case 'p': opt->port = atoi(optarg); break;
+      case 'c': opt->connections = atoi(optarg); break;
+      case 't': opt->threads = atoi(optarg); break;
+      case 'd': opt->duration_s = atoi(optarg); break;
+      case 'w': opt->warmup_s = atoi(optarg); break;
+      case 'P': opt->pipeline = atoi(optarg); break;
+      case 'r': opt->rate = atof(optarg); break;
+      case 'C': opt->keep_alive = false; break;
+      case 'R': opt->resources = optarg; break;
+      case 'u': opt->paths.emplace_back(optarg); break;
+      case 's': opt->server = optarg; break;
+      case 1: opt->root = optarg; break;
+      case 2: opt->seed = static_cast<unsigned>(atoi(optarg)); break;
+      default: return false;
+    }
+  }
+  return opt->connections > 0 && opt->threads > 0 && opt->threads <= opt->connections
+      && opt->duration_s > 0 && opt->warmup_s >= 0 && opt->pipeline > 0 && opt->rate >= 0;
+}
+
+/// @brief 等待服务器端口可连接
+bool WaitForServer(const Options& opt, int timeout_ms) {
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(opt.port);
+  inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+  for (int waited = 0; waited < timeout_ms; waited += 50) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int ret = connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    close(fd);
+    if (ret == 0) {
+      return true;
+    }
+    usleep(50 * 1000);
+  }
+  return false;
+}
+
+pid_t StartServer(const Options& opt) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    if (chdir(opt.root.c_str()) < 0) {
+      _exit(127);
+    }
+    execl(opt.server.c_str(), opt.server.c_str(), static_cast<char*>(nullptr));
+    _exit(127);
+  }
+  return pid;
+}
+
+void PrintReport(const Options& opt, const Stats& s, double seconds) {
+  const auto& h = s.latency_us;
+  printf("Target:      %s:%d, %zu paths, %s\n", opt.host.c_str(), opt.port, g_request_paths.size(),
+         opt.rate > 0 ? "open loop" : "closed loop");
+  printf("Config:      %d connections, %d threads, pipeline %d, keep-alive %s\n",
+         opt.connections, opt.threads, opt.pipeline, opt.keep_alive ? "on" : "off");
+  printf("Requests:    %llu in %.2fs, %llu errors, %llu connects",
+         static_cast<unsigned long long>(s.completed), seconds,
+         static_cast<unsigned long long>(s.errors), static_cast<unsigned long long>(s.connects));
+  if (opt.rate > 0) {
+    printf(", %llu unsent", static_cast<unsigned long long>(s.backlog));
+  }
+  printf("\n");
+  printf("Throughput:  %.1f req/s, %.2f MB/s\n", s.completed / seconds, s.bytes_read / seconds / (1 << 20));
+  printf("Latency(us): min %lld, mean %.1f, max %lld\n",
+         static_cast<long long>(h.Min()), h.Mean(), static_cast<long long>(h.Max()));
+  const double kPercentiles[] = {50, 75, 90, 99, 99.9, 99.99};
+  for (double p : kPercentiles) {
+    printf("  p%-7g %lld\n", p, static_cast<long long>(h.ValueAtPercentile(p)));
+  }
+  printf("Status:");
+  for (const auto& item : s.status) {
+    printf(" %d=%llu", item.first, static_cast<unsigned long long>(item.second));
+  }
+  printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!ParseOptions(argc, argv, &opt)) {
+    Usage(argv[0]);
+    return 1;
+  }
+  if (!LoadRequestPaths(opt)) {
+    fprintf(stderr, "No request paths!\n");
+    return 1;
+  }
+  signal(SIGPIPE, SIG_IGN);
+
+  pid_t server_pid = -1;
+  if (!opt.server.empty()) {
+    server_pid = StartServer(opt);
+    if (server_pid < 0 || !WaitForServer(opt, 5000)) {
+      fprintf(stderr, "Start server %s failed!\n", opt.server.c_str());
+      if (server_pid > 0) {
+        kill(server_pid, SIGTERM);
+        waitpid(server_pid, nullptr, 0);
+      }
+      return 1;
+    }
+  }
+
+  int64_t start = NowNs();
+  int64_t measure = start + opt.warmup_s * 1000000000LL;
+  int64_t end = measure + opt.duration_s * 1000000000LL;
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < opt.threads; ++i) {
+    int conn_num = opt.connections / opt.threads + (i < opt.connections % opt.threads ? 1 : 0);
+    workers.emplace_back(new Worker(opt, i, conn_num, opt.rate / opt.threads));
+  }
+  for (auto& w : workers) {
+    Worker* worker = w.get();
+    threads.emplace_back([worker, start, measure, end] { worker->Run(start, measure, end); });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  Stats total;
+  for (const auto& w : workers) {
+    total.Merge(w->GetStats());
+  }
+  PrintReport(opt, total, (end - measure) / 1e9);
+
+  if (server_pid > 0) {
+    kill(server_pid, SIGTERM);
+    waitpid(server_pid, nullptr, 0);
+  }
+  return 0;
+}
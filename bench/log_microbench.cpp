@@ -0,0 +1,18 @@
+// =============================================================================
+// Created by yangb on 2021/4/21.
+// =============================================================================
+
+#include "benchmark/benchmark.h"
+#include "../src/log/log.h"
+
+/// @brief 异步日志, 多线程同时写入一条典型的连接日志
+static void BM_LogWrite(benchmark::State& state) {
+  static bool inited = (Log::Instance()->Init(1, "/tmp/webserver_microbench_log", ".log", 1024), true);
+  benchmark::DoNotOptimize(inited);
+  int fd = 10 + state.thread_index();
+  for (auto _ : state) {
+    LOG_INFO("Client[%d](%s:%d) in, user count: %d", fd, "127.0.0.1", 52314, 128);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LogWrite)->ThreadRange(1, 4)->UseRealTime();
@@ -0,0 +1,38 @@
+// =============================================================================
+// Created by yangb on 2021/4/21.
+// =============================================================================
+
+#include <atomic>
+#include <thread>
+#include "benchmark/benchmark.h"
+#include "../src/pool/thread_pool.h"
+
+namespace {
+
+std::atomic<int64_t> g_done{0};
+
+ThreadPool& Pool() {
+  static ThreadPool pool(6); // 与main.cpp中的线程数一致
+  return pool;
+}
+
+} // namespace
+
+/// @brief 多个生产者同时提交空任务, 衡量队列锁竞争
+static void BM_ThreadPoolAddTask(benchmark::State& state) {
+  ThreadPool& pool = Pool();
+  int64_t submitted = 0;
+  for (auto _ : state) {
+    pool.AddTask([] { g_done.fetch_add(1, std::memory_order_relaxed); });
+    ++submitted;
+  }
+  state.SetItemsProcessed(submitted);
+  if (state.thread_index() == 0) {
+    // 计时已结束, 等待所有任务执行完, 避免积压影响下一组测试
+    while (g_done.load() < static_cast<int64_t>(state.iterations()) * state.threads()) {
+      std::this_thread::yield();
+    }
+    g_done = 0;
+  }
+}
+BENCHMARK(BM_ThreadPoolAddTask)->ThreadRange(1, 8)->UseRealTime();
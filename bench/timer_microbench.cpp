@@ -0,0 +1,59 @@
+// =============================================================================
+// Created by yangb on 2021/4/21.
+// =============================================================================
+
+#include <random>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "../src/timer/heap_timer.h"
+
+/// @brief 向已有range(0)个定时器的堆中添加新定时器
+static void BM_HeapTimerAdd(benchmark::State& state) {
+  const int n = static_cast<int>(state.range(0));
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> timeout(1000, 60000);
+  for (auto _ : state) {
+    state.PauseTiming();
+    HeapTimer timer(n);
+    state.ResumeTiming();
+    for (int i = 0; i < n; ++i) {
+      timer.Add(i, timeout(rng), [] {});
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_HeapTimerAdd)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+/// @brief 在range(0)个定时器中随机延长超时时间(对应每次读写事件的ExtentTime_)
+static void BM_HeapTimerAdjust(benchmark::State& state) {
+  const int n = static_cast<int>(state.range(0));
+  HeapTimer timer(n);
+  for (int i = 0; i < n; ++i) {
+    timer.Add(i, 60000, [] {});
+  }
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> id(0, n - 1);
+  for (auto _ : state) {
+    timer.Adjust(id(rng), 60000);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HeapTimerAdjust)->Arg(10000)->Arg(100000)->Arg(1000000);
+
+/// @brief 所有定时器均已超时, 一次Tick清空range(0)个定时器
+static void BM_HeapTimerTick(benchmark::State& state) {
+  const int n = static_cast<int>(state.range(0));
+  int64_t expired = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    HeapTimer timer(n);
+    for (int i = 0; i < n; ++i) {
+      timer.Add(i, 0, [&expired] { ++expired; });
+    }
+    state.ResumeTiming();
+    timer.Tick();
+  }
+  benchmark::DoNotOptimize(expired);
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_HeapTimerTick)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
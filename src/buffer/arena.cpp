@@ -0,0 +1,80 @@
+// =============================================================================
+// Created by yangb on 2021/4/28.
+// =============================================================================
+
+#include <cstdlib>
+#include "arena.h"
+
+Arena::Arena(size_t block_size)
+    : block_size_(block_size), capacity_(0), head_(nullptr), current_(nullptr), ptr_(nullptr), end_(nullptr) {}
+
+Arena::~Arena() {
+  FreeBlocks_(head_);
+}
+
+void Arena::Reset() {
+  if (!head_) {
+    return;
+  }
+  if (capacity_ > kMaxRetained) {
+    FreeBlocks_(head_->next);
+    head_->next = nullptr;
+    capacity_ = head_->size;
+  }
+  Use_(head_);
+}
+
+void* Arena::AllocateSlow_(size_t size, size_t align) {
+  // 先使用Reset前保留下来的块, 放不下的块本轮跳过
+  Block* prev = current_;
+  Block* block = current_ ? current_->next : head_;
+  while (block && block->size < size + align) {
+    prev = block;
+    block = block->next;
+  }
+
+  if (!block) {
+    size_t data_size = size + align > block_size_ ? size + align : block_size_;
+    block = static_cast<Block*>(malloc(sizeof(Block) + data_size));
+    if (!block) {
+      throw std::bad_alloc();
+    }
+    block->size = data_size;
+    capacity_ += data_size;
+    // 插在current_之后, 保留的块留在后面
+    if (current_) {
+      block->next = current_->next;
+      current_->next = block;
+    } else {
+      block->next = head_;
+      head_ = block;
+    }
+  } else if (prev != current_) {
+    // 把找到的块移到current_之后, 跳过的块留到下一轮
+    prev->next = block->next;
+    if (current_) {
+      block->next = current_->next;
+      current_->next = block;
+    } else {
+      block->next = head_;
+      head_ = block;
+    }
+  }
+
+  Use_(block);
+  return Allocate(size, align);
+}
+
+void Arena::Use_(Block* block) {
+  current_ = block;
+  ptr_ = reinterpret_cast<char*>(block + 1);
+  end_ = ptr_ + block->size;
+}
+
+void Arena::FreeBlocks_(Block* block) {
+  while (block) {
+    Block* next = block->next;
+    free(block);
+    block = next;
+  }
+}
@@ -0,0 +1,133 @@
+// =============================================================================
+// Created by yangb on 2021/4/28.
+// 单调内存池(arena)和对应的STL分配器
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_BUFFER_ARENA_H_
+#define WEBSERVERCPP11_SRC_BUFFER_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <type_traits>
+
+///
+/// @brief 单调内存池: 分配只移动指针, 释放是空操作, Reset一次性回收所有分配
+/// 内存块在Reset后保留下来给下一次使用, 预热之后不再调用malloc;
+/// 保留的总大小超过kMaxRetained时(偶尔的超大请求)只保留第一个块.
+/// 不是线程安全的, 每个连接(HttpRequest)一个.
+///
+class Arena {
+ public:
+  /// Reset后最多保留的内存, 单位: 字节
+  static const size_t kMaxRetained = 64 * 1024;
+
+  explicit Arena(size_t block_size = 4096);
+
+  ~Arena();
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  /// @brief 分配size字节, 按align对齐
+  inline void* Allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+    uintptr_t p = (reinterpret_cast<uintptr_t>(ptr_) + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+    if (ptr_ && p + size <= reinterpret_cast<uintptr_t>(end_)) {
+      ptr_ = reinterpret_cast<char*>(p + size);
+      return reinterpret_cast<void*>(p);
+    }
+    return AllocateSlow_(size, align);
+  }
+
+  /// @brief 回收所有分配, 之前分配的内存都不能再使用
+  void Reset();
+
+  /// @brief 持有的内存块的总大小
+  inline size_t Capacity() const { return capacity_; }
+
+ private:
+  struct Block {
+    Block* next;
+    size_t size;  // 数据部分的大小, 数据紧跟在Block之后
+  };
+
+  void* AllocateSlow_(size_t size, size_t align);
+
+  /// @brief 从block的开头分配
+  void Use_(Block* block);
+
+  void FreeBlocks_(Block* block);
+
+ private:
+  size_t block_size_;
+  size_t capacity_;
+  Block* head_;     // 第一个块
+  Block* current_;  // 正在分配的块, 之后的块是Reset前保留下来的
+  char* ptr_;
+  char* end_;
+};
+
+///
+/// @brief 从Arena分配的STL分配器, deallocate是空操作
+/// arena为nullptr时(默认构造, 如查找用的临时字符串)退回operator new/delete.
+///
+template <typename T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+  typedef std::true_type propagate_on_container_copy_assignment;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  ArenaAllocator() noexcept : arena_(nullptr) {}
+
+  explicit ArenaAllocator(Arena* arena) noexcept : arena_(arena) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.GetArena()) {}
+
+  inline T* allocate(size_t n) {
+    if (arena_) {
+      return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  inline void deallocate(T* p, size_t) noexcept {
+    if (!arena_) {
+      ::operator delete(p);
+    }
+  }
+
+  inline Arena* GetArena() const noexcept { return arena_; }
+
+ private:
+  Arena* arena_;
+};
+
+template <typename T, typename U>
+inline bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept {
+  return a.GetArena() == b.GetArena();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept {
+  return !(a == b);
+}
+
+/// 从Arena分配的字符串
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>> ArenaString;
+
+/// @brief ArenaString的哈希(FNV-1a)
+struct ArenaStringHash {
+  inline size_t operator()(const ArenaString& str) const noexcept {
+    uint64_t hash = 14695981039346656037ULL;
+    for (char ch : str) {
+      hash = (hash ^ static_cast<unsigned char>(ch)) * 1099511628211ULL;
+    }
+    return static_cast<size_t>(hash);
+  }
+};
+
+#endif //WEBSERVERCPP11_SRC_BUFFER_ARENA_H_
@@ -2,61 +2,24 @@
 // Created by yangb on 2021/4/1.
 // =============================================================================
 
+#include <algorithm>
 #include <cassert>
-#include <cstring>  // bzero
-#include <unistd.h> // write
-#include <sys/uio.h>  // iovec, readv
+#include <unistd.h> // read, write
 #include "buffer.h"
 
-Buffer::Buffer(int _buffer_size) : buffer_(_buffer_size), read_pos_(0), write_pos_(0) {
+const size_t Buffer::kCheapPrepend;
+const size_t Buffer::kMinReadSize;
+const size_t Buffer::kMaxReadSize;
+
+Buffer::Buffer(int _buffer_size)
+    : buffer_(kCheapPrepend + _buffer_size), read_pos_(kCheapPrepend), write_pos_(kCheapPrepend),
+      read_size_(kMinReadSize)
+#ifdef WEBSERVER_BUFFER_CHECKED
+      , owner_(std::thread::id())
+#endif
+{
   assert(ReadableBytes() == 0);
-  assert(WritableBytes() == _buffer_size);
-}
-
-size_t Buffer::WritableBytes() const {
-  return buffer_.size() - write_pos_;
-}
-
-size_t Buffer::ReadableBytes() const {
-  return write_pos_ - read_pos_;
-}
-
-size_t Buffer::PrependableBytes() const {
-  return read_pos_;
-}
-
-const char* Buffer::Peek() const {
-  return BeginPtr_() + read_pos_;
-}
-
-void Buffer::EnsureWritable(size_t len) {
-  if (WritableBytes() < len) {
-    // 空间不够, 扩容
-    MakeSpace_(len);
-  }
-  assert(WritableBytes() >= len);
-}
-
-void Buffer::HasWritten(size_t len) {
-  EnsureWritable(len);
-  write_pos_ += len;
-}
-
-void Buffer::Retrieve(size_t len) {
-  assert(ReadableBytes() >= len);
-  read_pos_ += len;
-}
-
-void Buffer::RetrieveUntil(const char* end) {
-  assert(Peek() <= end);
-  Retrieve(end - Peek());
-}
-
-void Buffer::RetrieveAll() {
-  // 获取全部之后, 重置到初始状态
-  bzero(&buffer_[0], buffer_.size());
-  read_pos_ = 0;
-  write_pos_ = 0;
+  assert(WritableBytes() == static_cast<size_t>(_buffer_size));
 }
 
 std::string Buffer::RetrieveAllToStr() {
@@ -65,12 +28,16 @@ std::string Buffer::RetrieveAllToStr() {
   return str;
 }
 
-const char* Buffer::BeginWriteConst() const {
-  return BeginPtr_() + write_pos_;
-}
-
-char* Buffer::BeginWrite() {
-  return BeginPtr_() + write_pos_;
+void Buffer::Shrink(size_t reserve) {
+  AccessGuard guard(this);
+  size_t readable = ReadableBytes();
+  // 用新的vector交换, resize/shrink_to_fit不保证释放内存
+  std::vector<char> buffer(kCheapPrepend + readable + reserve);
+  std::copy(BeginPtr_() + read_pos_, BeginPtr_() + write_pos_, buffer.data() + kCheapPrepend);
+  buffer_.swap(buffer);
+  read_pos_ = kCheapPrepend;
+  write_pos_ = read_pos_ + readable;
+  read_size_ = kMinReadSize;
 }
 
 void Buffer::Append(const std::string& str) {
@@ -82,44 +49,41 @@ void Buffer::Append(const void* data, size_t len) {
   Append(static_cast<const char*>(data), len);
 }
 
-void Buffer::Append(const char* str, size_t len) {
-  assert(str);
-  EnsureWritable(len);
-  std::copy(str, str + len, BeginWrite());
-  HasWritten(len);
-}
-
 void Buffer::Append(const Buffer& buff) {
   Append(buff.Peek(), buff.ReadableBytes());
 }
 
 ssize_t Buffer::ReadFd(int fd, int* Errno) {
-  char buff[65536]; // 栈上分配 64KB
-  struct iovec iov[2];
-  const size_t writable = WritableBytes();
-
-  // 分散读, 保证数据全部读完
-  iov[0].iov_base = BeginPtr_() + write_pos_;
-  iov[0].iov_len = writable;
-  iov[1].iov_base = buff;
-  iov[1].iov_len = sizeof(buff);
-
-  const ssize_t len = readv(fd, iov, 2);
-  if (len < 0) {
-    *Errno = errno;
-  } else if (static_cast<size_t>(len) <= writable) {
-    // 如果buffer空间够, 直接放到buffer中
+  AccessGuard guard(this);
+  ssize_t total = 0;
+  while (true) {
+    EnsureWritable(read_size_);
+    const size_t writable = WritableBytes();
+    const ssize_t len = read(fd, BeginWrite(), writable);
+    if (len < 0) {
+      if (total > 0) { // 已经读到了数据, 错误(通常是EAGAIN)留给下一次调用
+        return total;
+      }
+      *Errno = errno;
+      return len;
+    }
     write_pos_ += len;
-  } else {
-    // 空间不够, 先放满buffer, 剩下的放到栈中, 然后再追加到buffer尾部
-    write_pos_ = buffer_.size();
-    Append(buff, len - writable);
+    total += len;
+
+    if (static_cast<size_t>(len) == writable) {
+      // 读满了, socket中可能还有数据: 预留更多的空间继续读, LT模式下一次事件只调用一次, 不能只读一部分
+      read_size_ = std::min(read_size_ * 2, kMaxReadSize);
+      continue;
+    }
+    if (static_cast<size_t>(len) < read_size_ / 4) {
+      read_size_ = std::max(read_size_ / 2, kMinReadSize);
+    }
+    return total;
   }
-
-  return len;
 }
 
 ssize_t Buffer::WriteFd(int fd, int* Errno) {
+  AccessGuard guard(this);
   size_t readable_size = ReadableBytes();
   ssize_t len = write(fd, Peek(), readable_size);
   if (len < 0) {
@@ -130,25 +94,18 @@ ssize_t Buffer::WriteFd(int fd, int* Errno) {
   return len;
 }
 
-char* Buffer::BeginPtr_() {
-  return &*buffer_.begin();
-}
-
-const char* Buffer::BeginPtr_() const {
-  return &*buffer_.begin();
-}
-
 void Buffer::MakeSpace_(size_t len) {
-  if (WritableBytes() + PrependableBytes() < len) {
-    // 总的长度不够了, 扩容
-    buffer_.resize(write_pos_ + len + 1);
+  AccessGuard guard(this);
+  size_t readable = ReadableBytes();
+  if (WritableBytes() + PrependableBytes() < len + kCheapPrepend) {
+    // 总的长度不够了, 扩容; 先搬移内容, 按实际需要的大小扩容
+    std::copy(BeginPtr_() + read_pos_, BeginPtr_() + write_pos_, BeginPtr_() + kCheapPrepend);
+    buffer_.resize(std::max(buffer_.size() * 2, kCheapPrepend + readable + len));
   } else {
-    // 总长度够, 则将内容移动到最前面
-    size_t readable = ReadableBytes();
-    // 将readable bytes移动到最前面
-    std::copy(BeginPtr_() + read_pos_, BeginPtr_() + write_pos_, BeginPtr_());
-    read_pos_ = 0;
-    write_pos_ = read_pos_ + readable;
-    assert(readable == ReadableBytes());
+    // 总长度够, 则将readable bytes移动到最前面(保留kCheapPrepend)
+    std::copy(BeginPtr_() + read_pos_, BeginPtr_() + write_pos_, BeginPtr_() + kCheapPrepend);
   }
-}
\ No newline at end of file
+  read_pos_ = kCheapPrepend;
+  write_pos_ = read_pos_ + readable;
+  assert(readable == ReadableBytes());
+}
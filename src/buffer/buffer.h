@@ -9,7 +9,16 @@
 
 #include <vector>
 #include <atomic>
+#include <thread>
+#include <cassert>
+#include <cstring>
 #include <string>
+#include <sys/types.h>
+
+/// 检查同一个Buffer是否被多个线程同时访问, 默认只在调试版本中开启
+#if !defined(NDEBUG) && !defined(WEBSERVER_BUFFER_UNCHECKED)
+#define WEBSERVER_BUFFER_CHECKED
+#endif
 
 /// A buffer class modeled after org.jboss.netty.buffer.ChannelBuffer
 ///
@@ -21,57 +30,106 @@
 /// |                   |                  |                  |
 /// 0      <=      readerIndex   <=   writerIndex    <=     size
 /// @endcode
+///
+/// 同一时刻只由一个线程访问(连接在EPOLLONESHOT下只交给一个线程), 读写位置不使用原子变量.
+/// 定义了WEBSERVER_BUFFER_CHECKED时(调试版本), 修改操作检查是否有另一个线程正在修改同一个Buffer.
+/// 开头预留kCheapPrepend个字节, 可以在已写入的内容前面插入少量数据(如长度、帧头)而不移动内容.
 class Buffer {
  public:
+  /// 预留在开头的字节数
+  static const size_t kCheapPrepend = 16;
+  /// ReadFd一次读取的最小/最大预留空间
+  static const size_t kMinReadSize = 1024;
+  static const size_t kMaxReadSize = 64 * 1024;
+
   explicit Buffer(int _buffer_size=1024);
   ~Buffer() = default;
 
   /// @brief 可写字节数 = len(buffer) - write_pos
-  size_t WritableBytes() const;
+  inline size_t WritableBytes() const { return buffer_.size() - write_pos_; }
 
   /// @brief 可读字节数 = write_pos - read_pos
-  size_t ReadableBytes() const;
+  inline size_t ReadableBytes() const { return write_pos_ - read_pos_; }
 
   /// @brief 前向字节数 = read_pos
-  size_t PrependableBytes() const;
+  inline size_t PrependableBytes() const { return read_pos_; }
 
   /// @brief 指向readable bytes开头的指针
-  const char* Peek() const;
+  inline const char* Peek() const { return BeginPtr_() + read_pos_; }
 
   /// @brief 确保writable bytes可以装下新来的len个字节, 如果不够则扩容
   /// @param len 将要写入的字节数
-  void EnsureWritable(size_t len);
+  inline void EnsureWritable(size_t len) {
+    if (WritableBytes() < len) {
+      // 空间不够, 扩容
+      MakeSpace_(len);
+    }
+    assert(WritableBytes() >= len);
+  }
 
   /// @brief 已经写入len个字节到writable bytes中, 即更新writer_pos的位置
   /// @param len 已写入的字节数
-  void HasWritten(size_t len);
+  inline void HasWritten(size_t len) {
+    EnsureWritable(len);
+    write_pos_ += len;
+  }
 
   /// @brief 读取len个字节, 即更新read_pos的位置
   /// @param len 读取的字节数
-  void Retrieve(size_t len);
+  inline void Retrieve(size_t len) {
+    assert(ReadableBytes() >= len);
+    AccessGuard guard(this);
+    read_pos_ += len;
+  }
 
   /// @brief 读取到end指针所指向的位置
   /// @param end 读取的结束位置
-  void RetrieveUntil(const char* end);
-
-  /// @brief 读取所有的内容
-  void RetrieveAll();
+  inline void RetrieveUntil(const char* end) {
+    assert(Peek() <= end);
+    Retrieve(end - Peek());
+  }
+
+  /// @brief 读取所有的内容, 只重置读写位置, 不清零内存
+  inline void RetrieveAll() {
+    AccessGuard guard(this);
+    read_pos_ = kCheapPrepend;
+    write_pos_ = kCheapPrepend;
+  }
 
   /// @brief 读取所有的内容到字符串中
   /// @return 读取的内容
   std::string RetrieveAllToStr();
 
   /// @brief begin iterator of `writable bytes`
-  const char* BeginWriteConst() const;
+  inline const char* BeginWriteConst() const { return BeginPtr_() + write_pos_; }
 
   /// @brief begin iterator of `writable bytes`
-  char* BeginWrite();
+  inline char* BeginWrite() { return BeginPtr_() + write_pos_; }
 
   void Append(const std::string& str);
-  void Append(const char* str, size_t len);
+  inline void Append(const char* str, size_t len) {
+    assert(str || len == 0);
+    AccessGuard guard(this);
+    EnsureWritable(len);
+    memcpy(BeginWrite(), str, len);
+    write_pos_ += len;
+  }
   void Append(const void* data, size_t len);
   void Append(const Buffer& buff);
 
+  /// @brief 在readable bytes前面插入数据, len不能超过PrependableBytes()
+  inline void Prepend(const void* data, size_t len) {
+    assert(len <= PrependableBytes());
+    AccessGuard guard(this);
+    read_pos_ -= len;
+    memcpy(BeginPtr_() + read_pos_, data, len);
+  }
+
+  ///
+  /// @brief 从fd读取数据, 直接读入缓冲区; 读满预留的空间时扩容继续读, 直到读不满或没有数据(EAGAIN)
+  /// 预留的空间随读取的情况调整: 读满时加倍(最多kMaxReadSize), 读到的数据远小于预留空间时减半
+  /// @return 读到的字节数, 没有读到数据时返回read的返回值
+  ///
   ssize_t ReadFd(int fd, int* Errno);
 
   /// @brief 将readable bytes中的内容写到句柄fd中
@@ -80,17 +138,55 @@ class Buffer {
   /// @return 写入的字节数
   ssize_t WriteFd(int fd, int* Errno);
 
+  /// @brief 占用的内存大小(包括预留的开头和可写空间)
+  inline size_t Capacity() const { return buffer_.size(); }
+
+  ///
+  /// @brief 释放多余的内存: 重新分配为刚好装下readable bytes和reserve个可写字节的大小, 并重置ReadFd的预留空间
+  /// 用于长时间不用的缓冲区(空闲连接), 之后写入时照常扩容
+  ///
+  void Shrink(size_t reserve);
+
  private:
+  /// @brief 修改操作期间标记Buffer正在被使用, 另一个线程同时修改时断言失败
+  class AccessGuard {
+   public:
+#ifdef WEBSERVER_BUFFER_CHECKED
+    explicit AccessGuard(Buffer* buff) : buff_(buff), nested_(buff->owner_ == std::this_thread::get_id()) {
+      if (!nested_) {
+        std::thread::id none;
+        bool acquired = buff_->owner_.compare_exchange_strong(none, std::this_thread::get_id());
+        assert(acquired && "Buffer is used by two threads at the same time");
+        (void) acquired;
+      }
+    }
+    ~AccessGuard() {
+      if (!nested_) {
+        buff_->owner_ = std::thread::id();
+      }
+    }
+   private:
+    Buffer* buff_;
+    bool nested_;  // 嵌套调用(如Append中的MakeSpace_), 由外层释放
+#else
+    explicit AccessGuard(Buffer*) {}
+#endif
+  };
+
   /// @brief 获取开始的指针
-  char* BeginPtr_();
-  const char* BeginPtr_() const;
+  inline char* BeginPtr_() { return buffer_.data(); }
+  inline const char* BeginPtr_() const { return buffer_.data(); }
   /// @brief 扩容
   void MakeSpace_(size_t len);
 
  private:
   std::vector<char> buffer_;
-  std::atomic<std::size_t> read_pos_;
-  std::atomic<std::size_t> write_pos_;
+  size_t read_pos_;
+  size_t write_pos_;
+  size_t read_size_;  // ReadFd下一次预留的空间
+#ifdef WEBSERVER_BUFFER_CHECKED
+  std::atomic<std::thread::id> owner_;  // 正在修改的线程
+#endif
 };
 
 #endif //WEBSERVERCPP11_SRC_BUFFER_BUFFER_H_
@@ -0,0 +1,163 @@
+// =============================================================================
+// Created by yangb on 2021/4/29.
+// =============================================================================
+
+#include <cassert>
+#include <cerrno>
+#include <climits>  // IOV_MAX
+#include <unistd.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include "output_queue.h"
+
+OutputQueue::OutputQueue() : owned_in_segments_(0), bytes_(0), files_(0) {}
+
+OutputQueue::~OutputQueue() {
+  Clear();
+}
+
+void OutputQueue::AppendShared(std::shared_ptr<const void> owner, const char* data, size_t len) {
+  if (len == 0) {
+    return;
+  }
+  SyncOwned_();
+  Segment segment{Segment::SHARED, len, data, std::move(owner), -1, 0};
+  segments_.push_back(std::move(segment));
+  bytes_ += len;
+}
+
+void OutputQueue::AppendFile(int fd, off_t offset, size_t len) {
+  if (len == 0) {
+    close(fd);
+    return;
+  }
+  SyncOwned_();
+  segments_.push_back(Segment{Segment::FILE, len, nullptr, nullptr, fd, offset});
+  bytes_ += len;
+  ++files_;
+}
+
+void OutputQueue::Clear() {
+  while (!segments_.empty()) {
+    PopFront_();
+  }
+  owned_.RetrieveAll();
+  owned_in_segments_ = 0;
+  bytes_ = 0;
+}
+
+void OutputQueue::Shrink(size_t reserve) {
+  if (!Empty()) {
+    return;
+  }
+  Clear();  // 已发送完的数据可能还留在owned_中
+  owned_.Shrink(reserve);
+}
+
+ssize_t OutputQueue::WriteFd(int fd, int* save_errno) {
+  SyncOwned_();
+  if (segments_.empty()) {
+    return 0;
+  }
+
+  ssize_t len;
+  Segment& front = segments_.front();
+  if (front.type == Segment::FILE) {
+    off_t offset = front.offset;
+    len = sendfile(fd, front.fd, &offset, front.len);
+    if (len == 0) { // 文件在发送过程中被截断, 已发送的Content-Length无法兑现
+      errno = EIO;
+      len = -1;
+    }
+  } else {
+    struct iovec iov[IOV_MAX];
+    int cnt = Peek(iov, IOV_MAX);
+    if (static_cast<size_t>(cnt) < segments_.size()) {
+      // 后面还有数据(文件或更多分段): MSG_MORE让内核等后续数据凑满报文段, 如响应头部和sendfile的正文
+      struct msghdr msg{};
+      msg.msg_iov = iov;
+      msg.msg_iovlen = cnt;
+      len = sendmsg(fd, &msg, MSG_MORE | MSG_NOSIGNAL);
+    } else {
+      len = writev(fd, iov, cnt);
+    }
+  }
+  if (len < 0) {
+    *save_errno = errno;
+    return len;
+  }
+  Consume(static_cast<size_t>(len));
+  return len;
+}
+
+int OutputQueue::Peek(struct iovec* iov, int max_cnt) {
+  SyncOwned_();
+  const char* owned = owned_.Peek();  // 自有数据的分段在owned_中依次相连
+  int cnt = 0;
+  for (auto it = segments_.begin(); it != segments_.end() && cnt < max_cnt; ++it) {
+    if (it->type == Segment::FILE) {
+      break;
+    }
+    if (it->type == Segment::OWNED) {
+      iov[cnt].iov_base = const_cast<char*>(owned);
+      owned += it->len;
+    } else {
+      iov[cnt].iov_base = const_cast<char*>(it->data);
+    }
+    iov[cnt].iov_len = it->len;
+    ++cnt;
+  }
+  return cnt;
+}
+
+void OutputQueue::Consume(size_t len) {
+  assert(len <= bytes_);
+  bytes_ -= len;
+  while (len > 0) {
+    Segment& front = segments_.front();
+    size_t n = len < front.len ? len : front.len;
+    switch (front.type) {
+      case Segment::OWNED:
+        owned_.Retrieve(n);
+        owned_in_segments_ -= n;
+        break;
+      case Segment::SHARED:
+        front.data += n;
+        break;
+      case Segment::FILE:
+        front.offset += static_cast<off_t>(n);
+        break;
+    }
+    front.len -= n;
+    len -= n;
+    if (front.len == 0) {
+      PopFront_();
+    }
+  }
+  if (owned_.ReadableBytes() == 0) { // 自有数据全部发送完, 从头开始使用缓冲区
+    owned_.RetrieveAll();
+  }
+}
+
+void OutputQueue::SyncOwned_() {
+  size_t added = owned_.ReadableBytes() - owned_in_segments_;
+  if (added == 0) {
+    return;
+  }
+  if (!segments_.empty() && segments_.back().type == Segment::OWNED) {
+    segments_.back().len += added;
+  } else {
+    segments_.push_back(Segment{Segment::OWNED, added, nullptr, nullptr, -1, 0});
+  }
+  owned_in_segments_ += added;
+  bytes_ += added;
+}
+
+void OutputQueue::PopFront_() {
+  Segment& front = segments_.front();
+  if (front.type == Segment::FILE) {
+    close(front.fd);
+    --files_;
+  }
+  segments_.pop_front();
+}
@@ -0,0 +1,115 @@
+// =============================================================================
+// Created by yangb on 2021/4/29.
+// 输出队列: 自有数据、共享的只读数据和文件区间组成的分段链, writev/sendfile发送
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_BUFFER_OUTPUT_QUEUE_H_
+#define WEBSERVERCPP11_SRC_BUFFER_OUTPUT_QUEUE_H_
+
+#include <sys/types.h>
+#include <sys/uio.h>  // iovec
+#include <deque>
+#include <memory>
+#include "buffer.h"
+
+///
+/// @brief 连接的待发送数据, 按顺序由若干分段组成:
+/// - OWNED:  复制到队列内部Buffer中的数据(状态行、响应头部、HTTP/2帧等), 可以通过Owned()直接写入
+/// - SHARED: 不复制, 引用计数持有的只读内存(FileCache中的文件、mmap映射的文件)
+/// - FILE:   文件区间, 发送时用sendfile, 不经过用户态; 队列拥有文件描述符, 发送完或Clear时关闭
+/// 多个响应可以依次追加(流水线), 不需要等上一个发送完.
+/// 不是线程安全的, 同一时刻只有一个线程处理同一个连接.
+///
+class OutputQueue {
+ public:
+  OutputQueue();
+
+  ~OutputQueue();
+
+  OutputQueue(const OutputQueue&) = delete;
+  OutputQueue& operator=(const OutputQueue&) = delete;
+
+  ///
+  /// @brief 自有数据的缓冲区, 追加到其中的数据排在已有分段之后
+  /// 只能追加, 不能Retrieve
+  ///
+  inline Buffer& Owned() { return owned_; }
+
+  /// @brief 追加自有数据(复制)
+  inline void Append(const char* data, size_t len) { owned_.Append(data, len); }
+
+  ///
+  /// @brief 追加共享的只读数据(不复制)
+  /// @param owner 数据的所有者, 发送完之前一直持有
+  ///
+  void AppendShared(std::shared_ptr<const void> owner, const char* data, size_t len);
+
+  ///
+  /// @brief 追加文件区间, 用sendfile发送
+  /// @param fd 文件描述符, 由队列关闭
+  ///
+  void AppendFile(int fd, off_t offset, size_t len);
+
+  /// @brief 待发送的字节数
+  inline size_t Bytes() const { return bytes_ + (owned_.ReadableBytes() - owned_in_segments_); }
+
+  inline bool Empty() const { return Bytes() == 0; }
+
+  /// @brief 是否有FILE分段(需要sendfile, 不能通过Peek发送)
+  inline bool HasFile() const { return files_ > 0; }
+
+  /// @brief 丢弃所有待发送的数据
+  void Clear();
+
+  /// @brief 自有数据缓冲区占用的内存大小
+  inline size_t Capacity() const { return owned_.Capacity(); }
+
+  /// @brief 队列为空时释放自有数据缓冲区多余的内存(见Buffer::Shrink)
+  void Shrink(size_t reserve);
+
+  ///
+  /// @brief 发送到socket: 开头是FILE分段时sendfile, 否则把后续的内存分段(最多IOV_MAX个)一次writev,
+  /// 之后还有分段时改用带MSG_MORE的sendmsg, 避免单独发出一个小报文段
+  /// @return 发送的字节数, 出错时返回-1并设置save_errno
+  ///
+  ssize_t WriteFd(int fd, int* save_errno);
+
+  ///
+  /// @brief 开头的内存分段(遇到FILE分段为止), 用于不能直接writev/sendfile的连接(如TLS)
+  /// @return 填入iov的数量
+  ///
+  int Peek(struct iovec* iov, int max_cnt);
+
+  /// @brief 已发送len个字节
+  void Consume(size_t len);
+
+ private:
+  struct Segment {
+    enum Type {
+      OWNED,
+      SHARED,
+      FILE,
+    };
+    Type type;
+    size_t len;     // 剩余的字节数
+    const char* data;                   // SHARED: 剩余数据的开头
+    std::shared_ptr<const void> owner;  // SHARED
+    int fd;         // FILE
+    off_t offset;   // FILE: 剩余数据在文件中的偏移
+  };
+
+  /// @brief 把Owned()中新追加的数据加入分段链
+  void SyncOwned_();
+
+  /// @brief 释放开头的分段
+  void PopFront_();
+
+ private:
+  Buffer owned_;
+  size_t owned_in_segments_;  // owned_中已加入分段链的字节数
+  size_t bytes_;              // 分段链中的字节数
+  int files_;                 // FILE分段的数量
+  std::deque<Segment> segments_;
+};
+
+#endif //WEBSERVERCPP11_SRC_BUFFER_OUTPUT_QUEUE_H_
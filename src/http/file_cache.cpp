@@ -0,0 +1,107 @@
+// =============================================================================
+// Created by yangb on 2021/4/25.
+// =============================================================================
+
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include "file_cache.h"
+
+FileCache* FileCache::Instance() {
+  static FileCache cache;
+  return &cache;
+}
+
+void FileCache::Init(size_t max_file_size, size_t capacity) {
+  std::lock_guard<std::mutex> locker(mtx_);
+  max_file_size_ = max_file_size;
+  capacity_ = capacity;
+  slots_.clear();
+  size_ = 0;
+}
+
+std::shared_ptr<const FileCache::Entry> FileCache::Find(const std::string& file) {
+  int64_t now = NowMs_();
+  std::shared_ptr<const Entry> entry;
+  {
+    std::lock_guard<std::mutex> locker(mtx_);
+    auto it = slots_.find(file);
+    if (it == slots_.end()) {
+      return nullptr;
+    }
+    if (now - it->second.checked_ms < kRevalidateMs) {
+      return it->second.entry;
+    }
+    entry = it->second.entry;
+    it->second.checked_ms = now;  // stat期间其他线程照常使用, 不重复检查
+  }
+
+  // stat可能要等磁盘(如元数据不在缓存中), 不持有锁, 不阻塞其他文件的查找
+  struct stat st{};
+  if (stat(file.data(), &st) == 0 && SameFile_(st, entry->st)) {
+    return entry;
+  }
+  std::lock_guard<std::mutex> locker(mtx_);  // 文件被删除或修改
+  auto it = slots_.find(file);
+  if (it != slots_.end() && it->second.entry == entry) { // 没有被其他线程重新读入
+    size_ -= entry->data.size();
+    slots_.erase(it);
+  }
+  return nullptr;
+}
+
+std::shared_ptr<const FileCache::Entry> FileCache::Find(const char* dir, const std::string& path) {
+  thread_local std::string file;
+  file.assign(dir).append(path);
+  return Find(file);
+}
+
+std::shared_ptr<const FileCache::Entry> FileCache::Load(const std::string& file, int fd, const struct stat& st) {
+  size_t size = static_cast<size_t>(st.st_size);
+  if (size > max_file_size_ || !S_ISREG(st.st_mode)) {
+    return nullptr;
+  }
+
+  auto entry = std::make_shared<Entry>();
+  entry->st = st;
+  entry->data.resize(size);
+  size_t offset = 0;
+  while (offset < size) {
+    ssize_t len = pread(fd, &entry->data[offset], size - offset, offset);
+    if (len < 0 && errno == EINTR) {
+      continue;
+    }
+    if (len <= 0) { // 读取出错或文件被截断
+      return nullptr;
+    }
+    offset += len;
+  }
+
+  std::lock_guard<std::mutex> locker(mtx_);
+  auto it = slots_.find(file);
+  if (it != slots_.end()) { // 其他线程已读入, 以新读入的为准
+    size_ -= it->second.entry->data.size();
+    slots_.erase(it);
+  }
+  if (size_ + size <= capacity_) {
+    slots_.emplace(file, Slot{entry, NowMs_()});
+    size_ += size;
+  }
+  return entry;
+}
+
+void FileCache::Clear() {
+  std::lock_guard<std::mutex> locker(mtx_);
+  slots_.clear();
+  size_ = 0;
+}
+
+int64_t FileCache::NowMs_() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool FileCache::SameFile_(const struct stat& a, const struct stat& b) {
+  return a.st_ino == b.st_ino && a.st_size == b.st_size && a.st_mode == b.st_mode
+      && a.st_mtim.tv_sec == b.st_mtim.tv_sec && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+}
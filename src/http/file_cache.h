@@ -0,0 +1,79 @@
+// =============================================================================
+// Created by yangb on 2021/4/25.
+// 静态文件缓存: 小文件读入内存, 多个连接共享同一份内容
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_HTTP_FILE_CACHE_H_
+#define WEBSERVERCPP11_SRC_HTTP_FILE_CACHE_H_
+
+#include <sys/stat.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+///
+/// @brief 静态文件缓存(单例模式)
+/// 不超过max_file_size的文件在第一次被请求时读入内存, 之后的请求直接使用内存中的内容,
+/// 不再stat/open/mmap. 条目以shared_ptr返回, 正在发送的响应持有引用, 条目被替换后内容依然有效.
+/// 每个条目最多每kRevalidateMs毫秒stat一次(不持有锁), 文件被修改后丢弃旧内容.
+///
+class FileCache {
+ public:
+  struct Entry {
+    std::string data;   // 文件内容
+    struct stat st;     // 读入时的文件信息
+  };
+
+  /// 两次检查文件是否被修改的最小间隔
+  static const int64_t kRevalidateMs = 1000;
+
+  static FileCache* Instance();
+
+  /// @brief 设置缓存大小
+  /// @param max_file_size 可缓存的最大文件, 单位: 字节; 0: 关闭缓存
+  /// @param capacity 缓存内容的总大小上限, 单位: 字节
+  void Init(size_t max_file_size, size_t capacity);
+
+  inline size_t MaxFileSize() const { return max_file_size_; }
+
+  /// @brief 查找文件, 未缓存或已被修改时返回nullptr; 需要重新检查时在锁外stat
+  std::shared_ptr<const Entry> Find(const std::string& file);
+
+  /// @brief 同Find(dir + path), 路径在线程局部的缓冲区中拼接, 不分配内存
+  std::shared_ptr<const Entry> Find(const char* dir, const std::string& path);
+
+  /// @brief 从已打开的文件中读入内容并加入缓存
+  /// @param file 文件路径(缓存的key)
+  /// @param fd 文件描述符
+  /// @param st 文件信息, st_size超过MaxFileSize时不缓存
+  /// @return 读取失败或文件过大时返回nullptr; 缓存已满时返回的内容不加入缓存
+  std::shared_ptr<const Entry> Load(const std::string& file, int fd, const struct stat& st);
+
+  /// @brief 清空缓存
+  void Clear();
+
+ private:
+  struct Slot {
+    std::shared_ptr<const Entry> entry;
+    int64_t checked_ms; // 上一次stat的时间
+  };
+
+  FileCache() : max_file_size_(0), capacity_(0), size_(0) {}
+  ~FileCache() = default;
+
+  static int64_t NowMs_();
+
+  /// @brief 文件是否与读入时一致
+  static bool SameFile_(const struct stat& a, const struct stat& b);
+
+ private:
+  std::mutex mtx_;
+  size_t max_file_size_;
+  size_t capacity_;
+  size_t size_;   // 已缓存内容的总大小
+  std::unordered_map<std::string, Slot> slots_;
+};
+
+#endif //WEBSERVERCPP11_SRC_HTTP_FILE_CACHE_H_
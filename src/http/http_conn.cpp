@@ -2,79 +2,279 @@
 // Created by yangb on 2021/4/7.
 // =============================================================================
 
-
+#include <algorithm>
+#include <cstring>
+#include <netinet/tcp.h>  // TCP_CORK
 #include "http_conn.h"
+#include "../http2/http2_session.h"
+#include "../tls/tls_context.h"
 
+const size_t HttpConn::kWriteBudget;
+const size_t HttpConn::kMaxHeaderSize;
 bool HttpConn::is_ET{false};
+bool HttpConn::tcp_cork{false};
+bool HttpConn::bulkheads{false};
 const char* HttpConn::kSrcDir;
 std::atomic<int> HttpConn::user_count{0};
 
+HttpConn::HttpConn() : fd_(-1), addr_{0}, is_close_(true), corked_(false) {}
+
+HttpConn::~HttpConn() {
+  Close();
+}
+
 void HttpConn::Init(int sock_fd, const sockaddr_in& addr) {
   assert(sock_fd > 0);
   ++user_count;
   addr_ = addr;
   fd_ = sock_fd;
-  write_buff_.RetrieveAll();  // 清空
+  out_.Clear();               // 清空
   read_buff_.RetrieveAll();   // 清空
+  corked_ = false;
+  if (TlsContext::Instance()->IsEnabled()) {
+    tls_.reset(new TlsConn(sock_fd));
+  }
   is_close_ = false;
   LOG_INFO("Client[%d](%s:%d) in, user count: %d", GetFd(), GetIP(), GetPort(), static_cast<int>(user_count));
 }
 
 ssize_t HttpConn::Write(int* save_errno) {
   ssize_t len = -1;
+  size_t written = 0;
+  // 头部和sendfile的正文分两次系统调用发送, 开启TCP_CORK后两者合并成满的报文段
+  if (tcp_cork && !corked_ && out_.HasFile()) {
+    SetCork_(true);
+  }
   do {
-    len = writev(fd_, iov_, iov_cnt_);
+    {
+      TRACE_SCOPE("writev");
+      // kTLS由内核加密, 与普通socket一样可以writev/sendfile
+      len = tls_ && !tls_->IsKtlsSend() ? WriteTls_(save_errno) : out_.WriteFd(fd_, save_errno);
+    }
     if (len <= 0) {
-      *save_errno = errno;
       break;
     }
+    Metrics::Add(Metrics::BYTES_WRITTEN, len);
+    written += len;
+    // 一直写到发送完或EAGAIN(不再因为剩下的数据少而提前返回); LT模式下有发送预算, 可写事件会再次触发
+  } while (ToWriteBytes() > 0 && (is_ET || written < kWriteBudget));
 
-    if (ToWriteBytes() == 0) { // 传输结束
-      break;
-    } else if (static_cast<size_t>(len) > iov_[0].iov_len) {
-      iov_[1].iov_base = static_cast<uint8_t*>(iov_[1].iov_base) + (len - iov_[0].iov_len);
-      iov_[1].iov_len -= (len - iov_[0].iov_len);
-      if (iov_[0].iov_len) {
-        write_buff_.RetrieveAll();
-        iov_[0].iov_len = 0;
-      }
-    } else {
-      iov_[0].iov_base = static_cast<uint8_t*>(iov_[0].iov_base) + len;
-      iov_[0].iov_len -= len;
-      write_buff_.Retrieve(len);
-    }
+  if (corked_ && ToWriteBytes() == 0) { // 响应全部写入, 发出最后一个不满的报文段
+    SetCork_(false);
+  }
+  return len;
+}
+
+void HttpConn::SetCork_(bool on) {
+  int val = on ? 1 : 0;
+  if (setsockopt(fd_, IPPROTO_TCP, TCP_CORK, &val, sizeof(val)) == 0) {
+    corked_ = on;
+  }
+}
+
+ssize_t HttpConn::WriteTls_(int* save_errno) {
+  // 用户态加密时响应中不会有FILE分段(见Process中的SetSendfile)
+  assert(!out_.HasFile());
+  struct iovec iov[16];
+  int cnt = out_.Peek(iov, 16);
+  ssize_t len = tls_->Writev(iov, cnt);
+  if (len < 0) {
+    *save_errno = errno;
+    return len;
+  }
+  out_.Consume(static_cast<size_t>(len));
+  return len;
+}
+
+bool HttpConn::Close() {
+  response_.UnmapFile();
+  out_.Clear();
+  h2_.reset();
+  tls_.reset(); // 在close之前发送close_notify
+  if (is_close_) {
+    return false;
+  }
+  is_close_ = true;
+  --user_count;
+  close(fd_);
+  LOG_INFO("Client[%d](%s:%d) quit, user count: %d", GetFd(), GetIP(), GetPort(), static_cast<int>(user_count));
+  return true;
+}
 
-  } while (is_ET || ToWriteBytes() > 10240);
+size_t HttpConn::ShrinkBuffers(size_t max_capacity) {
+  if (read_buff_.Capacity() > max_capacity) {
+    read_buff_.Shrink(Buffer::kMinReadSize);
+  }
+  if (out_.Capacity() > max_capacity) {
+    out_.Shrink(Buffer::kMinReadSize);
+  }
+  return read_buff_.Capacity() + out_.Capacity();
+}
 
+ssize_t HttpConn::ReadTls_(int* save_errno) {
+  // OpenSSL内部可能缓存了已解密的数据, 不管是否为ET模式都要读到EAGAIN
+  ssize_t len = tls_->Read(read_buff_, save_errno);
+  if (len > 0) {
+    Metrics::Add(Metrics::BYTES_READ, len);
+  }
   return len;
 }
 
+bool HttpConn::IsKeepAlive() const {
+  if (h2_) {
+    return !h2_->IsClosing();
+  }
+  return request_.IsKeeyAlive();
+}
+
 bool HttpConn::Process() {
+  if (h2_ || Http2Session::IsPreface(read_buff_)) { // 以连接前言开头: HTTP/2(prior knowledge)
+    return ProcessHttp2_();
+  }
   request_.Init();
   if (read_buff_.ReadableBytes() <= 0) {
     return false;
   }
 
-  if (request_.Parse(read_buff_)) { // 解析请求成功
-    LOG_DEBUG("%s\n", request_.GetPath().c_str());
-    response_.Init(kSrcDir, request_.GetPath(), request_.IsKeeyAlive(), 200);
-  } else {  // 解析请求失败
-    response_.Init(kSrcDir, request_.GetPath(), false, 400);
-  }
-
-  response_.MakeResponse(write_buff_);
-  // 下面参考buffer中ReadFd的实现(iov_[0]指向状态行&响应头部&空行, iov_[1]指向响应正文（响应请求的文件）)
-  // 响应头
-  iov_[0].iov_base = const_cast<char*>(write_buff_.Peek());
-  iov_[0].iov_len = write_buff_.ReadableBytes();
-  iov_cnt_ = 1;
-  // 文件
-  if (response_.FileLen() > 0 && response_.File()) {
-    iov_[1].iov_base = response_.File();
-    iov_[1].iov_len = response_.FileLen();
-    iov_cnt_ = 2;
-  }
-  LOG_DEBUG("File size: %d, iov count: %d, to write bytes: %d\n", response_.FileLen(), iov_cnt_, ToWriteBytes());
+  int64_t start = Metrics::NowNs();
+  bool parsed;
+  {
+    TRACE_SCOPE("Parse");
+    parsed = request_.Parse(read_buff_);
+  }
+  Metrics::Observe(Metrics::PARSE, Metrics::NowNs() - start);
+  Metrics::Add(Metrics::REQUESTS);
+
+  if (parsed && strcasecmp(request_.GetHeader(HttpHeaders::UPGRADE), "h2c") == 0
+      && request_.GetMethod() == "GET") { // Upgrade: h2c
+    std::unique_ptr<Http2Session> session(new Http2Session());
+    if (session->Upgrade(request_.GetHeader(HttpHeaders::HTTP2_SETTINGS), request_.GetMethod(), request_.GetPath(),
+                         out_.Owned())) {
+      h2_ = std::move(session);
+      return ProcessHttp2_();
+    }
+  }
+
+  // 状态行&响应头部&空行直接写入输出队列, 文件正文作为共享分段或文件分段追加在后面, 不复制
+  // 用户态TLS需要文件内容在内存中加密, 不能sendfile
+  response_.SetSendfile(!tls_ || tls_->IsKtlsSend());
+  BuildResponse(request_, parsed, response_, out_.Owned());
+  response_.MoveBodyTo(out_);
+  LOG_DEBUG("File size: %d, to write bytes: %d\n", response_.FileLen(), ToWriteBytes());
   return true;
 }
 
+bool HttpConn::CanProcessInline() {
+  const Router::Route* route = PeekRoute_("GET", &peek_path_);
+  if (!route) {
+    return false;
+  }
+  if (route->handler) {
+    return !route->may_block;
+  }
+  const std::string& file = route->file.empty() ? peek_path_ : route->file;
+  ResourcePack::File packed;
+  if (ResourcePack::Instance()->Find(file, false, &packed)) {
+    return true;
+  }
+  std::shared_ptr<const FileCache::Entry> entry = FileCache::Instance()->Find(kSrcDir, file);
+  if (!entry) {
+    return false;
+  }
+  response_.SetCachedHint(file, std::move(entry));
+  return true;
+}
+
+bool HttpConn::IsHeaderIncomplete() const {
+  if (h2_ || read_buff_.ReadableBytes() > kMaxHeaderSize) {
+    return false;
+  }
+  const char* begin = read_buff_.Peek();
+  const char* end = read_buff_.BeginWriteConst();
+  return Scan::FindHeaderEnd(begin, end) == end;
+}
+
+Router::Executor HttpConn::GetExecutor() const {
+  if (h2_) {
+    return h2_->DeferredExecutor();
+  }
+  std::string path;
+  const Router::Route* route = PeekRoute_(nullptr, &path);
+  return route ? route->executor : Router::IO;
+}
+
+bool HttpConn::HasDeferredStreams() const {
+  return h2_ && h2_->HasDeferred();
+}
+
+void HttpConn::Reject(const char* response, size_t len) {
+  if (h2_) { // HTTP/2连接上不能发送HTTP/1.1的响应, 拒绝暂存的流, 连接保持
+    h2_->RefuseDeferred(out_.Owned());
+    return;
+  }
+  request_.Init();  // 不保持连接
+  read_buff_.RetrieveAll();
+  out_.Append(response, len);
+}
+
+const Router::Route* HttpConn::PeekRoute_(const char* method, std::string* path) const {
+  const char* begin = read_buff_.Peek();
+  const char* end = read_buff_.BeginWriteConst();
+  if (h2_) {
+    return nullptr;
+  }
+  const char* method_end = std::find(begin, end, ' ');
+  if (method_end == end || (method && (static_cast<size_t>(method_end - begin) != strlen(method)
+      || memcmp(begin, method, method_end - begin) != 0))) {
+    return nullptr;
+  }
+  if (Scan::FindHeaderEnd(begin, end) == end) { // 请求头不完整
+    return nullptr;
+  }
+
+  const char* path_begin = method_end + 1;
+  path->assign(path_begin, std::find(path_begin, end, ' '));
+  return Router::Instance()->Match(Router::ParseMethod(std::string(begin, method_end)), *path);
+}
+
+void HttpConn::BuildResponse(HttpRequest& request, bool parsed, HttpResponse& response, Buffer& buff) {
+  int64_t start = Metrics::NowNs();
+  const Router::Route* route = nullptr;
+  if (parsed) { // 解析请求成功
+    LOG_DEBUG("%s\n", request.GetPath().c_str());
+    route = Router::Instance()->Match(Router::ParseMethod(request.GetMethod()), request.GetPath());
+    response.Init(kSrcDir, request.GetPath(), request.IsKeeyAlive(), route ? 200 : 404);
+  } else {  // 解析请求失败
+    Metrics::Add(Metrics::BAD_REQUESTS);
+    response.Init(kSrcDir, request.GetPath(), false, 400);
+  }
+
+  {
+    TRACE_SCOPE("MakeResponse");
+    if (parsed) {
+      response.SetNegotiation(ResourcePack::AcceptsGzip(request.GetHeader(HttpHeaders::ACCEPT_ENCODING)),
+                              request.GetHeader(HttpHeaders::IF_NONE_MATCH));
+    }
+    if (route && route->handler) { // 动态处理(监控指标, 登录/注册等)
+      route->handler(request, response, buff);
+    } else {
+      if (route && !route->file.empty()) {
+        response.SetFile(route->file, route->content_type);
+      }
+      response.MakeResponse(buff);
+    }
+  }
+  Metrics::Observe(Metrics::RESPONSE_BUILD, Metrics::NowNs() - start);
+}
+
+bool HttpConn::ProcessHttp2_() {
+  if (!h2_) {
+    h2_.reset(new Http2Session());
+  }
+  if (h2_->HasDeferred()) { // 已经交给了暂存的流对应的线程池
+    h2_->RunDeferred(out_.Owned());
+  }
+  // 所有流的帧都追加到输出队列中, 一次writev发出
+  h2_->Process(read_buff_, out_.Owned(), bulkheads);
+  return ToWriteBytes() > 0;
+}
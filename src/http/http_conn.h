@@ -7,45 +7,95 @@
 
 #include <netinet/in.h>
 #include <arpa/inet.h>
-#include <sys/uio.h>  // writev
+#include <memory>
 #include "../log/log.h"
 #include "../pool/sql_conn_raii.h"
 #include "../buffer/buffer.h"
+#include "../buffer/output_queue.h"
+#include "../metrics/metrics.h"
+#include "../trace/trace.h"
+#include "../tls/tls_conn.h"
 #include "http_request.h"
 #include "http_response.h"
+#include "router.h"
+
+class Http2Session;
 
 class HttpConn {
  public:
-  HttpConn() : fd_(-1), addr_{0}, is_close_(true) {}
+  HttpConn();
 
-  ~HttpConn() { Close(); }
+  ~HttpConn();
 
   void Init(int sock_fd, const sockaddr_in& addr);
 
+  /// @brief 发送输出队列中的数据: writev内存分段, sendfile文件分段(用户态TLS时加密后发送)
   ssize_t Write(int* save_errno);
 
   bool Process();
 
+  ///
+  /// @brief 根据解析好的请求生成响应(HTTP/1.1和HTTP/2共用)
+  /// 响应头部(以及内存中的正文)写入buff, 文件通过response.File()获取
+  ///
+  static void BuildResponse(HttpRequest& request, bool parsed, HttpResponse& response, Buffer& buff);
+
+  ///
+  /// @brief 能否在事件循环线程上直接处理(不会阻塞), HTTP/2连接总是交给线程池
+  /// 只有请求头已完整读入, 且路由到ResourcePack/FileCache中的文件或不阻塞的处理函数(如监控指标)的GET请求返回true;
+  /// POST(可能查询数据库)和未缓存的文件(需要读磁盘)交给线程池处理.
+  /// 命中FileCache时把条目交给响应, 紧接着的Process不再查找
+  ///
+  bool CanProcessInline();
+
+  ///
+  /// @brief 读缓冲区中的HTTP/1.1请求头是否还没有读完(需要等待更多数据)
+  /// 超过kMaxHeaderSize时返回false, 交给解析返回400, 不无限制地等待
+  ///
+  bool IsHeaderIncomplete() const;
+
+  ///
+  /// @brief 读缓冲区中的请求由哪个执行器处理(见Router::Executor)
+  /// 请求头不完整、没有匹配的路由都返回IO; HTTP/2连接返回暂存的流的执行器, 没有暂存的流时返回IO
+  ///
+  Router::Executor GetExecutor() const;
+
+  /// @brief HTTP/2连接上是否有暂存的流(路由到DB/CPU执行器, 需要交给对应的线程池处理, 见bulkheads)
+  bool HasDeferredStreams() const;
+
+  ///
+  /// @brief 拒绝读缓冲区中的请求: 丢弃未处理的数据, 输出队列中写入预先生成的响应, 发送完后关闭连接
+  /// HTTP/2连接上改为拒绝暂存的流(RST_STREAM), 不关闭连接
+  /// @param response 完整的响应(如503), 应带有Connection: close
+  ///
+  void Reject(const char* response, size_t len);
+
+  ///
+  /// @brief 连接空闲(等待下一个请求)时释放多余的内存: 超过max_capacity的读缓冲区/输出队列重新分配为初始大小
+  /// @return 读缓冲区和输出队列占用的内存, 单位: 字节
+  ///
+  size_t ShrinkBuffers(size_t max_capacity);
+
+  /// @brief 读缓冲区中是否有未处理的数据
+  inline bool HasPendingInput() const { return read_buff_.ReadableBytes() > 0; }
+
   inline ssize_t Read(int* save_errno) {
+    if (tls_) {
+      return ReadTls_(save_errno);
+    }
     ssize_t len = -1;
     do {
       len = read_buff_.ReadFd(fd_, save_errno);
       if(len <= 0) { // 没有数据可读, 退出
         break;
       }
+      Metrics::Add(Metrics::BYTES_READ, len);
     } while (is_ET);
     return len;
   }
 
-  inline void Close() {
-    response_.UnmapFile();
-    if (!is_close_) {
-      is_close_ = true;
-      --user_count;
-      close(fd_);
-      LOG_INFO("Client[%d](%s:%d) quit, user count: %d", GetFd(), GetIP(), GetPort(), static_cast<int>(user_count));
-    }
-  }
+  /// @return 是否由这次调用关闭(之前没有关闭)
+  bool Close();
 
   inline int GetFd() const { return fd_; }
 
@@ -58,29 +108,66 @@ class HttpConn {
   inline sockaddr_in GetAddr() const { return addr_; }
 
   /// @brief 要写入的大小
-  inline size_t ToWriteBytes() const { return iov_[0].iov_len + iov_[1].iov_len; }
+  inline size_t ToWriteBytes() const { return out_.Bytes(); }
 
-  inline bool IsKeepAlive() const { return request_.IsKeeyAlive(); }
+  bool IsKeepAlive() const;
+
+  /// @brief 是否已切换到HTTP/2
+  inline bool IsHttp2() const { return static_cast<bool>(h2_); }
+
+  /// @brief TLS握手是否未完成(握手的计算量较大, 不在事件循环线程上进行)
+  inline bool IsTlsHandshaking() const { return tls_ && !tls_->IsEstablished(); }
 
  public:
+  /// LT模式下一次Write最多发送的字节数, 剩下的等下一次可写事件, 避免一个大文件占住线程
+  static const size_t kWriteBudget = 256 * 1024;
+
+  /// 等待请求头读完的最大长度
+  static const size_t kMaxHeaderSize = 64 * 1024;
+
   static bool is_ET;
+  static bool tcp_cork;   // 需要多次系统调用发送的响应, 发送期间开启TCP_CORK(见ServerOptions::tcp_cork)
+  static bool bulkheads;  // 配置了DB/CPU线程池: HTTP/2连接上路由到这些执行器的流暂存起来, 交给对应的线程池
   static const char* kSrcDir;
   static std::atomic<int> user_count;
 
+ private:
+  /// @brief 处理HTTP/2连接上的帧
+  bool ProcessHttp2_();
+
+  ///
+  /// @brief 不解析整个请求, 只根据请求行查找路由
+  /// @param method 请求方法, nullptr: 不限制(否则请求方法不是method时返回nullptr)
+  /// @param path 请求路径
+  /// @return 请求头不完整或没有匹配的路由时返回nullptr
+  ///
+  const Router::Route* PeekRoute_(const char* method, std::string* path) const;
+
+  /// @brief 从TLS连接读取(解密)
+  ssize_t ReadTls_(int* save_errno);
+
+  /// @brief 通过TLS连接发送(用户态加密)
+  ssize_t WriteTls_(int* save_errno);
+
+  /// @brief 开启/取消TCP_CORK, 取消时内核立即发出积攒的数据
+  void SetCork_(bool on);
+
  private:
   int fd_;
   struct sockaddr_in addr_; // 请求端信息
 
   bool is_close_;
-
-  int iov_cnt_{};
-  struct iovec iov_[2]{};
+  bool corked_;   // 是否开启了TCP_CORK
 
   Buffer read_buff_;  // 读缓冲区
-  Buffer write_buff_; // 写缓冲区
+  OutputQueue out_;   // 待发送的响应: 响应头部, 共享的缓存文件, 文件区间
 
   HttpRequest request_;
   HttpResponse response_;
+  std::string peek_path_; // CanProcessInline查找路由用的路径, 复用容量
+
+  std::unique_ptr<Http2Session> h2_;  // 切换到HTTP/2(h2c)后的连接状态
+  std::unique_ptr<TlsConn> tls_;      // 开启TLS时的连接状态, 读写经过它加解密
 };
 
 #endif //WEBSERVERCPP11_SRC_HTTP_HTTP_CONN_H_
@@ -0,0 +1,112 @@
+// =============================================================================
+// Created by yangb on 2021/4/29.
+// =============================================================================
+
+#include <cassert>
+#include <cstring>
+#include <strings.h>
+#include "http_headers.h"
+
+namespace {
+
+const char* const kNames[HttpHeaders::KNOWN_COUNT] = {
+    "Host", "Connection", "Content-Length", "Content-Type", "Transfer-Encoding", "Accept", "Accept-Encoding",
+    "Range", "If-Range", "If-None-Match", "If-Modified-Since", "Cache-Control", "Upgrade", "HTTP2-Settings",
+    "Expect", "Cookie", "Authorization", "User-Agent", "Referer", "Origin",
+};
+
+const size_t kTableSize = 64;
+
+///
+/// @brief 名称的哈希: 长度 + 首字母 + 尾字母 * 4 (小写), 对上面的名称没有冲突
+/// 只需要读两个字节, 命中之后再用strncasecmp确认
+///
+inline size_t NameHash(const char* name, size_t len) {
+  return (len + (name[0] | 0x20) + (name[len - 1] | 0x20) * 4) & (kTableSize - 1);
+}
+
+struct Table {
+  uint8_t ids[kTableSize];
+
+  Table() {
+    memset(ids, HttpHeaders::UNKNOWN, sizeof(ids));
+    for (int id = 0; id < HttpHeaders::KNOWN_COUNT; ++id) {
+      size_t slot = NameHash(kNames[id], strlen(kNames[id]));
+      assert(ids[slot] == HttpHeaders::UNKNOWN); // 添加头部后冲突时需要调整NameHash
+      ids[slot] = static_cast<uint8_t>(id);
+    }
+  }
+};
+
+/// @brief 第一次调用时构造(其他编译单元的静态初始化中调用也是安全的)
+const Table& GetTable() {
+  static const Table table;
+  return table;
+}
+
+} // namespace
+
+HttpHeaders::HttpHeaders(Arena* arena)
+    : arena_(arena), present_(0), count_(0), others_(ArenaAllocator<Field>(arena)) {
+  static_assert(KNOWN_COUNT <= 32, "present_ has 32 bits");
+  Clear();
+}
+
+HttpHeaders::Id HttpHeaders::Lookup(const char* name, size_t len) {
+  if (len == 0) {
+    return UNKNOWN;
+  }
+  Id id = static_cast<Id>(GetTable().ids[NameHash(name, len)]);
+  if (id != UNKNOWN && strlen(kNames[id]) == len && strncasecmp(kNames[id], name, len) == 0) {
+    return id;
+  }
+  return UNKNOWN;
+}
+
+const char* HttpHeaders::Name(Id id) {
+  return id < KNOWN_COUNT ? kNames[id] : "";
+}
+
+void HttpHeaders::Clear() {
+  present_ = 0;
+  count_ = 0;
+  for (Value& value : known_) {
+    value.data = "";
+    value.size = 0;
+  }
+  // 数组的内存属于arena, 换一个空数组, 旧的随arena回收
+  others_ = Fields(ArenaAllocator<Field>(arena_));
+}
+
+void HttpHeaders::Set(const char* name, size_t name_len, const char* value, size_t value_len) {
+  Value copy = {Copy_(value, value_len), value_len};
+  Id id = Lookup(name, name_len);
+  if (id != UNKNOWN) {
+    count_ += !Has(id);
+    present_ |= 1u << id;
+    known_[id] = copy;
+    return;
+  }
+  // 不去重(头部数量由请求决定, 每次线性查找是O(n^2)), Get从后往前查找, 结果同样是最后一个
+  others_.push_back(Field{Copy_(name, name_len), name_len, copy});
+}
+
+const char* HttpHeaders::Get(const char* name, size_t len) const {
+  Id id = Lookup(name, len);
+  if (id != UNKNOWN) {
+    return Get(id);
+  }
+  for (auto it = others_.rbegin(); it != others_.rend(); ++it) {
+    if (it->name_len == len && strncasecmp(it->name, name, len) == 0) {
+      return it->value.data;
+    }
+  }
+  return "";
+}
+
+const char* HttpHeaders::Copy_(const char* str, size_t len) {
+  char* copy = static_cast<char*>(arena_->Allocate(len + 1, 1));
+  memcpy(copy, str, len);
+  copy[len] = '\0';
+  return copy;
+}
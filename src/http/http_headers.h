@@ -0,0 +1,102 @@
+// =============================================================================
+// Created by yangb on 2021/4/29.
+// 请求头部: 常用头部按枚举存放, 其他头部放在数组中, 名称不区分大小写
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_HTTP_HTTP_HEADERS_H_
+#define WEBSERVERCPP11_SRC_HTTP_HTTP_HEADERS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../buffer/arena.h"
+
+///
+/// @brief 请求头部
+/// 解析时识别服务器自己会用到的头部, 按Id存放在定长数组中, 访问是一次数组下标;
+/// 其他头部按出现顺序放在数组中(同名的不去重), 按名称从后往前线性查找.
+/// 名称和值都复制到arena中(以'\0'结尾), Clear之后随arena一起回收.
+/// 同名的头部出现多次时取最后一个.
+///
+class HttpHeaders {
+ public:
+  /// @brief 识别的头部
+  enum Id {
+    HOST = 0,
+    CONNECTION,
+    CONTENT_LENGTH,
+    CONTENT_TYPE,
+    TRANSFER_ENCODING,
+    ACCEPT,
+    ACCEPT_ENCODING,
+    RANGE,
+    IF_RANGE,
+    IF_NONE_MATCH,
+    IF_MODIFIED_SINCE,
+    CACHE_CONTROL,
+    UPGRADE,
+    HTTP2_SETTINGS,
+    EXPECT,
+    COOKIE,
+    AUTHORIZATION,
+    USER_AGENT,
+    REFERER,
+    ORIGIN,
+    KNOWN_COUNT,  // 识别的头部数量
+    UNKNOWN = KNOWN_COUNT,
+  };
+
+  explicit HttpHeaders(Arena* arena);
+
+  /// @brief 名称对应的Id(不区分大小写), 不识别时返回UNKNOWN
+  static Id Lookup(const char* name, size_t len);
+
+  /// @brief Id对应的规范名称, e.g. Content-Type
+  static const char* Name(Id id);
+
+  /// @brief 清空, 在arena Reset之前或之后调用都可以
+  void Clear();
+
+  /// @brief 添加一个头部, 已识别的头部直接替换
+  void Set(const char* name, size_t name_len, const char* value, size_t value_len);
+
+  /// @brief 是否存在
+  inline bool Has(Id id) const { return (present_ >> id) & 1; }
+
+  /// @brief 头部的值, 不存在时返回""
+  inline const char* Get(Id id) const { return known_[id].data; }
+
+  inline size_t Size(Id id) const { return known_[id].size; }
+
+  /// @brief 任意头部的值(不区分大小写), 不存在时返回""
+  const char* Get(const char* name, size_t len) const;
+
+  /// @brief 头部的数量(未识别的同名头部按出现次数计)
+  inline size_t Count() const { return count_ + others_.size(); }
+
+ private:
+  struct Value {
+    const char* data;
+    size_t size;
+  };
+
+  struct Field {
+    const char* name;
+    size_t name_len;
+    Value value;
+  };
+
+  typedef std::vector<Field, ArenaAllocator<Field>> Fields;
+
+  /// @brief 复制到arena中, 以'\0'结尾
+  const char* Copy_(const char* str, size_t len);
+
+ private:
+  Arena* arena_;
+  uint32_t present_;          // 第i位: known_[i]是否存在
+  size_t count_;              // 存在的已识别头部数量
+  Value known_[KNOWN_COUNT];  // 不存在时为{"", 0}
+  Fields others_;
+};
+
+#endif //WEBSERVERCPP11_SRC_HTTP_HTTP_HEADERS_H_
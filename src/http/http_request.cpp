@@ -4,49 +4,53 @@
 
 #include "http_request.h"
 #include <algorithm>
-#include <regex>
+#include <cstring>
+#include <sstream>
+#include "../metrics/metrics.h"
 
-const std::unordered_set<std::string> HttpRequest::kDefaultHtml{  // NOLINT
-    "/index", "/register", "/login",
-    "/welcome", "/video", "/picture",
-};
+namespace {
 
-const std::unordered_map<std::string, int> HttpRequest::kDefaultHtmlTag{  // NOLINT
-    {"/register.html", 0},
-    {"/login.html", 1},
-};
+/// 哈希表的初始桶数, 常见的请求不需要rehash
+const size_t kInitBuckets = 16;
+
+} // namespace
 
 void HttpRequest::Init() {
   state_ = REQUEST_LINE;
-  header_.clear();
+  method_.clear();
+  path_.clear();
+  version_.clear();
+  body_.clear();
+  // 先释放节点(析构时还会访问节点)再回收arena, 之后重新从arena分配桶
+  header_.Clear();
   post_.clear();
+  arena_.Reset();
+  post_ = StringMap(kInitBuckets, ArenaStringHash(), std::equal_to<ArenaString>(),
+                    ArenaAllocator<StringMap::value_type>(&arena_));
 }
 
 bool HttpRequest::Parse(Buffer& buff) {
-  const char kCRLF[] = "\r\n";
   if (buff.ReadableBytes() <= 0) {
     return false;
   }
 
   while (buff.ReadableBytes() && state_ != FINISH) {
     // 寻找到空行, 一行一行解析
-    const char* line_end = std::search(buff.Peek(), buff.BeginWriteConst(), kCRLF, kCRLF + 2);
-    std::string line(buff.Peek(), line_end);
+    const char* line_end = Scan::FindCRLF(buff.Peek(), buff.BeginWriteConst());
     switch (state_) {
       case REQUEST_LINE:
-        if (!ParseRequestLine_(line)) {
+        if (!ParseRequestLine_(buff.Peek(), line_end)) {
           return false;
         }
-        ParsePath_();
         break;
       case HEADERS:
-        ParseHeader_(line);
+        ParseHeader_(buff.Peek(), line_end);
         if (buff.ReadableBytes() <= 2) { // GET请求
           state_ = FINISH;
         }
         break;
       case BODY:
-        ParseBody_(line);
+        ParseBody_(buff.Peek(), line_end);
         break;
       default:
         break;
@@ -60,27 +64,19 @@ bool HttpRequest::Parse(Buffer& buff) {
   return true;
 }
 
-void HttpRequest::ParsePath_() {
-  if (path_ == "/") {
-    path_ = "/index.html";
-  } else {
-    for (const auto& item : kDefaultHtml) {
-      if (item == path_) {
-        path_ += ".html";
-        break;
-      }
-    }
-  }
-}
-
-bool HttpRequest::ParseRequestLine_(const std::string& line) {
+bool HttpRequest::ParseRequestLine_(const char* begin, const char* end) {
   // e.g GET /562f25980001b1b106000338.jpg HTTP/1.1
-  std::regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-  std::smatch sub_match;
-  if (std::regex_match(line, sub_match, patten)) {
-    method_ = sub_match[1];   // 请求方法, e.g. GET
-    path_ = sub_match[2];     // 请求路径, e.g. /562f25980001b1b106000338.jpg
-    version_ = sub_match[3];  // http版本号, e.g. 1.1
+  // 与正则 ^([^ ]*) ([^ ]*) HTTP/([^ ]*)$ 等价: 恰好两个空格, 第三部分以HTTP/开头
+  static const char kProtocol[] = "HTTP/";
+  const size_t protocol_len = sizeof(kProtocol) - 1;
+  const char* method_end = Scan::FindChar(begin, end, ' ');
+  const char* path_end = method_end == end ? end : Scan::FindChar(method_end + 1, end, ' ');
+  if (path_end != end && static_cast<size_t>(end - path_end - 1) >= protocol_len
+      && memcmp(path_end + 1, kProtocol, protocol_len) == 0
+      && Scan::FindChar(path_end + 1, end, ' ') == end) {
+    method_.assign(begin, method_end);                           // 请求方法, e.g. GET
+    path_.assign(method_end + 1, path_end);                      // 请求路径, e.g. /562f25980001b1b106000338.jpg
+    version_.assign(path_end + 1 + protocol_len, end);  // http版本号, e.g. 1.1
     // 转移到下一个状态：解析请求头部
     state_ = HEADERS;
     return true;
@@ -91,21 +87,25 @@ bool HttpRequest::ParseRequestLine_(const std::string& line) {
   return false;
 }
 
-void HttpRequest::ParseHeader_(const std::string& line) {
-  std::regex patten("^([^:]*): ?(.*)$");
-  std::smatch sub_match;
-  if (std::regex_match(line, sub_match, patten)) {
-    header_[sub_match[1]] = sub_match[2];
-  } else {
+void HttpRequest::ParseHeader_(const char* begin, const char* end) {
+  // e.g. Host: 127.0.0.1:12345, 名称为第一个':'之前的部分, 值前面最多跳过一个空格
+  const char* colon = Scan::FindChar(begin, end, ':');
+  if (colon == end) {
     state_ = BODY;  // 处理完了，转换到下一状态
+    return;
+  }
+  const char* value = colon + 1;
+  if (value < end && *value == ' ') {
+    ++value;
   }
+  header_.Set(begin, colon - begin, value, end - value);
 }
 
-void HttpRequest::ParseBody_(const std::string& line) {
-  body_ = line;
+void HttpRequest::ParseBody_(const char* begin, const char* end) {
+  body_.assign(begin, end);
   ParsePost_();
   state_ = FINISH;
-  LOG_DEBUG("Body: %s, len: %d", line.c_str(), line.size());
+  LOG_DEBUG("Body: %s, len: %d", body_.c_str(), body_.size());
 }
 
 void HttpRequest::ParsePost_() {
@@ -114,69 +114,46 @@ void HttpRequest::ParsePost_() {
   // Content-Type: application/x-www-form-urlencoded;charset=utf-8
   // title=test&sub%5B%5D=1&sub%5B%5D=2&sub%5B%5D=3
   //
-  if (method_ == "POST" && header_["Content-Type"] == "application/x-www-form-urlencoded") {
+  // 登录/注册等表单由Router中注册的处理函数处理
+  if (method_ != "POST") {
+    return;
+  }
+  if (strcasecmp(header_.Get(HttpHeaders::CONTENT_TYPE), "application/x-www-form-urlencoded") == 0) {
     ParseFromUrlencoded_();
-    if (kDefaultHtmlTag.count(path_)) {
-      int tag = kDefaultHtmlTag.find(path_)->second;
-      LOG_DEBUG("Tag: %d", tag);
-      if (tag == 0 || tag == 1) {
-        bool is_login = (tag == 1);
-        if (UserVerify_(post_["username"], post_["password"], is_login)) {
-          path_ = "/welcome.html";
-        } else {
-          path_ = "/error.html";
-        }
-      } // if
-    } // if
-  } // if
+  }
 }
 
 void HttpRequest::ParseFromUrlencoded_() {
-  if (body_.empty()) {
-    return;
+  // e.g. username=a+b&password=%E4%BD%A0, 先按'&'和'='分割再分别解码, 值中编码的'&'和'='不会被当作分隔符
+  const char* p = body_.data();
+  const char* end = p + body_.size();
+  while (p < end) {
+    const char* pair_end = Scan::FindChar(p, end, '&');
+    const char* eq = Scan::FindChar(p, pair_end, '=');
+    if (eq != p) {  // 跳过空的键
+      ArenaString key = UrlDecode_(p, eq);
+      ArenaString value = UrlDecode_(eq == pair_end ? pair_end : eq + 1, pair_end);
+      LOG_DEBUG("%s = %s", key.c_str(), value.c_str());
+      auto it = post_.find(key);
+      if (it != post_.end()) {
+        it->second = std::move(value);
+      } else {
+        post_.emplace(std::move(key), std::move(value));
+      }
+    }
+    p = pair_end + 1;
   }
+}
 
-  std::string key;
-  std::string value;
-  int num;
-  int n = body_.size();
-  int i = 0;
-  int j = 0;
-
-  for (; i < n; ++i) {
-    char ch = body_[i];
-    switch (ch) {
-      case '=':
-        key = body_.substr(j, i - j);
-        j = i + 1;
-        break;
-      case '+':
-        body_[i] = ' ';
-        break;
-      case '%':
-        num = ConverHex_(body_[i + 1]) * 16 + ConverHex_(body_[i + 2]);
-        body_[i + 2] = num % 10 + '0';
-        body_[i + 2] = num / 10 + '0';
-        i += 2;
-        break;
-      case '&':
-        value = body_.substr(j, i - j);
-        j = i + 1;
-        post_[key] = value;
-        LOG_DEBUG("%s = %s", key.c_str(), value.c_str());
-        break;
-      default:
-        break;
-    } // switch
-  } // for
-  assert(j <= i);
-  if (post_.count(key) == 0 && j < i) {
-    value = body_.substr(j, i - j);
-    post_[key] = value;
+ArenaString HttpRequest::UrlDecode_(const char* begin, const char* end) {
+  ArenaString out(end - begin, '\0', ArenaAllocator<char>(&arena_));
+  if (!out.empty()) {
+    out.resize(Scan::UrlDecode(begin, end - begin, &out[0]));
   }
+  return out;
 }
 
-bool HttpRequest::UserVerify_(const std::string& name, const std::string& passwd, bool is_login) {
+bool HttpRequest::UserVerify(const std::string& name, const std::string& passwd, bool is_login) {
   if (name.empty() || passwd.empty()) {
     return false;
   }
@@ -196,7 +173,10 @@ bool HttpRequest::UserVerify_(const std::string& name, const std::string& passwd
   snprintf(order, sizeof(order), "SELECT username, passwd FROM user WHERE username='%s' LIMIT 1", name.c_str());
   LOG_DEBUG("%s", order);
 
-  if (mysql_query(sql, order)) {
+  int64_t query_start = Metrics::NowNs();
+  int query_ret = mysql_query(sql, order);
+  Metrics::Observe(Metrics::SQL_QUERY, Metrics::NowNs() - query_start);
+  if (query_ret) {
     mysql_free_result(res);
     return false;
   }
@@ -232,7 +212,10 @@ bool HttpRequest::UserVerify_(const std::string& name, const std::string& passwd
              name.c_str(),
              passwd.c_str());
     LOG_DEBUG("%s", order);
-    if (mysql_query(sql, order)) {
+    query_start = Metrics::NowNs();
+    query_ret = mysql_query(sql, order);
+    Metrics::Observe(Metrics::SQL_QUERY, Metrics::NowNs() - query_start);
+    if (query_ret) {
       LOG_DEBUG("Insert error!");
       flag = false;
     }
@@ -6,12 +6,15 @@
 #define WEBSERVERCPP11_SRC_HTTP_HTTP_REQUEST_H_
 
 #include <unordered_map>
-#include <unordered_set>
 #include <cassert>
+#include <strings.h>
 #include <mysql/mysql.h>
 #include "../buffer/buffer.h"
 #include "../pool/sql_conn_raii.h"
 #include "../log/log.h"
+#include "../buffer/arena.h"
+#include "http_headers.h"
+#include "scan.h"
 
 ///
 /// Reference: https://mp.weixin.qq.com/s/BfnNl-3jc_x5WPrWEJGdzQ
@@ -58,19 +61,27 @@ class HttpRequest {
     CLOSED_CONNECTION,
   };
 
-  HttpRequest() { Init(); }
+  HttpRequest() : header_(&arena_) { Init(); }
   ~HttpRequest() = default;
 
+  /// @brief 开始解析新的请求, 上一个请求的头部/数据占用的内存一次性回收
   void Init();
 
   /// @brief 解析
   bool Parse(Buffer& buff);
 
-  /// @brief get file path
-  inline std::string GetPath() const { return path_; }
+  /// @brief 请求路径, 对应的文件或处理函数由Router确定
+  inline const std::string& GetPath() const { return path_; }
 
-  /// @brief get file path
-  inline std::string& GetPath() { return path_; }
+  /// @brief 请求头部中的值(名称不区分大小写), 不存在时返回空字符串
+  inline std::string GetHeader(const std::string& key) const {
+    return header_.Get(key.data(), key.size());
+  }
+
+  /// @brief 识别的请求头部中的值, 不存在时返回"", 不需要查找
+  inline const char* GetHeader(HttpHeaders::Id id) const { return header_.Get(id); }
+
+  inline const HttpHeaders& GetHeaders() const { return header_; }
 
   /// @brief GET or POST
   inline std::string GetMethod() const { return method_; }
@@ -81,64 +92,56 @@ class HttpRequest {
   /// @brief get POST request data value
   inline std::string GetPost(const char* key) const {
     assert(key != "");
-    if (post_.count(key) == 1) {
-      return post_.find(key)->second;
-    }
-    return "";
+    auto it = post_.find(ArenaString(key));
+    return it == post_.end() ? "" : std::string(it->second.data(), it->second.size());
   }
 
   inline std::string GetPost(const std::string& key) const {
     return GetPost(key.c_str());
   }
 
+  /// @brief 用户身份验证(查询数据库)
+  /// @param is_login true: 登录, 检查密码; false: 注册, 用户名未被使用时插入
+  static bool UserVerify(const std::string& name, const std::string& passwd, bool is_login);
+
   inline bool IsKeeyAlive() const {
-    if (header_.count("Connection") == 1) {
-      return header_.find("Connection")->second == "keep-alive" && version_ == "1.1";
-    }
-    return false;
+    return strcasecmp(header_.Get(HttpHeaders::CONNECTION), "keep-alive") == 0 && version_ == "1.1";
   }
 
  private:
-  /// @brief 十六进制 大于10部分将字符转换为数字, e.g. B = 11, c= 12
-  inline static int ConverHex_(char ch) {
-    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
-    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
-    return ch;
-  }
-
-  /// @brief 用户身份验证
-  static bool UserVerify_(const std::string& name, const std::string& passwd, bool is_login);
+  /// 键和值都从arena_分配的哈希表(POST数据)
+  typedef std::unordered_map<ArenaString, ArenaString, ArenaStringHash, std::equal_to<ArenaString>,
+                             ArenaAllocator<std::pair<const ArenaString, ArenaString>>> StringMap;
 
   /// @brief 解析 请求行
-  bool ParseRequestLine_(const std::string& line);
+  bool ParseRequestLine_(const char* begin, const char* end);
 
   /// @brief 解析 请求头部
-  void ParseHeader_(const std::string& line);
+  void ParseHeader_(const char* begin, const char* end);
 
   /// @brief 解析 请求数据
-  void ParseBody_(const std::string& line);
+  void ParseBody_(const char* begin, const char* end);
 
   /// @brief 解析 POST 方法的请求数据
   void ParsePost_();
 
-  /// @brief 解析路径 在路径名(path_)后加上.html
-  void ParsePath_();
-
   /// @brief 解析Content-Type:application/x-www-form-urlencoded编码的数据
   void ParseFromUrlencoded_();
 
+  /// @brief URL解码到从arena_分配的字符串
+  ArenaString UrlDecode_(const char* begin, const char* end);
+
  private:
   PaserState state_{};
   std::string method_{};  // GET or POST
   std::string path_{};    // file path
   std::string version_{}; // HTTP version e.g. 1.1
   std::string body_{};    // request data body
+  // 以上字符串在请求之间保留容量, 不会重新分配
 
-  std::unordered_map<std::string, std::string> header_{}; // 请求头部中的值
-  std::unordered_map<std::string, std::string> post_{};   // POST方法中请求数据部分的值
-
-  static const std::unordered_set<std::string> kDefaultHtml;  // 默认网页
-  static const std::unordered_map<std::string, int> kDefaultHtmlTag;  // key: 网页.html   value: int
+  Arena arena_{};   // 请求范围内的内存, 必须在使用它的容器之前声明
+  HttpHeaders header_;  // 请求头部中的值
+  StringMap post_{};   // POST方法中请求数据部分的值
 };
 
 #endif //WEBSERVERCPP11_SRC_HTTP_HTTP_REQUEST_H_
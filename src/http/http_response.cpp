@@ -4,33 +4,9 @@
 
 
 #include <cassert>
+#include <cstring>
 #include "http_response.h"
-
-///
-/// @brief: HTTP Content-Type
-/// Reference: https://tool.oschina.net/commons
-///
-const std::unordered_map<std::string, std::string> HttpResponse::kSuffixType_ = { // NOLINT
-    {".html", "text/html"},
-    {".xml", "text/xml"},
-    {".xhtml", "application/xhtml+xml"},
-    {".txt", "text/plain"},
-    {".rtf", "application/rtf"},
-    {".pdf", "application/pdf"},
-    {".word", "application/nsword"},
-    {".png", "image/png"},
-    {".gif", "image/gif"},
-    {".jpg", "image/jpeg"},
-    {".jpeg", "image/jpeg"},
-    {".au", "audio/basic"},
-    {".mpeg", "video/mpeg"},
-    {".mpg", "video/mpeg"},
-    {".avi", "video/x-msvideo"},
-    {".gz", "application/x-gzip"},
-    {".tar", "application/x-tar"},
-    {".css", "text/css "},
-    {".js", "text/javascript "},
-};
+#include "../metrics/metrics.h"
 
 ///
 /// @brief Http信息响应
@@ -38,6 +14,7 @@ const std::unordered_map<std::string, std::string> HttpResponse::kSuffixType_ =
 ///
 const std::unordered_map<int, std::string> HttpResponse::kCodeStatus_ = { // NOLINT
     {200, "OK"},
+    {304, "Not Modified"},
     {400, "Bad Request"},
     {403, "Forbidden"},
     {404, "Not Found"},
@@ -49,7 +26,9 @@ const std::unordered_map<int, std::string> HttpResponse::kCodePath_ = { // NOLIN
     {404, "/404.html"},
 };
 
-HttpResponse::HttpResponse() : code_(-1), is_keep_alive_(false), mm_file_(nullptr) {
+HttpResponse::HttpResponse()
+    : code_(-1), is_keep_alive_(false), content_type_(nullptr), mm_file_(nullptr), file_fd_(-1), use_sendfile_(false),
+      accept_gzip_(false), if_none_match_(nullptr) {
   mm_file_stat_ = {0};
 }
 
@@ -57,24 +36,32 @@ HttpResponse::~HttpResponse() {
   UnmapFile();
 }
 
-void HttpResponse::Init(const std::string& src_dir, std::string& path, bool is_keep_alive, int code) {
+void HttpResponse::Init(const std::string& src_dir, const std::string& path, bool is_keep_alive, int code) {
   assert(!src_dir.empty());
 
-  if (this->mm_file_) {
-    UnmapFile();
-  }
+  UnmapFile();
 
-  this->mm_file_ = nullptr;
   this->code_ = code;
   this->is_keep_alive_ = is_keep_alive;
   this->path_ = path;
   this->src_dir_ = src_dir;
+  this->content_type_ = nullptr;
   this->mm_file_stat_ = {0};
+  this->accept_gzip_ = false;
+  this->if_none_match_ = nullptr;
 }
 
 void HttpResponse::MakeResponse(Buffer& buff) {
-  // 判断请求的资源文件
-  if(stat((src_dir_ + path_).data(), &mm_file_stat_) < 0 || S_ISDIR(mm_file_stat_.st_mode)) { // 文件不存在 or 是文件夹
+  std::shared_ptr<const FileCache::Entry> hint = std::move(hint_);
+  if (code_ == 200 && MakePackedResponse_(buff)) {
+    return;
+  }
+  // 判断请求的资源文件, 命中缓存时使用缓存中的文件信息, 不再stat
+  cached_ = hint && hint_path_ == path_ ? std::move(hint) : FileCache::Instance()->Find(src_dir_.c_str(), path_);
+  if (cached_) {
+    mm_file_stat_ = cached_->st;
+  }
+  if(!cached_ && (stat((src_dir_ + path_).data(), &mm_file_stat_) < 0 || S_ISDIR(mm_file_stat_.st_mode))) { // 文件不存在 or 是文件夹
     code_ = 404;  // File not found
   } else if(!(mm_file_stat_.st_mode & S_IROTH)) { // 没有读的权限
     code_ = 403;  // Forbidden
@@ -84,12 +71,45 @@ void HttpResponse::MakeResponse(Buffer& buff) {
 
   ErrorHtml_();
   AddStateLine_(buff);
-  AddHeader_(buff);
+  AddHeader_(buff, GetFileType_());
   AddContent_(buff);
 }
 
+void HttpResponse::MakeResponse(Buffer& buff, const std::string& body, const std::string& content_type) {
+  AddStateLine_(buff);
+  AddHeader_(buff, content_type.c_str());
+  buff.Append("Content-Length:" + std::to_string(body.size()) + "\r\n\r\n");
+  buff.Append(body);
+}
+
+bool HttpResponse::MakePackedResponse_(Buffer& buff) {
+  ResourcePack* pack = ResourcePack::Instance();
+  if (!pack->IsLoaded() || !pack->Find(path_, accept_gzip_, &packed_)) {
+    return false;
+  }
+  Metrics::Add(Metrics::RESOURCE_PACK_HITS);
+  if (if_none_match_ && ResourcePack::EtagMatches(if_none_match_, packed_)) { // 客户端的缓存仍然有效, 不发送正文
+    Metrics::Add(Metrics::NOT_MODIFIED);
+    code_ = 304;
+    AddStateLine_(buff);
+    AddConnection_(buff);
+    buff.Append("ETag: ");
+    buff.Append(packed_.etag, packed_.etag_len);
+    buff.Append("\r\n\r\n", 4);
+    packed_.body = nullptr;
+    return true;
+  }
+  AddStateLine_(buff);
+  AddConnection_(buff);
+  buff.Append(packed_.head, packed_.head_len);
+  mm_file_stat_.st_size = packed_.body_len;
+  return true;
+}
+
 void HttpResponse::ErrorHtml_() {
   if (kCodePath_.count(code_) == 1) {
+    cached_.reset();
+    content_type_ = nullptr;
     path_ = kCodeStatus_.at(code_);
     stat((src_dir_ + path_).data(), &mm_file_stat_);
   }
@@ -107,7 +127,7 @@ void HttpResponse::AddStateLine_(Buffer& buff) {
   buff.Append("HTTP/1.1 " + std::to_string(code_) + " " + status + "\r\n");
 }
 
-void HttpResponse::AddHeader_(Buffer& buff) {
+void HttpResponse::AddConnection_(Buffer& buff) {
   buff.Append("Connection: ");
   if(is_keep_alive_) {
     buff.Append("keep-alive\r\n");
@@ -115,20 +135,49 @@ void HttpResponse::AddHeader_(Buffer& buff) {
   } else {
     buff.Append("close\r\n");
   }
-  buff.Append("Content-Type: " + GetFileType_() + "\r\n");
+}
+
+void HttpResponse::AddHeader_(Buffer& buff, const char* content_type) {
+  AddConnection_(buff);
+  buff.Append("Content-Type: ");
+  buff.Append(content_type, strlen(content_type));
+  buff.Append("\r\n", 2);
 }
 
 void HttpResponse::AddContent_(Buffer& buff) {
-  int src_fd = open((src_dir_ + path_).data(), O_RDONLY);
-  if(src_fd < 0) {  // 打开文件失败
-    ErrorContent(buff, "File NotFound!");
-    return;
+  if (!cached_) {
+    int src_fd = open((src_dir_ + path_).data(), O_RDONLY);
+    if(src_fd < 0) {  // 打开文件失败
+      ErrorContent(buff, "File NotFound!");
+      return;
+    }
+    // 小文件读入缓存, 大文件仍使用mmap
+    cached_ = FileCache::Instance()->Load(src_dir_ + path_, src_fd, mm_file_stat_);
+    if (!cached_ && use_sendfile_) {  // 发送时由内核从页缓存直接复制到socket
+      file_fd_ = src_fd;
+      buff.Append("Content-Length:" + std::to_string(mm_file_stat_.st_size) + "\r\n\r\n");
+      return;
+    }
+    if (!cached_) {
+      MapFile_(buff, src_fd);
+      return;
+    }
+    close(src_fd);
   }
+  buff.Append("Content-Length:" + std::to_string(cached_->data.size()) + "\r\n\r\n");
+}
+
+void HttpResponse::MapFile_(Buffer& buff, int src_fd) {
 
   LOG_DEBUG("file path: %s", (src_dir_+path_).data());
   // 将文件映射到内存提高文件的访问速度
-  void* mm_ret = (int*)mmap(nullptr, mm_file_stat_.st_size, PROT_READ, MAP_PRIVATE, src_fd, 0);
+  void* mm_ret;
+  {
+    TRACE_SCOPE("mmap");
+    mm_ret = (int*)mmap(nullptr, mm_file_stat_.st_size, PROT_READ, MAP_PRIVATE, src_fd, 0);
+  }
   if(mm_ret == MAP_FAILED) {
+    close(src_fd);
     ErrorContent(buff, "File NoteFound!");
     return;
   }
@@ -138,16 +187,27 @@ void HttpResponse::AddContent_(Buffer& buff) {
   buff.Append("Content-Length:" + std::to_string(mm_file_stat_.st_size) + "\r\n\r\n");
 }
 
-std::string HttpResponse::GetFileType_() {
-  std::string::size_type idx = path_.find_last_of('.');
-  if(idx == std::string::npos) {  // 如果没有类型, 则为纯文本
-    return "text/plain";
+void HttpResponse::MoveBodyTo(OutputQueue& out) {
+  if (packed_.body) {
+    out.AppendShared(ResourcePack::Instance()->Owner(), packed_.body, packed_.body_len);
+    packed_.body = nullptr;
+  } else if (cached_) {
+    const char* data = cached_->data.data();
+    size_t len = cached_->data.size();
+    out.AppendShared(std::move(cached_), data, len);
+  } else if (mm_file_) {
+    size_t len = mm_file_stat_.st_size;
+    out.AppendShared(std::shared_ptr<const void>(mm_file_, [len](char* file) { munmap(file, len); }), mm_file_, len);
+    mm_file_ = nullptr;
+  } else if (file_fd_ >= 0) {
+    out.AppendFile(file_fd_, 0, mm_file_stat_.st_size);
+    file_fd_ = -1;
   }
-  std::string suffix = path_.substr(idx); // 获取后缀(文件类型)
-  if(kSuffixType_.count(suffix) == 1) {
-    return kSuffixType_.at(suffix);
-  }
-  return "text/plain";
+  cached_.reset();
+}
+
+const char* HttpResponse::GetFileType_() const {
+  return content_type_ ? content_type_ : Router::ContentType(path_);
 }
 
 void HttpResponse::ErrorContent(Buffer& buff, const std::string& message) const {
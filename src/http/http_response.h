@@ -5,13 +5,19 @@
 #ifndef WEBSERVERCPP11_SRC_HTTP_HTTP_RESPONSE_H_
 #define WEBSERVERCPP11_SRC_HTTP_HTTP_RESPONSE_H_
 
+#include <memory>
 #include <unordered_map>
 #include <fcntl.h>  // open
 #include <unistd.h> // close
 #include <sys/stat.h> // stat
 #include <sys/mman.h> // mmap, munmap
 #include "../buffer/buffer.h"
+#include "../buffer/output_queue.h"
 #include "../log/log.h"
+#include "../trace/trace.h"
+#include "file_cache.h"
+#include "resource_pack.h"
+#include "router.h"
 
 ///
 /// @brief 服务器响应
@@ -32,19 +38,79 @@ class HttpResponse {
 
   ~HttpResponse();
 
-  void Init(const std::string& src_dir, std::string& path, bool is_keep_alive = false, int code = -1);
+  void Init(const std::string& src_dir, const std::string& path, bool is_keep_alive = false, int code = -1);
+
+  /// @brief 修改要发送的文件(Router中注册的文件或处理函数选择的页面)
+  /// @param content_type 预先确定的Content-Type, nullptr: 按扩展名确定
+  inline void SetFile(const std::string& path, const char* content_type = nullptr) {
+    path_ = path;
+    content_type_ = content_type;
+  }
+
+  ///
+  /// @brief 内容协商, 命中ResourcePack时使用
+  /// @param accept_gzip 客户端是否接受gzip
+  /// @param if_none_match If-None-Match的值, 与ETag匹配时返回304; 需要在MakeResponse之前一直有效
+  ///
+  inline void SetNegotiation(bool accept_gzip, const char* if_none_match) {
+    accept_gzip_ = accept_gzip;
+    if_none_match_ = if_none_match;
+  }
+
+  ///
+  /// @brief 预先查找到的缓存条目(如判断能否快速处理时), 下一次MakeResponse请求的仍是path时直接使用, 不再查找
+  /// Init不清除, 只对下一次MakeResponse有效
+  ///
+  inline void SetCachedHint(const std::string& path, std::shared_ptr<const FileCache::Entry> entry) {
+    hint_path_.assign(path);  // 复用容量
+    hint_ = std::move(entry);
+  }
 
   void MakeResponse(Buffer& buff);
 
+  /// @brief 生成响应正文在内存中的响应(不读取文件)
+  /// @param body 响应正文
+  /// @param content_type 响应正文的Content-Type
+  void MakeResponse(Buffer& buff, const std::string& body, const std::string& content_type);
+
   inline void UnmapFile() {
     if (mm_file_) {
       munmap(mm_file_, mm_file_stat_.st_size);
       mm_file_ = nullptr;
     }
+    if (file_fd_ >= 0) {
+      close(file_fd_);
+      file_fd_ = -1;
+    }
+    cached_.reset();
+    packed_.body = nullptr;
   }
 
-  /// @brief 获取文件
-  inline char* File() const { return mm_file_; }
+  ///
+  /// @brief 未缓存的文件是否只打开不映射, 由MoveBodyTo作为FILE分段交给OutputQueue(sendfile)
+  /// 对之后的请求一直有效; 需要文件内容在内存中时(File(), 如HTTP/2、用户态TLS)不能开启
+  ///
+  inline void SetSendfile(bool sendfile) { use_sendfile_ = sendfile; }
+
+  ///
+  /// @brief 把文件正文追加到out: 缓存的文件和mmap映射的文件作为共享分段(不复制), 打开的文件作为FILE分段
+  /// 之后响应不再持有文件, 可以立即Init下一个请求
+  ///
+  void MoveBodyTo(OutputQueue& out);
+
+  /// @brief 获取文件(ResourcePack中的, mmap映射的或FileCache中的), SetSendfile(true)时未缓存的文件返回nullptr
+  inline char* File() const {
+    if (packed_.body) {
+      return const_cast<char*>(packed_.body);
+    }
+    if (cached_) {
+      return const_cast<char*>(cached_->data.data());
+    }
+    return mm_file_;
+  }
+
+  /// @brief 文件内容是否来自FileCache或ResourcePack
+  inline bool IsCached() const { return cached_ || packed_.body; }
 
   /// @brief 获取文件长度
   inline size_t FileLen() const { return mm_file_stat_.st_size; }
@@ -58,17 +124,30 @@ class HttpResponse {
   /// @brief 添加状态行
   void AddStateLine_(Buffer& buff);
 
+  ///
+  /// @brief 请求的文件在ResourcePack中时, 直接使用包中预先生成的响应头部, 正文不复制;
+  /// If-None-Match与ETag匹配时返回304
+  /// @return 不在包中时返回false
+  ///
+  bool MakePackedResponse_(Buffer& buff);
+
+  /// @brief 添加Connection头部
+  void AddConnection_(Buffer& buff);
+
   /// @brief 添加响应头部
-  void AddHeader_(Buffer& buff);
+  void AddHeader_(Buffer& buff, const char* content_type);
 
   /// @brief 添加响应正文
   void AddContent_(Buffer& buff);
 
+  /// @brief 将文件映射到内存(不缓存的大文件)
+  void MapFile_(Buffer& buff, int src_fd);
+
   /// @brief 请求出错的html网页
   void ErrorHtml_();
 
   /// @brief 请求文件对应的Content-Type类型
-  std::string GetFileType_();
+  const char* GetFileType_() const;
 
  private:
   int code_;  // 状态码
@@ -76,11 +155,19 @@ class HttpResponse {
 
   std::string path_;
   std::string src_dir_;
+  const char* content_type_;  // path_对应的Content-Type, nullptr: 按扩展名确定
 
   char* mm_file_;
+  int file_fd_;       // SetSendfile(true)时未缓存文件的描述符
+  bool use_sendfile_;
   struct stat mm_file_stat_{};
+  std::shared_ptr<const FileCache::Entry> cached_;  // 命中缓存时不使用mm_file_
+  std::shared_ptr<const FileCache::Entry> hint_;    // 见SetCachedHint
+  std::string hint_path_;
+  ResourcePack::File packed_{};  // 命中资源包时的文件, body为nullptr: 没有命中
+  bool accept_gzip_;
+  const char* if_none_match_;
 
-  static const std::unordered_map<std::string, std::string> kSuffixType_; // key: 文件扩展名   value: Content-Type
   static const std::unordered_map<int, std::string> kCodeStatus_;         // key: 状态码      value: 状态码对应的信息
   static const std::unordered_map<int, std::string> kCodePath_;           // key: 状态码      value: 对应网页的路径
 };
@@ -0,0 +1,439 @@
+// =============================================================================
+// Created by yangb on 2021/5/2.
+// =============================================================================
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#ifdef WEBSERVER_ENABLE_GZIP
+#include <zlib.h>
+#endif
+#include "resource_pack.h"
+#include "router.h"
+
+namespace {
+
+const size_t kHugePageSize = 2 * 1024 * 1024;
+
+/// @brief 64位FNV-1a
+inline uint64_t Fnv1a(const char* data, size_t len) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/// @brief 用seed混合路径的哈希值(splitmix64的最后一步), 不同的seed相当于不同的哈希函数
+inline uint64_t Mix(uint64_t base, uint32_t seed) {
+  uint64_t x = base + seed * 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+inline size_t Align8(size_t n) {
+  return (n + 7) & ~static_cast<size_t>(7);
+}
+
+/// @brief 文本类型的内容才压缩, 图片、视频、字体等已经压缩过
+bool Compressible(const char* type) {
+  return strncmp(type, "text/", 5) == 0 || strstr(type, "javascript") || strstr(type, "json")
+      || strstr(type, "xml");
+}
+
+/// @brief gzip压缩, 压缩后没有明显变小时返回false
+bool Gzip(const std::string& data, std::string* out) {
+#ifdef WEBSERVER_ENABLE_GZIP
+  z_stream zs{};
+  if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) { // 15+16: gzip格式
+    return false;
+  }
+  out->resize(deflateBound(&zs, data.size()));
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  zs.avail_in = static_cast<uInt>(data.size());
+  zs.next_out = reinterpret_cast<Bytef*>(&(*out)[0]);
+  zs.avail_out = static_cast<uInt>(out->size());
+  int ret = deflate(&zs, Z_FINISH);
+  out->resize(zs.total_out);
+  deflateEnd(&zs);
+  return ret == Z_STREAM_END && out->size() < data.size() / 10 * 9;
+#else
+  (void) data;
+  (void) out;
+  return false;
+#endif
+}
+
+} // namespace
+
+const char ResourcePack::kMagic[8] = {'W', 'S', 'P', 'A', 'C', 'K', '\0', '\0'};
+
+struct ResourcePack::Source {
+  std::string path;   // 以'/'开头的相对路径
+  std::string data;
+  std::string gzip;   // 压缩后的内容, 为空: 没有压缩版本
+  uint64_t base;      // Fnv1a(path)
+  uint32_t slot;
+};
+
+ResourcePack* ResourcePack::Instance() {
+  static ResourcePack pack;
+  return &pack;
+}
+
+bool ResourcePack::Init(const std::string& root, const char* pack_file, size_t max_file) {
+  Clear();
+  size_t size = 0;
+  if (pack_file) {
+    auto image = MapFile_(pack_file, &size);
+    if (image && Attach_(std::move(image), size)) {
+      return true;
+    }
+  }
+
+  // 没有资源包文件(或格式不对), 遍历资源目录生成
+  std::vector<Source> files;
+  Walk_(root, "", max_file, &files);
+  std::string built = Build_(files);
+  if (built.empty()) {
+    return false;
+  }
+  if (pack_file && Save_(pack_file, built)) {
+    auto image = MapFile_(pack_file, &size);
+    if (image && Attach_(std::move(image), size)) {
+      return true;
+    }
+  }
+  auto image = MapAnonymous_(built);
+  return image && Attach_(std::move(image), built.size());
+}
+
+bool ResourcePack::Find(const char* path, size_t len, bool gzip, File* file) const {
+  if (!header_ || header_->count == 0) {
+    return false;
+  }
+  uint64_t base = Fnv1a(path, len);
+  uint32_t seed = seeds_[Mix(base, 0) % header_->buckets];
+  const Entry& entry = entries_[Mix(base, seed) % header_->count];
+  const char* image = reinterpret_cast<const char*>(header_);
+  // 不在包中的路径也会落到某个槽上, 需要比较路径
+  if (entry.path_len != len || memcmp(image + entry.path_off, path, len) != 0) {
+    return false;
+  }
+  int v = gzip && entry.body_len[1] > 0 ? 1 : 0;
+  file->head = image + entry.head_off[v];
+  file->head_len = entry.head_len[v];
+  file->body = image + entry.body_off[v];
+  file->body_len = entry.body_len[v];
+  file->etag = image + entry.etag_off[v];
+  file->etag_len = entry.etag_len[v];
+  return true;
+}
+
+void ResourcePack::Clear() {
+  header_ = nullptr;
+  seeds_ = nullptr;
+  entries_ = nullptr;
+  image_.reset();
+}
+
+bool ResourcePack::AcceptsGzip(const char* accept_encoding) {
+  const char* p = accept_encoding;
+  while ((p = strstr(p, "gzip")) != nullptr) {
+    p += 4;
+    while (*p == ' ') {
+      ++p;
+    }
+    if (strncmp(p, ";q=0", 4) != 0) {
+      return true;
+    }
+    // q=0.xxx中有非0数字时仍然接受
+    p += 4;
+    if (*p == '.') {
+      for (++p; *p >= '0' && *p <= '9'; ++p) {
+        if (*p != '0') {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+bool ResourcePack::EtagMatches(const char* if_none_match, const File& file) {
+  if (if_none_match[0] == '*' && if_none_match[1] == '\0') {
+    return true;
+  }
+  // 列表中的每一项都带引号(可能有W/前缀), 按带引号的整体查找即可
+  const char* p = if_none_match;
+  while ((p = strstr(p, "\"")) != nullptr) {
+    if (strncmp(p, file.etag, file.etag_len) == 0) {
+      return true;
+    }
+    const char* end = strchr(p + 1, '"');
+    if (!end) {
+      break;
+    }
+    p = end + 1;
+  }
+  return false;
+}
+
+size_t ResourcePack::Count() const {
+  return header_ ? header_->count : 0;
+}
+
+size_t ResourcePack::Bytes() const {
+  return header_ ? header_->size : 0;
+}
+
+void ResourcePack::Walk_(const std::string& root, const std::string& dir, size_t max_file,
+                         std::vector<Source>* files) {
+  DIR* dp = opendir((root + dir).c_str());
+  if (dp == nullptr) {
+    return;
+  }
+  std::vector<std::string> names;
+  while (struct dirent* entry = readdir(dp)) {
+    if (entry->d_name[0] != '.') {  // 跳过., ..和隐藏文件
+      names.emplace_back(entry->d_name);
+    }
+  }
+  closedir(dp);
+
+  for (const std::string& name : names) {
+    std::string path = dir + "/" + name;
+    struct stat st{};
+    if (stat((root + path).c_str(), &st) < 0 || !(st.st_mode & S_IROTH)) { // 与HttpResponse一样, 只提供其他人可读的文件
+      continue;
+    }
+    if (S_ISDIR(st.st_mode)) {
+      Walk_(root, path, max_file, files);
+      continue;
+    }
+    if (!S_ISREG(st.st_mode) || static_cast<size_t>(st.st_size) > max_file) {
+      continue;
+    }
+    int fd = open((root + path).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      continue;
+    }
+    Source source;
+    source.path = path;
+    source.data.resize(st.st_size);
+    size_t offset = 0;
+    while (offset < source.data.size()) {
+      ssize_t len = read(fd, &source.data[offset], source.data.size() - offset);
+      if (len < 0 && errno == EINTR) {
+        continue;
+      }
+      if (len <= 0) {
+        break;
+      }
+      offset += len;
+    }
+    close(fd);
+    if (offset == source.data.size()) {
+      files->push_back(std::move(source));
+    }
+  }
+}
+
+std::string ResourcePack::Build_(std::vector<Source>& files) {
+  // 完美哈希(hash and displace): 先按Mix(base, 0)分桶, 从大桶开始为每个桶找一个种子,
+  // 使桶内所有路径用Mix(base, seed)都落到不同的空槽上. 槽数等于文件数, 没有空槽
+  const uint32_t count = static_cast<uint32_t>(files.size());
+  const uint32_t buckets = count / 2 + 1;
+  std::vector<std::vector<uint32_t>> members(buckets);
+  for (uint32_t i = 0; i < count; ++i) {
+    files[i].base = Fnv1a(files[i].path.data(), files[i].path.size());
+    members[Mix(files[i].base, 0) % buckets].push_back(i);
+  }
+  std::vector<uint32_t> order(buckets);
+  for (uint32_t b = 0; b < buckets; ++b) {
+    order[b] = b;
+  }
+  std::stable_sort(order.begin(), order.end(), [&members](uint32_t a, uint32_t b) {
+    return members[a].size() > members[b].size();
+  });
+
+  std::vector<uint32_t> seeds(buckets, 0);
+  std::vector<bool> used(count, false);
+  std::vector<uint32_t> slots;
+  for (uint32_t b : order) {
+    if (members[b].empty()) {
+      break;
+    }
+    uint32_t seed = 1;
+    for (; seed != 0; ++seed) {
+      slots.clear();
+      bool ok = true;
+      for (uint32_t i : members[b]) {
+        uint32_t slot = Mix(files[i].base, seed) % count;
+        if (used[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+          ok = false;
+          break;
+        }
+        slots.push_back(slot);
+      }
+      if (ok) {
+        break;
+      }
+    }
+    if (seed == 0) {  // 种子用完也没有找到(实际上不会发生)
+      return "";
+    }
+    seeds[b] = seed;
+    for (size_t k = 0; k < slots.size(); ++k) {
+      used[slots[k]] = true;
+      files[members[b][k]].slot = slots[k];
+    }
+  }
+
+  // 布局: Header | seeds | entries | 路径、ETag、头部和内容
+  size_t seeds_off = sizeof(Header);
+  size_t entries_off = Align8(seeds_off + buckets * sizeof(uint32_t));
+  std::string image(entries_off + count * sizeof(Entry), '\0');
+  std::vector<Entry> entries(count);
+  auto append = [&image](const std::string& data) {
+    image.resize(Align8(image.size()));
+    size_t off = image.size();
+    image += data;
+    return off;
+  };
+  for (Source& file : files) {
+    Entry& entry = entries[file.slot];
+    entry = Entry{};
+    const char* type = Router::ContentType(file.path);
+    bool has_gzip = Compressible(type) && Gzip(file.data, &file.gzip);
+    entry.path_off = append(file.path);
+    entry.path_len = static_cast<uint32_t>(file.path.size());
+    char etag[64];
+    snprintf(etag, sizeof(etag), "\"%zx-%016llx\"", file.data.size(),
+             static_cast<unsigned long long>(Fnv1a(file.data.data(), file.data.size())));
+    for (int v = 0; v < (has_gzip ? 2 : 1); ++v) {
+      const std::string& body = v == 0 ? file.data : file.gzip;
+      std::string tag = etag;
+      if (v == 1) {
+        tag.insert(tag.size() - 1, "-gz");
+      }
+      std::string head = std::string("Content-Type: ") + type + "\r\n";
+      if (v == 1) {
+        head += "Content-Encoding: gzip\r\n";
+      }
+      if (has_gzip) {
+        head += "Vary: Accept-Encoding\r\n";
+      }
+      head += "ETag: " + tag + "\r\nContent-Length:" + std::to_string(body.size()) + "\r\n\r\n";
+      entry.etag_off[v] = append(tag);
+      entry.etag_len[v] = static_cast<uint32_t>(tag.size());
+      entry.head_off[v] = append(head);
+      entry.head_len[v] = static_cast<uint32_t>(head.size());
+      entry.body_off[v] = append(body);
+      entry.body_len[v] = body.size();
+    }
+  }
+
+  Header header{};
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.count = count;
+  header.buckets = buckets;
+  header.size = image.size();
+  memcpy(&image[0], &header, sizeof(header));
+  memcpy(&image[seeds_off], seeds.data(), buckets * sizeof(uint32_t));
+  if (count > 0) {
+    memcpy(&image[entries_off], entries.data(), count * sizeof(Entry));
+  }
+  return image;
+}
+
+std::shared_ptr<const void> ResourcePack::MapAnonymous_(const std::string& image) {
+  size_t size = (image.size() + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+  void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (addr == MAP_FAILED) {
+    return nullptr;
+  }
+  madvise(addr, size, MADV_HUGEPAGE);  // 在写入之前设置, 缺页时直接分配大页; 不支持时忽略
+  memcpy(addr, image.data(), image.size());
+  mprotect(addr, size, PROT_READ);
+  return std::shared_ptr<const void>(addr, [size](const void* p) { munmap(const_cast<void*>(p), size); });
+}
+
+std::shared_ptr<const void> ResourcePack::MapFile_(const char* pack_file, size_t* size) {
+  int fd = open(pack_file, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat st{};
+  if (fstat(fd, &st) < 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+    close(fd);
+    return nullptr;
+  }
+  *size = st.st_size;
+  // MAP_POPULATE: 启动时一次读入, 之后处理请求不会缺页
+  void* addr = mmap(nullptr, *size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return nullptr;
+  }
+  madvise(addr, *size, MADV_HUGEPAGE);  // 文件页的大页需要内核支持(CONFIG_READ_ONLY_THP_FOR_FS), 不支持时忽略
+  size_t len = *size;
+  return std::shared_ptr<const void>(addr, [len](const void* p) { munmap(const_cast<void*>(p), len); });
+}
+
+bool ResourcePack::Save_(const char* pack_file, const std::string& image) {
+  std::string tmp = std::string(pack_file) + ".tmp";
+  FILE* fp = fopen(tmp.c_str(), "wb");
+  if (fp == nullptr) {
+    return false;
+  }
+  bool ok = fwrite(image.data(), 1, image.size(), fp) == image.size();
+  ok = fclose(fp) == 0 && ok;
+  if (!ok || rename(tmp.c_str(), pack_file) != 0) {
+    unlink(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool ResourcePack::Attach_(std::shared_ptr<const void> image, size_t size) {
+  const char* base = static_cast<const char*>(image.get());
+  const Header* header = reinterpret_cast<const Header*>(base);
+  if (size < sizeof(Header) || memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion
+      || header->size != size || header->buckets == 0) {
+    return false;
+  }
+  size_t entries_off = Align8(sizeof(Header) + header->buckets * sizeof(uint32_t));
+  if (entries_off + header->count * sizeof(Entry) > size) {
+    return false;
+  }
+  // 检查所有偏移量都在包内, 截断或损坏的包文件不使用
+  const Entry* entries = reinterpret_cast<const Entry*>(base + entries_off);
+  auto inside = [size](uint64_t off, uint64_t len) { return off <= size && len <= size - off; };
+  for (uint32_t i = 0; i < header->count; ++i) {
+    const Entry& entry = entries[i];
+    if (!inside(entry.path_off, entry.path_len)) {
+      return false;
+    }
+    for (int v = 0; v < 2; ++v) {
+      if (!inside(entry.etag_off[v], entry.etag_len[v]) || !inside(entry.head_off[v], entry.head_len[v])
+          || !inside(entry.body_off[v], entry.body_len[v])) {
+        return false;
+      }
+    }
+  }
+  image_ = std::move(image);
+  header_ = header;
+  seeds_ = reinterpret_cast<const uint32_t*>(base + sizeof(Header));
+  entries_ = entries;
+  return true;
+}
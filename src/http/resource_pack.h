@@ -0,0 +1,135 @@
+// =============================================================================
+// Created by yangb on 2021/5/2.
+// 资源包: 启动时把资源目录整体载入一块连续的只读内存
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_HTTP_RESOURCE_PACK_H_
+#define WEBSERVERCPP11_SRC_HTTP_RESOURCE_PACK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+///
+/// @brief 只读的资源包(单例模式)
+/// 启动时遍历资源目录, 不超过max_file的文件连同预先生成的响应头部(Content-Type, ETag, Content-Length)
+/// 和gzip压缩版本(编译时开启了WEBSERVER_GZIP且压缩后更小时)写进一块连续的内存, 用完美哈希按路径索引:
+/// 查找只有一次哈希和一次比较, 不加锁, 不stat/open. 内存尽量使用透明大页, 写完后设为只读.
+/// 内存中的布局与资源包文件相同: 指定了文件时第一次启动生成它, 之后启动直接mmap, 不再逐个打开资源文件.
+/// 包是启动时的快照, 资源更新后需要删除资源包文件再重启. Init/Clear只在启动时(处理请求之前)调用
+///
+class ResourcePack {
+ public:
+  /// @brief 一个文件, 指针都指向包内
+  struct File {
+    const char* head;       // 预先生成的响应头部(Connection之后的部分, 以空行结尾)
+    size_t head_len;
+    const char* body;
+    size_t body_len;
+    const char* etag;       // 带引号, 如"c3f-9a3e5d1e2a0b77f1", gzip版本以-gz结尾
+    size_t etag_len;
+  };
+
+  static ResourcePack* Instance();
+
+  ///
+  /// @brief 载入资源包, 替换已载入的包
+  /// @param root 资源目录, 以'/'结尾
+  /// @param pack_file 资源包文件, 存在时直接mmap, 不存在时遍历root生成并保存; nullptr: 只在内存中生成
+  /// @param max_file 大于该值的文件不放入包中, 单位: 字节
+  /// @return 失败时返回false, 之后Find都返回false
+  ///
+  bool Init(const std::string& root, const char* pack_file, size_t max_file);
+
+  /// @brief 是否已载入
+  inline bool IsLoaded() const { return header_ != nullptr; }
+
+  ///
+  /// @brief 按请求路径查找
+  /// @param path 相对于资源目录的路径, 以'/'开头
+  /// @param gzip 客户端接受gzip时优先返回压缩版本
+  ///
+  bool Find(const char* path, size_t len, bool gzip, File* file) const;
+
+  inline bool Find(const std::string& path, bool gzip, File* file) const {
+    return Find(path.data(), path.size(), gzip, file);
+  }
+
+  /// @brief 卸载资源包
+  void Clear();
+
+  /// @brief Accept-Encoding是否接受gzip(没有q=0)
+  static bool AcceptsGzip(const char* accept_encoding);
+
+  /// @brief If-None-Match是否匹配file的ETag
+  static bool EtagMatches(const char* if_none_match, const File& file);
+
+  /// @brief 包的引用, 发送中的响应持有它, 包被替换后内存仍然有效
+  inline const std::shared_ptr<const void>& Owner() const { return image_; }
+
+  /// @brief 包中的文件数
+  size_t Count() const;
+
+  /// @brief 包的大小, 单位: 字节
+  size_t Bytes() const;
+
+ private:
+  static const char kMagic[8];
+  static const uint32_t kVersion = 1;
+
+  /// 包的开头, 其后依次是: 分桶的种子(buckets个uint32_t), 条目(count个Entry), 字符串和文件内容
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;     // 文件数, 也是槽数(最小完美哈希)
+    uint32_t buckets;   // 分桶数
+    uint32_t reserved;
+    uint64_t size;      // 整个包的大小
+  };
+
+  /// 偏移量都相对于包的开头, 下标0: 原始版本, 1: gzip版本
+  struct Entry {
+    uint64_t path_off;
+    uint64_t etag_off[2];
+    uint64_t head_off[2];
+    uint64_t body_off[2];
+    uint64_t body_len[2];   // body_len[1]为0: 没有gzip版本
+    uint32_t path_len;
+    uint32_t etag_len[2];
+    uint32_t head_len[2];
+    uint32_t reserved;
+  };
+
+  struct Source;  // 生成包时读入的文件
+
+  ResourcePack() : header_(nullptr), seeds_(nullptr), entries_(nullptr) {}
+  ~ResourcePack() = default;
+
+  /// @brief 遍历目录, 读入不超过max_file的文件
+  static void Walk_(const std::string& root, const std::string& dir, size_t max_file, std::vector<Source>* files);
+
+  /// @brief 生成包(完美哈希, 头部, 压缩版本), 失败时返回空串
+  static std::string Build_(std::vector<Source>& files);
+
+  /// @brief 把包复制到只读的匿名内存(尽量使用大页)
+  static std::shared_ptr<const void> MapAnonymous_(const std::string& image);
+
+  /// @brief mmap包文件, 失败时返回nullptr
+  static std::shared_ptr<const void> MapFile_(const char* pack_file, size_t* size);
+
+  /// @brief 写入包文件(先写临时文件再改名, 不会留下写了一半的包)
+  static bool Save_(const char* pack_file, const std::string& image);
+
+  /// @brief 检查包的格式, 设置header_/seeds_/entries_
+  bool Attach_(std::shared_ptr<const void> image, size_t size);
+
+ private:
+  std::shared_ptr<const void> image_;
+  const Header* header_;
+  const uint32_t* seeds_;
+  const Entry* entries_;
+};
+
+#endif //WEBSERVERCPP11_SRC_HTTP_RESOURCE_PACK_H_
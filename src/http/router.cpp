@@ -0,0 +1,204 @@
+// =============================================================================
+// Created by yangb on 2021/4/27.
+// =============================================================================
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include "router.h"
+
+namespace {
+
+struct SuffixType {
+  const char* suffix;
+  size_t len;
+  const char* type;
+};
+
+#define SUFFIX(s, t) {s, sizeof(s) - 1, t}
+
+///
+/// @brief: HTTP Content-Type
+/// Reference: https://tool.oschina.net/commons
+///
+const SuffixType kSuffixType[] = {
+    SUFFIX(".html", "text/html"),
+    SUFFIX(".xml", "text/xml"),
+    SUFFIX(".xhtml", "application/xhtml+xml"),
+    SUFFIX(".txt", "text/plain"),
+    SUFFIX(".rtf", "application/rtf"),
+    SUFFIX(".pdf", "application/pdf"),
+    SUFFIX(".word", "application/nsword"),
+    SUFFIX(".png", "image/png"),
+    SUFFIX(".gif", "image/gif"),
+    SUFFIX(".jpg", "image/jpeg"),
+    SUFFIX(".jpeg", "image/jpeg"),
+    SUFFIX(".au", "audio/basic"),
+    SUFFIX(".mpeg", "video/mpeg"),
+    SUFFIX(".mpg", "video/mpeg"),
+    SUFFIX(".avi", "video/x-msvideo"),
+    SUFFIX(".gz", "application/x-gzip"),
+    SUFFIX(".tar", "application/x-tar"),
+    SUFFIX(".css", "text/css"),
+    SUFFIX(".js", "text/javascript"),
+};
+
+#undef SUFFIX
+
+} // namespace
+
+Router::Node::Node() {
+  std::fill(exact, exact + kMethodNum, -1);
+  std::fill(prefix, prefix + kMethodNum, -1);
+}
+
+Router* Router::Instance() {
+  static Router router;
+  return &router;
+}
+
+Router::Router() : nodes_(1) {}
+
+void Router::AddFile(int methods, const std::string& pattern, const std::string& file) {
+  Route route;
+  route.file = file;
+  if (!file.empty()) {
+    route.content_type = ContentType(file);
+  }
+  route.may_block = false;
+  Add_(methods, pattern, std::move(route));
+}
+
+void Router::AddHandler(int methods, const std::string& pattern, Handler handler, bool may_block,
+                        Executor executor) {
+  assert(handler);
+  Route route;
+  route.handler = std::move(handler);
+  route.may_block = may_block;
+  route.executor = executor;
+  Add_(methods, pattern, std::move(route));
+}
+
+void Router::Add_(int methods, const std::string& pattern, Route route) {
+  assert(!pattern.empty() && pattern[0] == '/');
+  int node = 0;
+  bool is_prefix = false;
+  size_t begin = 0;
+  while (begin < pattern.size()) {
+    size_t end = pattern.find('/', begin);
+    if (end == std::string::npos) {
+      end = pattern.size();
+    }
+    std::string segment = pattern.substr(begin, end - begin);
+    begin = end + 1;
+    if (segment.empty()) {
+      continue;
+    }
+    if (segment == "**") {
+      assert(begin >= pattern.size()); // '**'只能在结尾
+      is_prefix = true;
+      break;
+    }
+
+    int child = -1;
+    if (segment == "*") {
+      child = nodes_[node].wildcard;
+    } else {
+      for (const auto& item : nodes_[node].children) {
+        if (item.first == segment) {
+          child = item.second;
+          break;
+        }
+      }
+    }
+    if (child < 0) {  // 注意nodes_扩容后引用失效, 先加入再取下标
+      child = static_cast<int>(nodes_.size());
+      nodes_.emplace_back();
+      if (segment == "*") {
+        nodes_[node].wildcard = child;
+      } else {
+        nodes_[node].children.emplace_back(segment, child);
+      }
+    }
+    node = child;
+  }
+
+  int index = static_cast<int>(routes_.size());
+  routes_.push_back(std::move(route));
+  for (int slot = 0; slot < kMethodNum; ++slot) {
+    if (methods & (1 << slot)) {  // 重复注册时后注册的覆盖
+      (is_prefix ? nodes_[node].prefix : nodes_[node].exact)[slot] = index;
+    }
+  }
+}
+
+const Router::Route* Router::Match(Method method, const std::string& path) const {
+  int index = Match_(0, Slot_(method), path.data(), path.data() + path.size());
+  return index < 0 ? nullptr : &routes_[index];
+}
+
+int Router::Match_(int node, int slot, const char* begin, const char* end) const {
+  const Node& n = nodes_[node];
+  while (begin < end && *begin == '/') {
+    ++begin;
+  }
+  if (begin == end) {
+    return n.exact[slot] >= 0 ? n.exact[slot] : n.prefix[slot];
+  }
+
+  const char* segment_end = std::find(begin, end, '/');
+  size_t len = segment_end - begin;
+  for (const auto& child : n.children) {
+    if (child.first.size() == len && memcmp(child.first.data(), begin, len) == 0) {
+      int index = Match_(child.second, slot, segment_end, end);
+      if (index >= 0) {
+        return index;
+      }
+      break;
+    }
+  }
+  if (n.wildcard >= 0) {
+    int index = Match_(n.wildcard, slot, segment_end, end);
+    if (index >= 0) {
+      return index;
+    }
+  }
+  return n.prefix[slot];
+}
+
+void Router::Clear() {
+  nodes_.assign(1, Node());
+  routes_.clear();
+}
+
+Router::Method Router::ParseMethod(const std::string& method) {
+  if (method == "GET") {
+    return GET;
+  }
+  if (method == "POST") {
+    return POST;
+  }
+  return OTHER;
+}
+
+const char* Router::ContentType(const char* path, size_t len) {
+  // 只看最后一段路径中的扩展名
+  const char* end = path + len;
+  const char* dot = end;
+  for (const char* p = end; p != path; --p) {
+    if (p[-1] == '.') {
+      dot = p - 1;
+      break;
+    }
+    if (p[-1] == '/') {
+      break;
+    }
+  }
+  size_t suffix_len = end - dot;
+  for (const auto& item : kSuffixType) {
+    if (item.len == suffix_len && memcmp(item.suffix, dot, suffix_len) == 0) {
+      return item.type;
+    }
+  }
+  return "text/plain";  // 如果没有类型, 则为纯文本
+}
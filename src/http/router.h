@@ -0,0 +1,114 @@
+// =============================================================================
+// Created by yangb on 2021/4/27.
+// 路由表: 按请求方法和路径分发到静态文件或处理函数
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_HTTP_ROUTER_H_
+#define WEBSERVERCPP11_SRC_HTTP_ROUTER_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+class Buffer;
+class HttpRequest;
+class HttpResponse;
+
+///
+/// @brief 路由表(单例模式), 在服务器启动前注册, 之后只读(多线程匹配不加锁)
+/// 路径按'/'分段组织成前缀树, 模式的语法:
+///   /login            完全匹配
+///   /user/*/avatar    '*'匹配任意一段
+///   /images/**        结尾的'**'匹配该前缀下的所有路径(包括/images本身)
+/// 优先级: 完全匹配 > '*' > '**'(越长越优先). 匹配过程不分配内存.
+///
+class Router {
+ public:
+  /// @brief 请求方法, 可以按位或
+  enum Method {
+    GET = 1,
+    POST = 2,
+    OTHER = 4,  // 其他方法(HEAD, PUT, ...)
+    ANY = GET | POST | OTHER,
+  };
+
+  ///
+  /// @brief 处理请求的执行器(线程池), 不同类型的请求互不影响(bulkhead)
+  /// IO:  读写连接和发送文件, 静态文件都在这里处理
+  /// DB:  可能长时间阻塞的处理函数(查询数据库等)
+  /// CPU: 不阻塞但计算量较大的处理函数
+  ///
+  enum Executor {
+    IO = 0,
+    DB,
+    CPU,
+    EXECUTOR_NUM,
+  };
+
+  /// @brief 处理函数, response已按请求初始化, 由处理函数生成响应写入buff
+  typedef std::function<void(HttpRequest& request, HttpResponse& response, Buffer& buff)> Handler;
+
+  struct Route {
+    std::string file;                     // 发送的文件(相对资源目录), 空: 请求路径本身
+    const char* content_type = nullptr;   // file的Content-Type(注册时确定), nullptr: 按请求路径的扩展名
+    Handler handler;                      // 处理函数, 为空时发送文件
+    bool may_block = true;                // 处理函数是否可能阻塞(查询数据库等), 不阻塞的可以在事件循环线程上处理
+    Executor executor = IO;               // 在哪个执行器上处理
+  };
+
+  static Router* Instance();
+
+  /// @brief 注册静态文件: 请求pattern时发送file
+  /// @param file 文件路径(相对资源目录), 空字符串表示请求路径本身
+  void AddFile(int methods, const std::string& pattern, const std::string& file);
+
+  /// @brief 注册处理函数
+  /// @param executor 处理函数在哪个执行器上执行
+  void AddHandler(int methods, const std::string& pattern, Handler handler, bool may_block = true,
+                  Executor executor = DB);
+
+  /// @brief 查找路由, 没有匹配时返回nullptr
+  const Route* Match(Method method, const std::string& path) const;
+
+  /// @brief 清空路由表
+  void Clear();
+
+  /// @brief 请求方法字符串对应的Method
+  static Method ParseMethod(const std::string& method);
+
+  /// @brief 按扩展名确定Content-Type, 没有扩展名或未知的扩展名返回text/plain
+  static const char* ContentType(const char* path, size_t len);
+
+  inline static const char* ContentType(const std::string& path) { return ContentType(path.data(), path.size()); }
+
+ private:
+  /// 方法的个数(Method中的位数)
+  static const int kMethodNum = 3;
+
+  struct Node {
+    std::vector<std::pair<std::string, int>> children;  // 路径段 -> 子节点下标
+    int wildcard = -1;            // '*'子节点
+    int exact[kMethodNum];        // 完全匹配的路由下标, -1: 没有
+    int prefix[kMethodNum];       // '**'的路由下标
+
+    Node();
+  };
+
+  Router();
+
+  void Add_(int methods, const std::string& pattern, Route route);
+
+  /// @brief 从node开始匹配[begin, end)
+  /// @return 路由下标, -1: 没有匹配
+  int Match_(int node, int slot, const char* begin, const char* end) const;
+
+  /// @brief Method对应的下标
+  inline static int Slot_(Method method) { return method == GET ? 0 : (method == POST ? 1 : 2); }
+
+ private:
+  std::vector<Node> nodes_;   // nodes_[0]为根节点
+  std::vector<Route> routes_;
+};
+
+#endif //WEBSERVERCPP11_SRC_HTTP_ROUTER_H_
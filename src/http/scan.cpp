@@ -0,0 +1,333 @@
+// =============================================================================
+// Created by yangb on 2021/4/28.
+// =============================================================================
+
+#include <cstdint>
+#include "scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define WEBSERVER_SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+inline int HexValue(char ch) {
+  if (ch >= '0' && ch <= '9') return ch - '0';
+  if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+  if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+  return -1;
+}
+
+/// @brief 解码p处的'%'或'+', 前移p和out
+inline void DecodeSpecial(const char*& p, const char* end, char*& out) {
+  if (*p == '+') {
+    *out++ = ' ';
+    ++p;
+    return;
+  }
+  int high = end - p >= 3 ? HexValue(p[1]) : -1;
+  int low = high >= 0 ? HexValue(p[2]) : -1;
+  if (low < 0) {  // 不合法的转义, 原样保留
+    *out++ = *p++;
+    return;
+  }
+  *out++ = static_cast<char>(high << 4 | low);
+  p += 3;
+}
+
+/// @brief 逐字节解码到block_end(最后一个转义可能越过block_end)
+inline void DecodeBlock(const char*& p, const char* block_end, const char* end, char*& out) {
+  while (p < block_end) {
+    if (*p == '%' || *p == '+') {
+      DecodeSpecial(p, end, out);
+    } else {
+      *out++ = *p++;
+    }
+  }
+}
+
+// ------------------------------------ 标量 ------------------------------------
+
+const char* FindCrlfScalar(const char* p, const char* end) {
+  while (p < end) {
+    const char* cr = static_cast<const char*>(memchr(p, '\r', end - p));
+    if (!cr || cr + 1 >= end) {
+      return end;
+    }
+    if (cr[1] == '\n') {
+      return cr;
+    }
+    p = cr + 1;
+  }
+  return end;
+}
+
+const char* FindHeaderEndScalar(const char* p, const char* end) {
+  while (p < end) {
+    const char* crlf = FindCrlfScalar(p, end);
+    if (end - crlf < 4) {
+      return end;
+    }
+    if (crlf[2] == '\r' && crlf[3] == '\n') {
+      return crlf;
+    }
+    p = crlf + 2;
+  }
+  return end;
+}
+
+size_t UrlDecodeScalar(const char* in, size_t len, char* out) {
+  const char* p = in;
+  char* o = out;
+  DecodeBlock(p, in + len, in + len, o);
+  return o - out;
+}
+
+#ifdef WEBSERVER_SCAN_X86
+
+// ----------------------------------- SSE4.2 -----------------------------------
+
+__attribute__((target("sse4.2")))
+const char* FindCrlfSse42(const char* p, const char* end) {
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  while (end - p >= 17) { // p[16]是最后一个字节的下一个字节
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+    int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, cr), _mm_cmpeq_epi8(b, lf)));
+    if (mask) {
+      return p + __builtin_ctz(mask);
+    }
+    p += 16;
+  }
+  return FindCrlfScalar(p, end);
+}
+
+__attribute__((target("sse4.2")))
+const char* FindHeaderEndSse42(const char* p, const char* end) {
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  while (end - p >= 19) {
+    __m128i crlf = _mm_and_si128(
+        _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), cr),
+        _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1)), lf));
+    __m128i next = _mm_and_si128(
+        _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2)), cr),
+        _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 3)), lf));
+    int mask = _mm_movemask_epi8(_mm_and_si128(crlf, next));
+    if (mask) {
+      return p + __builtin_ctz(mask);
+    }
+    p += 16;
+  }
+  return FindHeaderEndScalar(p, end);
+}
+
+__attribute__((target("sse4.2")))
+size_t UrlDecodeSse42(const char* in, size_t len, char* out) {
+  const __m128i percent = _mm_set1_epi8('%');
+  const __m128i plus = _mm_set1_epi8('+');
+  const __m128i space = _mm_set1_epi8(' ');
+  const char* p = in;
+  const char* end = in + len;
+  char* o = out;
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, percent));
+    // '+'在向量中直接替换为空格, 只有'%'需要逐个处理
+    v = _mm_blendv_epi8(v, space, _mm_cmpeq_epi8(v, plus));
+    // 整块写出再按实际长度前移; o始终不超过p对应的位置, 不会越过out + len
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(o), v);
+    if (!mask) {
+      o += 16;
+      p += 16;
+      continue;
+    }
+    const char* block_end = p + 16;
+    int index = __builtin_ctz(mask);
+    o += index;
+    p += index;
+    if (mask & (mask - 1)) { // 块内还有其他转义, 转义密集时逐字节处理比每个转义重新加载向量快
+      DecodeBlock(p, block_end, end, o);
+    } else {
+      DecodeSpecial(p, end, o);
+    }
+  }
+  return (o - out) + UrlDecodeScalar(p, end - p, o);
+}
+
+// ------------------------------------ AVX2 ------------------------------------
+
+__attribute__((target("avx2")))
+const char* FindCrlfAvx2(const char* p, const char* end) {
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i lf = _mm256_set1_epi8('\n');
+  while (end - p >= 33) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+    uint32_t mask = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, cr), _mm256_cmpeq_epi8(b, lf))));
+    if (mask) {
+      return p + __builtin_ctz(mask);
+    }
+    p += 32;
+  }
+  _mm256_zeroupper(); // 剩余部分交给非VEX编码的SSE实现, 避免AVX-SSE切换的代价
+  return FindCrlfSse42(p, end);
+}
+
+__attribute__((target("avx2")))
+const char* FindHeaderEndAvx2(const char* p, const char* end) {
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i lf = _mm256_set1_epi8('\n');
+  while (end - p >= 35) {
+    __m256i crlf = _mm256_and_si256(
+        _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), cr),
+        _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1)), lf));
+    __m256i next = _mm256_and_si256(
+        _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 2)), cr),
+        _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 3)), lf));
+    uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(crlf, next)));
+    if (mask) {
+      return p + __builtin_ctz(mask);
+    }
+    p += 32;
+  }
+  _mm256_zeroupper();
+  return FindHeaderEndSse42(p, end);
+}
+
+__attribute__((target("avx2")))
+size_t UrlDecodeAvx2(const char* in, size_t len, char* out) {
+  const __m256i percent = _mm256_set1_epi8('%');
+  const __m256i plus = _mm256_set1_epi8('+');
+  const __m256i space = _mm256_set1_epi8(' ');
+  const char* p = in;
+  const char* end = in + len;
+  char* o = out;
+  while (end - p >= 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, percent)));
+    v = _mm256_blendv_epi8(v, space, _mm256_cmpeq_epi8(v, plus));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(o), v);
+    if (!mask) {
+      o += 32;
+      p += 32;
+      continue;
+    }
+    const char* block_end = p + 32;
+    int index = __builtin_ctz(mask);
+    o += index;
+    p += index;
+    if (mask & (mask - 1)) {
+      DecodeBlock(p, block_end, end, o);
+    } else {
+      DecodeSpecial(p, end, o);
+    }
+  }
+  _mm256_zeroupper();
+  return (o - out) + UrlDecodeSse42(p, end - p, o);
+}
+
+#endif // WEBSERVER_SCAN_X86
+
+struct Kernels {
+  Scan::Kernel kernel;
+  const char* (*find_crlf)(const char*, const char*);
+  const char* (*find_header_end)(const char*, const char*);
+  size_t (*url_decode)(const char*, size_t, char*);
+};
+
+const Kernels kScalar = {Scan::SCALAR, FindCrlfScalar, FindHeaderEndScalar, UrlDecodeScalar};
+#ifdef WEBSERVER_SCAN_X86
+const Kernels kSse42 = {Scan::SSE42, FindCrlfSse42, FindHeaderEndSse42, UrlDecodeSse42};
+const Kernels kAvx2 = {Scan::AVX2, FindCrlfAvx2, FindHeaderEndAvx2, UrlDecodeAvx2};
+#endif
+
+bool Supports(Scan::Kernel kernel) {
+#ifdef WEBSERVER_SCAN_X86
+  __builtin_cpu_init();
+  switch (kernel) {
+    case Scan::AVX2:
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.2");
+    case Scan::SSE42:
+      return __builtin_cpu_supports("sse4.2");
+    default:
+      return true;
+  }
+#else
+  return kernel == Scan::SCALAR;
+#endif
+}
+
+const Kernels* Select(Scan::Kernel kernel) {
+#ifdef WEBSERVER_SCAN_X86
+  if (kernel == Scan::AVX2) {
+    return &kAvx2;
+  }
+  if (kernel == Scan::SSE42) {
+    return &kSse42;
+  }
+#endif
+  return &kScalar;
+}
+
+const Kernels* SelectBest() {
+  if (Supports(Scan::AVX2)) {
+    return Select(Scan::AVX2);
+  }
+  if (Supports(Scan::SSE42)) {
+    return Select(Scan::SSE42);
+  }
+  return &kScalar;
+}
+
+/// @brief 当前使用的实现, 第一次调用时选择(其他编译单元的静态初始化中调用也是安全的)
+const Kernels*& Active() {
+  static const Kernels* kernels = SelectBest();
+  return kernels;
+}
+
+} // namespace
+
+const char* Scan::FindCRLF(const char* begin, const char* end) {
+  return Active()->find_crlf(begin, end);
+}
+
+const char* Scan::FindHeaderEnd(const char* begin, const char* end) {
+  return Active()->find_header_end(begin, end);
+}
+
+size_t Scan::UrlDecode(const char* in, size_t len, char* out) {
+  return Active()->url_decode(in, len, out);
+}
+
+std::string Scan::UrlDecode(const char* begin, const char* end) {
+  std::string out(end - begin, '\0');
+  out.resize(UrlDecode(begin, end - begin, &out[0]));
+  return out;
+}
+
+Scan::Kernel Scan::Current() {
+  return Active()->kernel;
+}
+
+const char* Scan::Name(Kernel kernel) {
+  switch (kernel) {
+    case AVX2:
+      return "avx2";
+    case SSE42:
+      return "sse4.2";
+    default:
+      return "scalar";
+  }
+}
+
+bool Scan::Use(Kernel kernel) {
+  if (!Supports(kernel)) {
+    return false;
+  }
+  Active() = Select(kernel);
+  return true;
+}
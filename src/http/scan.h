@@ -0,0 +1,59 @@
+// =============================================================================
+// Created by yangb on 2021/4/28.
+// 请求解析中的字节扫描: 查找\r\n、\r\n\r\n、分隔符, URL解码
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_HTTP_SCAN_H_
+#define WEBSERVERCPP11_SRC_HTTP_SCAN_H_
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+///
+/// @brief 扫描函数, 启动时按CPU选择实现(AVX2 > SSE4.2 > 标量)
+/// AVX2/SSE4.2的实现每次比较32/16个字节, 只在函数上用target属性编译, 不需要全局的-mavx2,
+/// 在不支持的CPU上不会被调用.
+///
+class Scan {
+ public:
+  /// @brief 实现
+  enum Kernel {
+    SCALAR = 0,
+    SSE42,
+    AVX2,
+  };
+
+  /// @brief 第一个\r\n的位置, 没有时返回end
+  static const char* FindCRLF(const char* begin, const char* end);
+
+  /// @brief 第一个\r\n\r\n(请求头结束)的位置, 没有时返回end
+  static const char* FindHeaderEnd(const char* begin, const char* end);
+
+  /// @brief 第一个ch的位置, 没有时返回end
+  /// glibc的memchr已经按CPU选择了向量化的实现, 直接使用
+  inline static const char* FindChar(const char* begin, const char* end, char ch) {
+    const void* p = memchr(begin, ch, end - begin);
+    return p ? static_cast<const char*>(p) : end;
+  }
+
+  ///
+  /// @brief URL解码(application/x-www-form-urlencoded): %XX -> 字节, + -> 空格
+  /// 不合法的%转义原样保留
+  /// @param out 至少len字节
+  /// @return 解码后的长度
+  ///
+  static size_t UrlDecode(const char* in, size_t len, char* out);
+
+  static std::string UrlDecode(const char* begin, const char* end);
+
+  /// @brief 当前使用的实现
+  static Kernel Current();
+
+  static const char* Name(Kernel kernel);
+
+  /// @brief 切换实现(测试和基准测试用), CPU不支持时返回false
+  static bool Use(Kernel kernel);
+};
+
+#endif //WEBSERVERCPP11_SRC_HTTP_SCAN_H_
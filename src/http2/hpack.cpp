@@ -0,0 +1,505 @@
+// =============================================================================
+// Created by yangb on 2021/4/26.
+// =============================================================================
+
+#include <algorithm>
+#include "hpack.h"
+
+namespace {
+
+struct StaticEntry {
+  const char* name;
+  const char* value;
+};
+
+/// 静态表(RFC 7541 附录A), 下标从1开始
+const StaticEntry kStaticTable[HpackTable::kStaticSize] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+
+struct HuffmanCode {
+  uint32_t code;
+  uint8_t bits;
+};
+
+/// Huffman编码表(RFC 7541 附录B), 下标为符号, 256为EOS
+const HuffmanCode kHuffmanCodes[257] = {
+    {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28},
+    {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},
+    {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+    {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+    {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},
+    {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+    {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28},
+    {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},
+    {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+    {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11},
+    {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11},
+    {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+    {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6},
+    {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6},
+    {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+    {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10},
+    {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7},
+    {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+    {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7},
+    {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7},
+    {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+    {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7},
+    {0xfc, 8}, {0x73, 7}, {0xfd, 8}, {0x1ffb, 13},
+    {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+    {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5},
+    {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6},
+    {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+    {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5},
+    {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5},
+    {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+    {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15},
+    {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},
+    {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+    {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23},
+    {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23},
+    {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+    {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23},
+    {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23},
+    {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+    {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24},
+    {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22},
+    {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+    {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24},
+    {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23},
+    {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+    {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23},
+    {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22},
+    {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+    {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19},
+    {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25},
+    {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+    {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25},
+    {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27},
+    {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+    {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26},
+    {0xffffffd, 28}, {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27},
+    {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+    {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23},
+    {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25},
+    {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+    {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26},
+    {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27},
+    {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+    {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},
+    {0x3fffffff, 30},
+};
+
+///
+/// @brief Huffman解码树, 第一次使用时由编码表生成
+/// 每个内部节点有两个孩子, 叶子节点记录符号
+///
+class HuffmanTree {
+ public:
+  static const HuffmanTree& Instance() {
+    static HuffmanTree tree;
+    return tree;
+  }
+
+  struct Node {
+    int16_t child[2];
+    int16_t symbol; // -1: 内部节点
+  };
+
+  inline const Node& At(int i) const { return nodes_[i]; }
+
+ private:
+  HuffmanTree() {
+    nodes_.push_back({{0, 0}, -1});
+    for (int sym = 0; sym < 257; ++sym) {
+      int cur = 0;
+      for (int b = kHuffmanCodes[sym].bits - 1; b >= 0; --b) {
+        int bit = (kHuffmanCodes[sym].code >> b) & 1;
+        if (nodes_[cur].child[bit] == 0) {
+          nodes_[cur].child[bit] = static_cast<int16_t>(nodes_.size());
+          nodes_.push_back({{0, 0}, -1});
+        }
+        cur = nodes_[cur].child[bit];
+      }
+      nodes_[cur].symbol = static_cast<int16_t>(sym);
+    }
+  }
+
+  std::vector<Node> nodes_;
+};
+
+} // namespace
+
+// ------------------------------------ Hpack ------------------------------------
+
+void Hpack::EncodeInteger(uint64_t value, int prefix_bits, uint8_t flags, std::string* out) {
+  uint64_t max_prefix = (1u << prefix_bits) - 1;
+  if (value < max_prefix) {
+    out->push_back(static_cast<char>(flags | value));
+    return;
+  }
+  out->push_back(static_cast<char>(flags | max_prefix));
+  value -= max_prefix;
+  while (value >= 128) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+bool Hpack::DecodeInteger(const uint8_t*& p, const uint8_t* end, int prefix_bits, uint64_t* value) {
+  if (p >= end) {
+    return false;
+  }
+  uint64_t max_prefix = (1u << prefix_bits) - 1;
+  *value = *p++ & max_prefix;
+  if (*value < max_prefix) {
+    return true;
+  }
+  for (int shift = 0; p < end; shift += 7) {
+    if (shift > 56) { // 超过合理范围, 防止溢出
+      return false;
+    }
+    uint8_t b = *p++;
+    *value += static_cast<uint64_t>(b & 0x7f) << shift;
+    if (!(b & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t Hpack::HuffmanEncodedLength(const std::string& str) {
+  uint64_t bits = 0;
+  for (unsigned char ch : str) {
+    bits += kHuffmanCodes[ch].bits;
+  }
+  return (bits + 7) / 8;
+}
+
+void Hpack::HuffmanEncode(const std::string& str, std::string* out) {
+  uint64_t acc = 0;  // 尚未输出的位
+  int acc_bits = 0;
+  for (unsigned char ch : str) {
+    acc = (acc << kHuffmanCodes[ch].bits) | kHuffmanCodes[ch].code;
+    acc_bits += kHuffmanCodes[ch].bits;
+    while (acc_bits >= 8) {
+      acc_bits -= 8;
+      out->push_back(static_cast<char>(acc >> acc_bits));
+    }
+  }
+  if (acc_bits > 0) { // 用EOS的高位(全1)填充
+    acc = (acc << (8 - acc_bits)) | (0xff >> acc_bits);
+    out->push_back(static_cast<char>(acc));
+  }
+}
+
+bool Hpack::HuffmanDecode(const uint8_t* data, size_t len, std::string* out) {
+  const HuffmanTree& tree = HuffmanTree::Instance();
+  int cur = 0;
+  int depth = 0;        // 当前符号已读取的位数
+  bool all_ones = true; // 当前符号已读取的位是否全为1
+  for (size_t i = 0; i < len; ++i) {
+    for (int b = 7; b >= 0; --b) {
+      int bit = (data[i] >> b) & 1;
+      cur = tree.At(cur).child[bit];
+      if (cur == 0) {
+        return false;
+      }
+      ++depth;
+      all_ones = all_ones && bit;
+      int symbol = tree.At(cur).symbol;
+      if (symbol >= 0) {
+        if (symbol == 256) { // 不允许出现EOS
+          return false;
+        }
+        out->push_back(static_cast<char>(symbol));
+        cur = 0;
+        depth = 0;
+        all_ones = true;
+      }
+    }
+  }
+  // 填充位必须是EOS的高位(全1)且少于8位
+  return depth < 8 && all_ones;
+}
+
+// ---------------------------------- HpackTable ----------------------------------
+
+const HeaderField* HpackTable::Get(size_t index) const {
+  static const std::vector<HeaderField> kStatic = [] {
+    std::vector<HeaderField> fields;
+    for (const auto& entry : kStaticTable) {
+      fields.emplace_back(entry.name, entry.value);
+    }
+    return fields;
+  }();
+
+  if (index == 0) {
+    return nullptr;
+  }
+  if (index <= kStaticSize) {
+    return &kStatic[index - 1];
+  }
+  index -= kStaticSize + 1;
+  if (index < entries_.size()) {
+    return &entries_[index];
+  }
+  return nullptr;
+}
+
+size_t HpackTable::Find(const std::string& name, const std::string& value, size_t* name_index) const {
+  *name_index = 0;
+  for (size_t i = 0; i < kStaticSize; ++i) {
+    if (name == kStaticTable[i].name) {
+      if (value == kStaticTable[i].value) {
+        return i + 1;
+      }
+      if (*name_index == 0) {
+        *name_index = i + 1;
+      }
+    }
+  }
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    if (entries_[i].first == name) {
+      if (entries_[i].second == value) {
+        return kStaticSize + 1 + i;
+      }
+      if (*name_index == 0) {
+        *name_index = kStaticSize + 1 + i;
+      }
+    }
+  }
+  return 0;
+}
+
+void HpackTable::Add(const std::string& name, const std::string& value) {
+  HeaderField field(name, value);
+  size_t entry_size = EntrySize_(field);
+  if (entry_size > max_size_) { // 比整个表还大: 清空表, 不加入(RFC 7541 4.4)
+    Evict_(0);
+    return;
+  }
+  Evict_(max_size_ - entry_size);
+  size_ += entry_size;
+  entries_.push_front(std::move(field));
+}
+
+void HpackTable::SetMaxSize(size_t max_size) {
+  max_size_ = max_size;
+  Evict_(max_size);
+}
+
+void HpackTable::Evict_(size_t max_size) {
+  while (size_ > max_size && !entries_.empty()) {
+    size_ -= EntrySize_(entries_.back());
+    entries_.pop_back();
+  }
+}
+
+// --------------------------------- HpackDecoder ---------------------------------
+
+const size_t HpackDecoder::kMaxHeaderListSize;
+
+bool HpackDecoder::ReadString_(const uint8_t*& p, const uint8_t* end, std::string* str) {
+  if (p >= end) {
+    return false;
+  }
+  bool huffman = *p & 0x80;
+  uint64_t len;
+  if (!Hpack::DecodeInteger(p, end, 7, &len) || len > static_cast<uint64_t>(end - p)) {
+    return false;
+  }
+  str->clear();
+  if (huffman) {
+    if (!Hpack::HuffmanDecode(p, len, str)) {
+      return false;
+    }
+  } else {
+    str->assign(reinterpret_cast<const char*>(p), len);
+  }
+  p += len;
+  return true;
+}
+
+bool HpackDecoder::Decode(const uint8_t* data, size_t len, std::vector<HeaderField>* headers) {
+  const uint8_t* p = data;
+  const uint8_t* end = data + len;
+  bool field_seen = false; // 动态表大小更新只能出现在头部块开头
+  size_t list_size = 0;
+  std::string name;
+  std::string value;
+
+  while (p < end) {
+    uint8_t b = *p;
+    uint64_t index;
+    if (b & 0x80) { // 索引字段 1xxxxxxx
+      if (!Hpack::DecodeInteger(p, end, 7, &index)) {
+        return false;
+      }
+      const HeaderField* field = table_.Get(index);
+      if (!field) {
+        return false;
+      }
+      list_size += field->first.size() + field->second.size() + 32;
+      if (list_size > max_list_size_) { // 先检查再复制
+        return false;
+      }
+      headers->push_back(*field);
+      field_seen = true;
+      continue;
+    }
+
+    if ((b & 0xe0) == 0x20) { // 动态表大小更新 001xxxxx
+      uint64_t size;
+      if (field_seen || !Hpack::DecodeInteger(p, end, 5, &size) || size > max_table_size_) {
+        return false;
+      }
+      table_.SetMaxSize(size);
+      continue;
+    }
+
+    // 字面量: 01xxxxxx 加入动态表; 0000xxxx 不加入; 0001xxxx 永不加入
+    bool indexing = (b & 0xc0) == 0x40;
+    int prefix_bits = indexing ? 6 : 4;
+    if (!Hpack::DecodeInteger(p, end, prefix_bits, &index)) {
+      return false;
+    }
+    if (index == 0) {
+      if (!ReadString_(p, end, &name)) {
+        return false;
+      }
+    } else {
+      const HeaderField* field = table_.Get(index);
+      if (!field) {
+        return false;
+      }
+      name = field->first;
+    }
+    if (!ReadString_(p, end, &value)) {
+      return false;
+    }
+    list_size += name.size() + value.size() + 32;
+    if (list_size > max_list_size_) {
+      return false;
+    }
+    if (indexing) {
+      table_.Add(name, value);
+    }
+    headers->emplace_back(name, value);
+    field_seen = true;
+  }
+  return true;
+}
+
+// --------------------------------- HpackEncoder ---------------------------------
+
+void HpackEncoder::SetMaxTableSize(size_t max_size) {
+  max_size = std::min<size_t>(max_size, 4096);
+  if (max_size != table_.MaxSize()) {
+    table_.SetMaxSize(max_size);
+    pending_size_update_ = true;
+  }
+}
+
+void HpackEncoder::WriteString_(const std::string& str, std::string* out) {
+  size_t huffman_len = Hpack::HuffmanEncodedLength(str);
+  if (huffman_len < str.size()) {
+    Hpack::EncodeInteger(huffman_len, 7, 0x80, out);
+    Hpack::HuffmanEncode(str, out);
+  } else {
+    Hpack::EncodeInteger(str.size(), 7, 0x00, out);
+    out->append(str);
+  }
+}
+
+void HpackEncoder::Encode(const std::vector<HeaderField>& headers, std::string* out) {
+  if (pending_size_update_) {
+    Hpack::EncodeInteger(table_.MaxSize(), 5, 0x20, out);
+    pending_size_update_ = false;
+  }
+
+  for (const auto& field : headers) {
+    size_t name_index;
+    size_t index = table_.Find(field.first, field.second, &name_index);
+    if (index > 0) {
+      Hpack::EncodeInteger(index, 7, 0x80, out);
+      continue;
+    }
+    // 每个响应都不同的值(长度)不加入动态表, 以免把有用的条目挤出去
+    bool indexing = field.first != "content-length";
+    if (indexing) {
+      Hpack::EncodeInteger(name_index, 6, 0x40, out);
+    } else {
+      Hpack::EncodeInteger(name_index, 4, 0x00, out);
+    }
+    if (name_index == 0) {
+      WriteString_(field.first, out);
+    }
+    WriteString_(field.second, out);
+    if (indexing) {
+      table_.Add(field.first, field.second);
+    }
+  }
+}
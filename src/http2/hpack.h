@@ -0,0 +1,131 @@
+// =============================================================================
+// Created by yangb on 2021/4/26.
+// HPACK: HTTP/2头部压缩(RFC 7541)
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_HTTP2_HPACK_H_
+#define WEBSERVERCPP11_SRC_HTTP2_HPACK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// 头部字段, first: 名称(小写), second: 值
+typedef std::pair<std::string, std::string> HeaderField;
+
+///
+/// @brief 动态表
+/// 新加入的条目下标最小, 下标从静态表之后(62)开始; 条目大小 = 名称长度 + 值长度 + 32
+///
+class HpackTable {
+ public:
+  /// 静态表的条目数
+  static const size_t kStaticSize = 61;
+
+  explicit HpackTable(size_t max_size = 4096) : size_(0), max_size_(max_size) {}
+
+  /// @brief 按下标获取条目(包括静态表), 下标无效时返回nullptr
+  const HeaderField* Get(size_t index) const;
+
+  /// @brief 查找条目
+  /// @param name_index 没有完全匹配时, 返回名称匹配的下标(0: 没有)
+  /// @return 完全匹配的下标, 0: 没有
+  size_t Find(const std::string& name, const std::string& value, size_t* name_index) const;
+
+  /// @brief 加入条目, 必要时淘汰最旧的条目
+  void Add(const std::string& name, const std::string& value);
+
+  /// @brief 修改表的大小上限, 必要时淘汰最旧的条目
+  void SetMaxSize(size_t max_size);
+
+  inline size_t MaxSize() const { return max_size_; }
+
+  inline size_t Size() const { return size_; }
+
+ private:
+  inline static size_t EntrySize_(const HeaderField& field) { return field.first.size() + field.second.size() + 32; }
+
+  void Evict_(size_t max_size);
+
+ private:
+  std::deque<HeaderField> entries_;
+  size_t size_;
+  size_t max_size_;
+};
+
+///
+/// @brief 解码器, 每个连接一个(动态表是连接状态)
+///
+class HpackDecoder {
+ public:
+  /// 解码后头部列表的最大大小(每个字段按名称+值+32字节计, 同SETTINGS_MAX_HEADER_LIST_SIZE)
+  /// 一个字节的索引字段可以引用动态表中4KB的条目, 只限制头部块的长度挡不住放大攻击
+  static const size_t kMaxHeaderListSize = 64 * 1024;
+
+  /// @param max_table_size 本端通告的SETTINGS_HEADER_TABLE_SIZE
+  /// @param max_list_size 本端通告的SETTINGS_MAX_HEADER_LIST_SIZE
+  explicit HpackDecoder(size_t max_table_size = 4096, size_t max_list_size = kMaxHeaderListSize)
+      : table_(max_table_size), max_table_size_(max_table_size), max_list_size_(max_list_size) {}
+
+  /// @brief 解码一个完整的头部块
+  /// @return false: 解码出错或头部列表超过max_list_size(连接错误COMPRESSION_ERROR)
+  bool Decode(const uint8_t* data, size_t len, std::vector<HeaderField>* headers);
+
+ private:
+  bool ReadString_(const uint8_t*& p, const uint8_t* end, std::string* str);
+
+ private:
+  HpackTable table_;
+  size_t max_table_size_;
+  size_t max_list_size_;
+};
+
+///
+/// @brief 编码器, 每个连接一个
+/// 重复出现的头部(如content-type)加入动态表, 之后只需一个字节; 字符串按较短的方式编码(Huffman或原文)
+///
+class HpackEncoder {
+ public:
+  HpackEncoder() : table_(4096), pending_size_update_(false) {}
+
+  /// @brief 对端通告的SETTINGS_HEADER_TABLE_SIZE, 编码器最多使用4096字节
+  void SetMaxTableSize(size_t max_size);
+
+  /// @brief 编码一个头部块, 追加到out
+  void Encode(const std::vector<HeaderField>& headers, std::string* out);
+
+ private:
+  static void WriteString_(const std::string& str, std::string* out);
+
+ private:
+  HpackTable table_;
+  bool pending_size_update_;  // 下一个头部块开头需要发送动态表大小更新
+};
+
+///
+/// @brief HPACK的基本编码
+///
+class Hpack {
+ public:
+  /// @brief 编码整数(RFC 7541 5.1)
+  /// @param prefix_bits 第一个字节中可用的位数(1~8)
+  /// @param flags 第一个字节中前缀以外的高位
+  static void EncodeInteger(uint64_t value, int prefix_bits, uint8_t flags, std::string* out);
+
+  /// @brief 解码整数, 成功时p指向整数之后
+  static bool DecodeInteger(const uint8_t*& p, const uint8_t* end, int prefix_bits, uint64_t* value);
+
+  /// @brief Huffman编码(RFC 7541 附录B)
+  static void HuffmanEncode(const std::string& str, std::string* out);
+
+  /// @brief Huffman编码后的长度
+  static size_t HuffmanEncodedLength(const std::string& str);
+
+  /// @brief Huffman解码, 填充位不合法或出现EOS时返回false
+  static bool HuffmanDecode(const uint8_t* data, size_t len, std::string* out);
+};
+
+#endif //WEBSERVERCPP11_SRC_HTTP2_HPACK_H_
@@ -0,0 +1,665 @@
+// =============================================================================
+// Created by yangb on 2021/4/26.
+// =============================================================================
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include "../http/http_conn.h"
+#include "../metrics/metrics.h"
+#include "http2_session.h"
+
+namespace {
+
+/// @brief base64url解码(RFC 4648 5), 不要求填充
+bool Base64UrlDecode(const std::string& in, std::string* out) {
+  uint32_t acc = 0;
+  int bits = 0;
+  for (char ch : in) {
+    int v;
+    if (ch >= 'A' && ch <= 'Z') v = ch - 'A';
+    else if (ch >= 'a' && ch <= 'z') v = ch - 'a' + 26;
+    else if (ch >= '0' && ch <= '9') v = ch - '0' + 52;
+    else if (ch == '-' || ch == '+') v = 62;
+    else if (ch == '_' || ch == '/') v = 63;
+    else if (ch == '=') break;
+    else return false;
+    acc = (acc << 6) | v;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out->push_back(static_cast<char>((acc >> bits) & 0xff));
+    }
+  }
+  return true;
+}
+
+/// @brief HTTP/2的头部名称是小写的, 转换为HttpRequest使用的形式, e.g. content-type -> Content-Type
+std::string CanonicalName(const std::string& name) {
+  std::string result(name);
+  bool upper = true;
+  for (char& ch : result) {
+    if (upper) {
+      ch = static_cast<char>(toupper(static_cast<unsigned char>(ch)));
+    }
+    upper = (ch == '-');
+  }
+  return result;
+}
+
+inline uint32_t ReadU32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+} // namespace
+
+const char Http2Session::kPreface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+const size_t Http2Session::kPrefaceLen;
+
+bool Http2Session::IsPreface(const Buffer& buff) {
+  size_t len = std::min(buff.ReadableBytes(), kPrefaceLen);
+  // 至少3个字节才能和PUT/POST/PATCH区分开
+  return len >= 3 && memcmp(buff.Peek(), kPreface, len) == 0;
+}
+
+Http2Session::Http2Session() : preface_received_(false),
+                               settings_sent_(false),
+                               goaway_sent_(false),
+                               goaway_received_(false),
+                               last_stream_id_(0),
+                               header_stream_id_(0),
+                               header_end_stream_(false),
+                               peer_max_frame_size_(16384),
+                               peer_initial_window_(65535),
+                               conn_send_window_(65535),
+                               next_stream_(0),
+                               defer_blocking_(false),
+                               deferred_executor_(Router::IO) {}
+
+Http2Session::~Http2Session() = default;
+
+bool Http2Session::Upgrade(const std::string& settings, const std::string& method, const std::string& path,
+                           Buffer& out) {
+  std::string payload;
+  if (!Base64UrlDecode(settings, &payload) || payload.size() % 6 != 0) {
+    return false;
+  }
+  // 101响应即是对这些参数的确认, 不需要发送SETTINGS ACK
+  if (ApplySettings_(reinterpret_cast<const uint8_t*>(payload.data()), payload.size()) != NO_ERROR) {
+    return false;
+  }
+
+  out.Append("HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n");
+  WriteSettings_(out);
+
+  last_stream_id_ = 1;
+  Stream& stream = streams_[1];
+  stream.id = 1;
+  stream.send_window = peer_initial_window_;
+  stream.end_stream_received = true;
+  stream.headers = {{":method", method}, {":scheme", "http"}, {":path", path}};
+  HandleRequest_(stream, out);
+  return true;
+}
+
+void Http2Session::Process(Buffer& in, Buffer& out, bool defer_blocking) {
+  defer_blocking_ = defer_blocking;
+  ProcessFrames_(in, out);
+  defer_blocking_ = false;
+}
+
+void Http2Session::RunDeferred(Buffer& out) {
+  std::vector<uint32_t> ids;
+  ids.swap(deferred_);
+  for (uint32_t id : ids) {
+    auto it = streams_.find(id);
+    if (it != streams_.end()) { // 已经发送GOAWAY时流都已清除
+      HandleRequest_(it->second, out);
+    }
+  }
+  WriteData_(out);
+}
+
+void Http2Session::RefuseDeferred(Buffer& out) {
+  for (uint32_t id : deferred_) {
+    if (streams_.count(id) > 0) {
+      ResetStream_(id, REFUSED_STREAM, out);
+    }
+  }
+  deferred_.clear();
+}
+
+void Http2Session::ProcessFrames_(Buffer& in, Buffer& out) {
+  if (!preface_received_) {
+    size_t len = std::min(in.ReadableBytes(), kPrefaceLen);
+    if (memcmp(in.Peek(), kPreface, len) != 0) {
+      GoAway_(PROTOCOL_ERROR, out);
+    } else if (len < kPrefaceLen) { // 等待剩下的部分
+      return;
+    } else {
+      in.Retrieve(kPrefaceLen);
+      preface_received_ = true;
+      if (!settings_sent_) {
+        WriteSettings_(out);
+      }
+    }
+  }
+
+  // 帧: Length(24) | Type(8) | Flags(8) | R(1) Stream Identifier(31) | Payload
+  while (!goaway_sent_ && in.ReadableBytes() >= 9) {
+    const auto* p = reinterpret_cast<const uint8_t*>(in.Peek());
+    FrameHeader header{};
+    header.length = (static_cast<uint32_t>(p[0]) << 16) | (p[1] << 8) | p[2];
+    header.type = p[3];
+    header.flags = p[4];
+    header.stream_id = ReadU32(p + 5) & 0x7fffffff;
+    if (header.length > kMaxFrameSize) {
+      GoAway_(FRAME_SIZE_ERROR, out);
+      break;
+    }
+    if (in.ReadableBytes() < 9 + header.length) { // 帧不完整
+      break;
+    }
+    ErrorCode code = OnFrame_(header, p + 9, out);
+    in.Retrieve(9 + header.length);
+    if (code != NO_ERROR) {
+      GoAway_(code, out);
+    }
+  }
+  if (goaway_sent_) {
+    in.RetrieveAll();
+    return;
+  }
+  WriteData_(out);
+}
+
+Http2Session::ErrorCode Http2Session::OnFrame_(const FrameHeader& header, const uint8_t* payload, Buffer& out) {
+  // 头部块必须连续, 中间不能插入其他帧
+  if (header_stream_id_ != 0 && (header.type != CONTINUATION || header.stream_id != header_stream_id_)) {
+    return PROTOCOL_ERROR;
+  }
+
+  switch (header.type) {
+    case DATA:
+      return OnData_(header, payload, out);
+    case HEADERS:
+      return OnHeaders_(header, payload, out);
+    case PRIORITY: // 不支持优先级, 只检查格式
+      if (header.stream_id == 0) {
+        return PROTOCOL_ERROR;
+      }
+      if (header.length != 5) {
+        ResetStream_(header.stream_id, FRAME_SIZE_ERROR, out);
+      }
+      return NO_ERROR;
+    case RST_STREAM:
+      if (header.stream_id == 0 || header.stream_id > last_stream_id_) {
+        return PROTOCOL_ERROR;
+      }
+      if (header.length != 4) {
+        return FRAME_SIZE_ERROR;
+      }
+      streams_.erase(header.stream_id);
+      return NO_ERROR;
+    case SETTINGS:
+      return OnSettings_(header, payload, out);
+    case PUSH_PROMISE: // 客户端不能推送
+      return PROTOCOL_ERROR;
+    case PING:
+      if (header.stream_id != 0) {
+        return PROTOCOL_ERROR;
+      }
+      if (header.length != 8) {
+        return FRAME_SIZE_ERROR;
+      }
+      if (!(header.flags & kFlagAck)) {
+        WriteFrameHeader_(out, 8, PING, kFlagAck, 0);
+        out.Append(payload, 8);
+      }
+      return NO_ERROR;
+    case GOAWAY:
+      if (header.stream_id != 0) {
+        return PROTOCOL_ERROR;
+      }
+      if (header.length < 8) {
+        return FRAME_SIZE_ERROR;
+      }
+      goaway_received_ = true;
+      return NO_ERROR;
+    case WINDOW_UPDATE:
+      return OnWindowUpdate_(header, payload, out);
+    case CONTINUATION:
+      if (header_stream_id_ == 0) {
+        return PROTOCOL_ERROR;
+      }
+      return OnContinuation_(header, payload, out);
+    default:  // 忽略未知类型的帧
+      return NO_ERROR;
+  }
+}
+
+Http2Session::ErrorCode Http2Session::OnHeaders_(const FrameHeader& header, const uint8_t* payload, Buffer& out) {
+  uint32_t id = header.stream_id;
+  if (id == 0 || id % 2 == 0) { // 客户端发起的流ID是奇数
+    return PROTOCOL_ERROR;
+  }
+
+  const uint8_t* p = payload;
+  size_t len = header.length;
+  size_t pad = 0;
+  if (header.flags & kFlagPadded) {
+    if (len < 1) {
+      return FRAME_SIZE_ERROR;
+    }
+    pad = *p++;
+    --len;
+  }
+  if (header.flags & kFlagPriority) {
+    if (len < 5) {
+      return FRAME_SIZE_ERROR;
+    }
+    p += 5;
+    len -= 5;
+  }
+  if (pad > len) {
+    return PROTOCOL_ERROR;
+  }
+  len -= pad;
+
+  if (id <= last_stream_id_) {
+    auto it = streams_.find(id);
+    if (it == streams_.end() || it->second.end_stream_received) {
+      return STREAM_CLOSED;
+    }
+    if (!(header.flags & kFlagEndStream)) { // 请求正文之后的trailer必须结束流
+      return PROTOCOL_ERROR;
+    }
+  } else {
+    last_stream_id_ = id;
+    Stream& stream = streams_[id];
+    stream.id = id;
+    stream.send_window = peer_initial_window_;
+  }
+
+  header_stream_id_ = id;
+  header_end_stream_ = header.flags & kFlagEndStream;
+  header_block_.assign(reinterpret_cast<const char*>(p), len);
+  if (header.flags & kFlagEndHeaders) {
+    return OnHeaderBlock_(out);
+  }
+  return NO_ERROR;
+}
+
+Http2Session::ErrorCode Http2Session::OnContinuation_(const FrameHeader& header, const uint8_t* payload,
+                                                      Buffer& out) {
+  if (header_block_.size() + header.length > kMaxHeaderBlock) {
+    return PROTOCOL_ERROR;
+  }
+  header_block_.append(reinterpret_cast<const char*>(payload), header.length);
+  if (header.flags & kFlagEndHeaders) {
+    return OnHeaderBlock_(out);
+  }
+  return NO_ERROR;
+}
+
+Http2Session::ErrorCode Http2Session::OnHeaderBlock_(Buffer& out) {
+  uint32_t id = header_stream_id_;
+  header_stream_id_ = 0;
+
+  // 即使流随后被拒绝, 也必须解码, 否则动态表与对端不一致
+  std::vector<HeaderField> headers;
+  bool ok = decoder_.Decode(reinterpret_cast<const uint8_t*>(header_block_.data()), header_block_.size(), &headers);
+  header_block_.clear();
+  if (!ok) {
+    return COMPRESSION_ERROR;
+  }
+
+  auto it = streams_.find(id);
+  if (it == streams_.end()) {
+    return NO_ERROR;
+  }
+  Stream& stream = it->second;
+  if (stream.headers.empty()) {
+    stream.headers = std::move(headers);
+    if (streams_.size() > kMaxConcurrentStreams) {
+      ResetStream_(id, REFUSED_STREAM, out);
+      return NO_ERROR;
+    }
+  } // else: trailer, 忽略
+
+  if (header_end_stream_) {
+    stream.end_stream_received = true;
+    HandleRequest_(stream, out);
+  }
+  return NO_ERROR;
+}
+
+Http2Session::ErrorCode Http2Session::OnData_(const FrameHeader& header, const uint8_t* payload, Buffer& out) {
+  uint32_t id = header.stream_id;
+  if (id == 0) {
+    return PROTOCOL_ERROR;
+  }
+  if (id > last_stream_id_) { // 流还没有打开
+    return PROTOCOL_ERROR;
+  }
+
+  const uint8_t* p = payload;
+  size_t len = header.length;
+  if (header.flags & kFlagPadded) {
+    if (len < 1 || static_cast<size_t>(p[0]) >= len) {
+      return PROTOCOL_ERROR;
+    }
+    len -= 1 + p[0];
+    ++p;
+  }
+
+  // 流量控制: 整个帧(包括填充)计入窗口; 正文很小, 读入后立即归还连接的窗口
+  if (header.length > 0) {
+    WriteWindowUpdate_(out, 0, header.length);
+  }
+
+  auto it = streams_.find(id);
+  if (it == streams_.end()) { // 已经关闭(或被重置)的流, 丢弃
+    return NO_ERROR;
+  }
+  Stream& stream = it->second;
+  if (stream.end_stream_received) {
+    ResetStream_(id, STREAM_CLOSED, out);
+    return NO_ERROR;
+  }
+  if (stream.body.size() + len > kMaxRequestBody) {
+    ResetStream_(id, CANCEL, out);
+    return NO_ERROR;
+  }
+  stream.body.append(reinterpret_cast<const char*>(p), len);
+
+  if (header.flags & kFlagEndStream) {
+    stream.end_stream_received = true;
+    HandleRequest_(stream, out);
+  } else if (header.length > 0) {
+    WriteWindowUpdate_(out, id, header.length);
+  }
+  return NO_ERROR;
+}
+
+Http2Session::ErrorCode Http2Session::OnSettings_(const FrameHeader& header, const uint8_t* payload, Buffer& out) {
+  if (header.stream_id != 0) {
+    return PROTOCOL_ERROR;
+  }
+  if (header.flags & kFlagAck) {
+    return header.length == 0 ? NO_ERROR : FRAME_SIZE_ERROR;
+  }
+  if (header.length % 6 != 0) {
+    return FRAME_SIZE_ERROR;
+  }
+  ErrorCode code = ApplySettings_(payload, header.length);
+  if (code != NO_ERROR) {
+    return code;
+  }
+  WriteFrameHeader_(out, 0, SETTINGS, kFlagAck, 0);
+  return NO_ERROR;
+}
+
+Http2Session::ErrorCode Http2Session::ApplySettings_(const uint8_t* payload, size_t len) {
+  for (size_t i = 0; i + 6 <= len; i += 6) {
+    uint16_t id = (payload[i] << 8) | payload[i + 1];
+    uint32_t value = ReadU32(payload + i + 2);
+    switch (id) {
+      case 0x1: // SETTINGS_HEADER_TABLE_SIZE
+        encoder_.SetMaxTableSize(value);
+        break;
+      case 0x2: // SETTINGS_ENABLE_PUSH
+        if (value > 1) {
+          return PROTOCOL_ERROR;
+        }
+        break;
+      case 0x4: { // SETTINGS_INITIAL_WINDOW_SIZE, 变化量作用到所有流
+        if (value > kMaxWindow) {
+          return FLOW_CONTROL_ERROR;
+        }
+        int64_t delta = static_cast<int64_t>(value) - peer_initial_window_;
+        for (auto& item : streams_) {
+          item.second.send_window += delta;
+          if (item.second.send_window > kMaxWindow) {
+            return FLOW_CONTROL_ERROR;
+          }
+        }
+        peer_initial_window_ = value;
+        break;
+      }
+      case 0x5: // SETTINGS_MAX_FRAME_SIZE
+        if (value < 16384 || value > 16777215) {
+          return PROTOCOL_ERROR;
+        }
+        peer_max_frame_size_ = value;
+        break;
+      default:  // SETTINGS_MAX_CONCURRENT_STREAMS, SETTINGS_MAX_HEADER_LIST_SIZE等不影响服务端
+        break;
+    }
+  }
+  return NO_ERROR;
+}
+
+Http2Session::ErrorCode Http2Session::OnWindowUpdate_(const FrameHeader& header, const uint8_t* payload,
+                                                      Buffer& out) {
+  if (header.length != 4) {
+    return FRAME_SIZE_ERROR;
+  }
+  uint32_t increment = ReadU32(payload) & 0x7fffffff;
+  if (header.stream_id == 0) {
+    if (increment == 0) {
+      return PROTOCOL_ERROR;
+    }
+    conn_send_window_ += increment;
+    return conn_send_window_ > kMaxWindow ? FLOW_CONTROL_ERROR : NO_ERROR;
+  }
+
+  if (header.stream_id > last_stream_id_) {
+    return PROTOCOL_ERROR;
+  }
+  auto it = streams_.find(header.stream_id);
+  if (it == streams_.end()) { // 已经发送完毕的流
+    return NO_ERROR;
+  }
+  if (increment == 0) {
+    ResetStream_(header.stream_id, PROTOCOL_ERROR, out);
+    return NO_ERROR;
+  }
+  it->second.send_window += increment;
+  if (it->second.send_window > kMaxWindow) {
+    ResetStream_(header.stream_id, FLOW_CONTROL_ERROR, out);
+  }
+  return NO_ERROR;
+}
+
+void Http2Session::HandleRequest_(Stream& stream, Buffer& out) {
+  // 转换为HTTP/1.1请求, 交给HttpRequest解析(包括POST登录/注册)
+  std::string method;
+  std::string path;
+  std::string text;
+  for (const auto& field : stream.headers) {
+    if (field.first == ":method") {
+      method = field.second;
+    } else if (field.first == ":path") {
+      path = field.second;
+    } else if (field.first == ":authority") {
+      text += "Host: " + field.second + "\r\n";
+    } else if (!field.first.empty() && field.first[0] != ':') {
+      text += CanonicalName(field.first) + ": " + field.second + "\r\n";
+    }
+  }
+  if (method.empty() || path.empty()) {
+    ResetStream_(stream.id, PROTOCOL_ERROR, out);
+    return;
+  }
+  if (defer_blocking_) {
+    const Router::Route* route = Router::Instance()->Match(Router::ParseMethod(method), path);
+    if (route && route->executor != Router::IO) { // 可能阻塞, 不占用IO线程池
+      if (deferred_.empty()) {
+        deferred_executor_ = route->executor;
+      }
+      deferred_.push_back(stream.id);
+      return;
+    }
+  }
+
+  Buffer request_buff;
+  request_buff.Append(method + " " + path + " HTTP/1.1\r\n" + text + "\r\n");
+  request_buff.Append(stream.body);
+
+  Metrics::Add(Metrics::REQUESTS);
+  Metrics::Add(Metrics::HTTP2_STREAMS);
+  HttpRequest request;
+  bool parsed = request.Parse(request_buff);
+  stream.response.reset(new HttpResponse());
+  Buffer head;
+  HttpConn::BuildResponse(request, parsed, *stream.response, head);
+
+  // 状态行和响应头部转换为HTTP/2头部, 空行之后的内容(内存中的正文)作为DATA发送
+  std::string raw = head.RetrieveAllToStr();
+  size_t head_end = raw.find("\r\n\r\n");
+  if (head_end == std::string::npos) {
+    head_end = raw.size();
+  }
+  std::vector<HeaderField> fields;
+  fields.emplace_back(":status", std::to_string(stream.response->GetCode()));
+  size_t pos = raw.find("\r\n");  // 跳过状态行
+  while (pos != std::string::npos && pos < head_end) {
+    size_t line_begin = pos + 2;
+    size_t line_end = std::min(raw.find("\r\n", line_begin), head_end);
+    size_t colon = raw.find(':', line_begin);
+    if (colon < line_end) {
+      std::string name = raw.substr(line_begin, colon - line_begin);
+      std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+      size_t value_begin = raw.find_first_not_of(' ', colon + 1);
+      size_t value_end = raw.find_last_not_of(' ', line_end - 1);
+      std::string value = value_begin <= value_end && value_begin < line_end
+                          ? raw.substr(value_begin, value_end - value_begin + 1) : "";
+      if (name != "connection" && name != "keep-alive") { // HTTP/2不允许连接相关的头部
+        fields.emplace_back(name, value);
+      }
+    }
+    pos = line_end < head_end ? line_end : std::string::npos;
+  }
+  if (head_end + 4 <= raw.size()) {
+    stream.data = raw.substr(head_end + 4);
+  }
+  if (stream.response->File() && stream.response->FileLen() > 0) {
+    stream.file = stream.response->File();
+    stream.file_len = stream.response->FileLen();
+  }
+
+  // HEADERS帧, 头部块超过对端的最大帧长度时拆分到CONTINUATION帧
+  std::string block;
+  encoder_.Encode(fields, &block);
+  bool end_stream = stream.BodyLen() == 0;
+  size_t offset = 0;
+  uint8_t type = HEADERS;
+  do {
+    size_t chunk = std::min<size_t>(block.size() - offset, peer_max_frame_size_);
+    uint8_t flags = (offset + chunk == block.size()) ? kFlagEndHeaders : 0;
+    if (type == HEADERS && end_stream) {
+      flags |= kFlagEndStream;
+    }
+    WriteFrameHeader_(out, chunk, type, flags, stream.id);
+    out.Append(block.data() + offset, chunk);
+    offset += chunk;
+    type = CONTINUATION;
+  } while (offset < block.size());
+
+  stream.responded = true;
+  if (end_stream) {
+    streams_.erase(stream.id);
+  }
+}
+
+void Http2Session::WriteData_(Buffer& out) {
+  bool progress = true;
+  while (progress && conn_send_window_ > 0 && out.ReadableBytes() < kMaxOutputBytes) {
+    progress = false;
+    // 从上次停下的流开始轮转, 每个流每轮最多一帧
+    auto it = streams_.lower_bound(next_stream_);
+    for (size_t i = 0, n = streams_.size(); i < n && !streams_.empty(); ++i) {
+      if (it == streams_.end()) {
+        it = streams_.begin();
+      }
+      Stream& stream = it->second;
+      if (!stream.responded || stream.send_window <= 0) {
+        ++it;
+        continue;
+      }
+
+      size_t chunk = std::min<size_t>(stream.BodyLen() - stream.sent, peer_max_frame_size_);
+      chunk = std::min<size_t>(chunk, std::min(conn_send_window_, stream.send_window));
+      bool last = stream.sent + chunk == stream.BodyLen();
+      WriteFrameHeader_(out, chunk, DATA, last ? kFlagEndStream : 0, stream.id);
+      size_t copied = 0;
+      if (stream.sent < stream.data.size()) {
+        copied = std::min(chunk, stream.data.size() - stream.sent);
+        out.Append(stream.data.data() + stream.sent, copied);
+      }
+      if (copied < chunk) {
+        out.Append(stream.file + (stream.sent + copied - stream.data.size()), chunk - copied);
+      }
+      stream.sent += chunk;
+      stream.send_window -= chunk;
+      conn_send_window_ -= chunk;
+      progress = true;
+
+      it = last ? streams_.erase(it) : std::next(it);
+      next_stream_ = it == streams_.end() ? 0 : it->first;
+      if (conn_send_window_ <= 0 || out.ReadableBytes() >= kMaxOutputBytes) {
+        break;
+      }
+    }
+  }
+}
+
+void Http2Session::ResetStream_(uint32_t stream_id, ErrorCode code, Buffer& out) {
+  WriteFrameHeader_(out, 4, RST_STREAM, 0, stream_id);
+  uint8_t payload[4] = {static_cast<uint8_t>(code >> 24), static_cast<uint8_t>(code >> 16),
+                        static_cast<uint8_t>(code >> 8), static_cast<uint8_t>(code)};
+  out.Append(payload, 4);
+  streams_.erase(stream_id);
+}
+
+void Http2Session::GoAway_(ErrorCode code, Buffer& out) {
+  LOG_WARN("HTTP/2 connection error: %d", static_cast<int>(code));
+  WriteFrameHeader_(out, 8, GOAWAY, 0, 0);
+  uint8_t payload[8] = {static_cast<uint8_t>(last_stream_id_ >> 24), static_cast<uint8_t>(last_stream_id_ >> 16),
+                        static_cast<uint8_t>(last_stream_id_ >> 8), static_cast<uint8_t>(last_stream_id_),
+                        static_cast<uint8_t>(code >> 24), static_cast<uint8_t>(code >> 16),
+                        static_cast<uint8_t>(code >> 8), static_cast<uint8_t>(code)};
+  out.Append(payload, 8);
+  goaway_sent_ = true;
+  streams_.clear();
+}
+
+void Http2Session::WriteSettings_(Buffer& out) {
+  // SETTINGS_MAX_CONCURRENT_STREAMS和SETTINGS_MAX_HEADER_LIST_SIZE, 其余使用默认值
+  const uint32_t settings[][2] = {{0x3, kMaxConcurrentStreams},
+                                  {0x6, static_cast<uint32_t>(HpackDecoder::kMaxHeaderListSize)}};
+  WriteFrameHeader_(out, sizeof(settings) / sizeof(settings[0]) * 6, SETTINGS, 0, 0);
+  for (const auto& setting : settings) {
+    uint8_t payload[6] = {static_cast<uint8_t>(setting[0] >> 8), static_cast<uint8_t>(setting[0]),
+                          static_cast<uint8_t>(setting[1] >> 24), static_cast<uint8_t>(setting[1] >> 16),
+                          static_cast<uint8_t>(setting[1] >> 8), static_cast<uint8_t>(setting[1])};
+    out.Append(payload, 6);
+  }
+  settings_sent_ = true;
+}
+
+void Http2Session::WriteFrameHeader_(Buffer& out, uint32_t length, uint8_t type, uint8_t flags, uint32_t stream_id) {
+  uint8_t header[9] = {static_cast<uint8_t>(length >> 16), static_cast<uint8_t>(length >> 8),
+                       static_cast<uint8_t>(length), type, flags,
+                       static_cast<uint8_t>((stream_id >> 24) & 0x7f), static_cast<uint8_t>(stream_id >> 16),
+                       static_cast<uint8_t>(stream_id >> 8), static_cast<uint8_t>(stream_id)};
+  out.Append(header, 9);
+}
+
+void Http2Session::WriteWindowUpdate_(Buffer& out, uint32_t stream_id, uint32_t increment) {
+  WriteFrameHeader_(out, 4, WINDOW_UPDATE, 0, stream_id);
+  uint8_t payload[4] = {static_cast<uint8_t>((increment >> 24) & 0x7f), static_cast<uint8_t>(increment >> 16),
+                        static_cast<uint8_t>(increment >> 8), static_cast<uint8_t>(increment)};
+  out.Append(payload, 4);
+}
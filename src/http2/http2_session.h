@@ -0,0 +1,207 @@
+// =============================================================================
+// Created by yangb on 2021/4/26.
+// HTTP/2(h2c, 明文)连接: 帧解析、流的多路复用和流量控制(RFC 7540)
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_HTTP2_HTTP2_SESSION_H_
+#define WEBSERVERCPP11_SRC_HTTP2_HTTP2_SESSION_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../buffer/buffer.h"
+#include "../http/http_response.h"
+#include "../http/router.h"
+#include "hpack.h"
+
+///
+/// @brief 一个HTTP/2连接的状态, 由HttpConn持有
+/// 读缓冲区中的帧在Process中解析, 产生的所有帧(SETTINGS/PING的应答、各个流的HEADERS和DATA)
+/// 追加到同一个写缓冲区, 由HttpConn一次writev发出.
+///
+/// 每个流的请求被转换成HTTP/1.1请求交给HttpRequest解析, 响应由HttpConn::BuildResponse生成
+/// (与HTTP/1.1共用FileCache和mmap), 再把状态行和响应头部转换为HEADERS帧.
+/// 响应正文按流量控制窗口切成DATA帧, 在有数据的流之间轮转发送.
+/// 配置了DB/CPU线程池时, 路由到这些执行器的流先暂存, 由HttpConn交给对应的线程池再处理(见RunDeferred).
+///
+class Http2Session {
+ public:
+  /// 帧类型
+  enum FrameType {
+    DATA = 0x0,
+    HEADERS = 0x1,
+    PRIORITY = 0x2,
+    RST_STREAM = 0x3,
+    SETTINGS = 0x4,
+    PUSH_PROMISE = 0x5,
+    PING = 0x6,
+    GOAWAY = 0x7,
+    WINDOW_UPDATE = 0x8,
+    CONTINUATION = 0x9,
+  };
+
+  /// 错误码
+  enum ErrorCode {
+    NO_ERROR = 0x0,
+    PROTOCOL_ERROR = 0x1,
+    INTERNAL_ERROR = 0x2,
+    FLOW_CONTROL_ERROR = 0x3,
+    STREAM_CLOSED = 0x5,
+    FRAME_SIZE_ERROR = 0x6,
+    REFUSED_STREAM = 0x7,
+    CANCEL = 0x8,
+    COMPRESSION_ERROR = 0x9,
+  };
+
+  /// 客户端连接前言
+  static const char kPreface[];
+  static const size_t kPrefaceLen = 24;
+
+  /// 同时处理的最大流数(SETTINGS_MAX_CONCURRENT_STREAMS)
+  static const uint32_t kMaxConcurrentStreams = 128;
+  /// 接收的最大帧长度(SETTINGS_MAX_FRAME_SIZE, 使用默认值)
+  static const uint32_t kMaxFrameSize = 16384;
+  /// 请求正文的最大长度
+  static const size_t kMaxRequestBody = 1 << 20;
+  /// 头部块(HEADERS + CONTINUATION)的最大长度
+  static const size_t kMaxHeaderBlock = 64 * 1024;
+  /// 每次Process最多生成的输出, 发送完后再继续生成, 限制写缓冲区的大小
+  static const size_t kMaxOutputBytes = 256 * 1024;
+
+  /// @brief buff开头是否为连接前言(数据不完整时比较已有的部分)
+  static bool IsPreface(const Buffer& buff);
+
+  Http2Session();
+  ~Http2Session();
+
+  Http2Session(const Http2Session&) = delete;
+  Http2Session& operator=(const Http2Session&) = delete;
+
+  ///
+  /// @brief 通过HTTP/1.1 Upgrade: h2c升级, 升级请求作为流1处理(RFC 7540 3.2)
+  /// 依次写入101响应、SETTINGS和流1的响应; 之后客户端仍会发送连接前言
+  /// @param settings HTTP2-Settings头部(base64url编码的SETTINGS负载)
+  /// @return false: HTTP2-Settings不合法, 此时不写入任何数据, 按HTTP/1.1处理该请求
+  ///
+  bool Upgrade(const std::string& settings, const std::string& method, const std::string& path, Buffer& out);
+
+  ///
+  /// @brief 解析in中所有完整的帧, 并生成要发送的帧
+  /// @param defer_blocking 路由到DB/CPU执行器的流不在这里处理, 暂存起来(见HasDeferred)
+  ///
+  void Process(Buffer& in, Buffer& out, bool defer_blocking = false);
+
+  /// @brief 是否有暂存的流
+  inline bool HasDeferred() const { return !deferred_.empty(); }
+
+  /// @brief 暂存的流由哪个执行器处理(第一个暂存的流的执行器, 之后暂存的流一起处理)
+  inline Router::Executor DeferredExecutor() const { return deferred_.empty() ? Router::IO : deferred_executor_; }
+
+  /// @brief 处理暂存的流, 在DeferredExecutor()对应的线程池中调用
+  void RunDeferred(Buffer& out);
+
+  /// @brief 拒绝暂存的流(线程池队列满时), 发送RST_STREAM(REFUSED_STREAM), 客户端可以重试
+  void RefuseDeferred(Buffer& out);
+
+  /// @brief 是否应当在发送完输出后关闭连接(已发送GOAWAY, 或对端已发送GOAWAY且没有未完成的流)
+  inline bool IsClosing() const { return goaway_sent_ || (goaway_received_ && streams_.empty()); }
+
+ private:
+  struct FrameHeader {
+    uint32_t length;
+    uint8_t type;
+    uint8_t flags;
+    uint32_t stream_id;
+  };
+
+  struct Stream {
+    uint32_t id = 0;
+    int64_t send_window = 0;        // 发送窗口, 对端修改SETTINGS_INITIAL_WINDOW_SIZE后可能为负
+    bool end_stream_received = false;
+    bool responded = false;
+    std::vector<HeaderField> headers;
+    std::string body;               // 请求正文
+
+    std::unique_ptr<HttpResponse> response; // 持有mmap的文件或FileCache中的条目
+    std::string data;               // 响应正文中在内存里的部分(错误页面, 监控指标等)
+    const char* file = nullptr;     // 响应正文中的文件部分, 在data之后发送
+    size_t file_len = 0;
+    size_t sent = 0;                // 已发送的正文字节数
+
+    inline size_t BodyLen() const { return data.size() + file_len; }
+  };
+
+  /// 帧标志
+  static const uint8_t kFlagEndStream = 0x1;
+  static const uint8_t kFlagAck = 0x1;
+  static const uint8_t kFlagEndHeaders = 0x4;
+  static const uint8_t kFlagPadded = 0x8;
+  static const uint8_t kFlagPriority = 0x20;
+
+  /// 流量控制窗口的最大值
+  static const int64_t kMaxWindow = 0x7fffffff;
+
+  /// @brief 解析in中所有完整的帧
+  void ProcessFrames_(Buffer& in, Buffer& out);
+
+  /// @brief 处理一个帧, 返回连接错误
+  ErrorCode OnFrame_(const FrameHeader& header, const uint8_t* payload, Buffer& out);
+
+  ErrorCode OnHeaders_(const FrameHeader& header, const uint8_t* payload, Buffer& out);
+  ErrorCode OnContinuation_(const FrameHeader& header, const uint8_t* payload, Buffer& out);
+  ErrorCode OnData_(const FrameHeader& header, const uint8_t* payload, Buffer& out);
+  ErrorCode OnSettings_(const FrameHeader& header, const uint8_t* payload, Buffer& out);
+  ErrorCode OnWindowUpdate_(const FrameHeader& header, const uint8_t* payload, Buffer& out);
+
+  /// @brief 应用SETTINGS负载中的参数
+  ErrorCode ApplySettings_(const uint8_t* payload, size_t len);
+
+  /// @brief 头部块接收完整后解码
+  ErrorCode OnHeaderBlock_(Buffer& out);
+
+  /// @brief 请求接收完整, 生成响应的HEADERS帧, 正文留给WriteData_
+  void HandleRequest_(Stream& stream, Buffer& out);
+
+  /// @brief 在有数据待发送的流之间轮转, 按流量控制窗口生成DATA帧
+  void WriteData_(Buffer& out);
+
+  /// @brief 关闭流(发送RST_STREAM)
+  void ResetStream_(uint32_t stream_id, ErrorCode code, Buffer& out);
+
+  /// @brief 连接错误, 发送GOAWAY, 之后不再处理输入
+  void GoAway_(ErrorCode code, Buffer& out);
+
+  void WriteSettings_(Buffer& out);
+  static void WriteFrameHeader_(Buffer& out, uint32_t length, uint8_t type, uint8_t flags, uint32_t stream_id);
+  static void WriteWindowUpdate_(Buffer& out, uint32_t stream_id, uint32_t increment);
+
+ private:
+  bool preface_received_;
+  bool settings_sent_;
+  bool goaway_sent_;
+  bool goaway_received_;
+  uint32_t last_stream_id_;   // 已处理的最大的客户端流ID
+
+  // 正在接收的头部块(HEADERS + CONTINUATION)
+  uint32_t header_stream_id_; // 0: 没有
+  bool header_end_stream_;
+  std::string header_block_;
+
+  // 对端的参数
+  uint32_t peer_max_frame_size_;
+  int64_t peer_initial_window_;
+  int64_t conn_send_window_;
+
+  HpackDecoder decoder_;
+  HpackEncoder encoder_;
+  std::map<uint32_t, Stream> streams_;
+  uint32_t next_stream_;      // WriteData_轮转的起点
+
+  bool defer_blocking_;       // 本次Process是否暂存路由到DB/CPU执行器的流
+  std::vector<uint32_t> deferred_;
+  Router::Executor deferred_executor_;
+};
+
+#endif //WEBSERVERCPP11_SRC_HTTP2_HTTP2_SESSION_H_
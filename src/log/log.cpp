@@ -6,6 +6,7 @@
 #include <sys/time.h>
 #include <cstdarg>
 #include "log.h"
+#include "../pool/cpu_affinity.h"
 
 Log::Log() : write_thread_(nullptr), dque_(nullptr), fp_(nullptr) {}
 
@@ -33,7 +34,8 @@ void Log::FlushLogThread() {
   Log::Instance()->AsyncWrite_();
 }
 
-void Log::Init(int level, const char* path, const char* suffix, int max_queue_capacity) {
+void Log::Init(int level, const char* path, const char* suffix, int max_queue_capacity,
+               const std::vector<int>& writer_cpus) {
   assert(level >= 0);
   assert(path);
   assert(suffix);
@@ -47,7 +49,11 @@ void Log::Init(int level, const char* path, const char* suffix, int max_queue_ca
     is_async_ = true;
     if (!dque_) {
       dque_ = std::make_unique<BlockQueue<std::string>>(max_queue_capacity);
-      write_thread_ = std::make_unique<std::thread>(FlushLogThread);
+      write_thread_ = std::make_unique<std::thread>([writer_cpus] {
+        CpuAffinity::SetThreadName("log-writer");
+        CpuAffinity::PinCurrentThread(writer_cpus);
+        FlushLogThread();
+      });
     } else {
       is_async_ = false;
     }
@@ -7,6 +7,7 @@
 
 #include <memory>
 #include <thread>
+#include <vector>
 #include "block_queue.h"
 #include "../buffer/buffer.h"
 
@@ -18,7 +19,9 @@ class Log {
 
   ~Log();
 
-  void Init(int level = 1, const char* path = "./log", const char* suffix = ".log", int max_queue_capacity = 1024);
+  /// @param writer_cpus 异步日志写线程绑定的CPU, 空: 不绑定
+  void Init(int level = 1, const char* path = "./log", const char* suffix = ".log", int max_queue_capacity = 1024,
+            const std::vector<int>& writer_cpus = {});
   void Write(int level, const char* format, ...);
   void Flush();
 
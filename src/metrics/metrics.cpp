@@ -0,0 +1,185 @@
+// =============================================================================
+// Created by yangb on 2021/4/22.
+// =============================================================================
+
+#include <cstdio>
+#include "metrics.h"
+
+namespace {
+
+struct MetricInfo {
+  const char* name;
+  const char* help;
+};
+
+/// 与Metrics::Counter一一对应
+const MetricInfo kCounterInfo[Metrics::COUNTER_NUM] = {
+    {"webserver_accepted_connections_total", "Accepted client connections."},
+    {"webserver_rejected_connections_total", "Connections refused because the server was full."},
+    {"webserver_executor_rejected_total", "Requests answered with 503 because their executor queue was full."},
+    {"webserver_shed_requests_total", "Requests answered with 503 because the thread pool was overloaded (CoDel)."},
+    {"webserver_ip_conn_limited_total", "Connections refused with 429 by the per-IP connection cap."},
+    {"webserver_ip_rate_limited_total", "Requests answered with 429 by the per-IP token bucket."},
+    {"webserver_idle_evicted_total", "Idle keep-alive connections closed to admit new ones or to stay within budget."},
+    {"webserver_resource_pack_hits_total", "Requests served from the preloaded resource pack."},
+    {"webserver_not_modified_total", "Requests answered with 304 because If-None-Match matched the ETag."},
+    {"webserver_accept_budget_exhausted_total", "Listen events that hit the per-wakeup accept budget."},
+    {"webserver_requests_total", "Processed HTTP requests."},
+    {"webserver_inline_requests_total", "HTTP requests served on the event loop thread."},
+    {"webserver_http2_streams_total", "HTTP/2 streams (requests) served."},
+    {"webserver_tls_handshakes_total", "Completed TLS handshakes."},
+    {"webserver_tls_resumed_total", "TLS handshakes that resumed a session."},
+    {"webserver_tls_ktls_total", "TLS connections sending through kernel TLS."},
+    {"webserver_bad_requests_total", "HTTP requests that failed to parse."},
+    {"webserver_read_bytes_total", "Bytes read from clients."},
+    {"webserver_written_bytes_total", "Bytes written to clients."},
+    {"webserver_timer_expirations_total", "Connections closed by the timer."},
+};
+
+/// 与Metrics::Histogram一一对应
+const MetricInfo kHistogramInfo[Metrics::HISTOGRAM_NUM] = {
+    {"webserver_epoll_wait_seconds", "Time blocked in epoll_wait."},
+    {"webserver_dispatch_seconds", "Time to dispatch one batch of epoll events."},
+    {"webserver_queue_wait_seconds", "Time a task waited in the thread pool queue."},
+    {"webserver_parse_seconds", "Time to parse an HTTP request."},
+    {"webserver_response_build_seconds", "Time to build an HTTP response."},
+    {"webserver_sql_acquire_seconds", "Time to acquire a connection from SqlConnPool."},
+    {"webserver_sql_query_seconds", "Time to run a SQL statement."},
+};
+
+void AppendHelp(std::string* out, const char* name, const char* help, const char* type) {
+  *out += "# HELP ";
+  *out += name;
+  *out += ' ';
+  *out += help;
+  *out += "\n# TYPE ";
+  *out += name;
+  *out += ' ';
+  *out += type;
+  *out += '\n';
+}
+
+/// 追加一行样本: name suffix value, 名字可能很长, 不放进固定大小的缓冲区
+void AppendSample(std::string* out, const char* name, const char* suffix, const char* value) {
+  *out += name;
+  *out += suffix;
+  *out += ' ';
+  *out += value;
+  *out += '\n';
+}
+
+} // namespace
+
+const char* const Metrics::kPath = "/__metrics";
+
+Metrics* Metrics::Instance() {
+  static Metrics metrics;
+  return &metrics;
+}
+
+Metrics::Shard* Metrics::NewShard_() {
+  {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (!free_shards_.empty()) { // 复用已退出线程的分片, 继续累加
+      Shard* shard = free_shards_.back();
+      free_shards_.pop_back();
+      return shard;
+    }
+  }
+  auto* shard = new Shard;
+  for (auto& c : shard->counters) {
+    c.store(0, std::memory_order_relaxed);
+  }
+  for (auto& h : shard->buckets) {
+    for (auto& b : h) {
+      b.store(0, std::memory_order_relaxed);
+    }
+  }
+  for (auto& s : shard->sums) {
+    s.store(0, std::memory_order_relaxed);
+  }
+  std::lock_guard<std::mutex> locker(mtx_);
+  shards_.push_back(shard);
+  return shard;
+}
+
+void Metrics::ReleaseShard_(Shard* shard) {
+  std::lock_guard<std::mutex> locker(mtx_);
+  free_shards_.push_back(shard);
+}
+
+size_t Metrics::ShardCount() const {
+  std::lock_guard<std::mutex> locker(mtx_);
+  return shards_.size();
+}
+
+void Metrics::RegisterGauge(const std::string& name, const std::string& help, const std::function<int64_t()>& getter) {
+  std::lock_guard<std::mutex> locker(mtx_);
+  gauges_.push_back({name, help, getter});
+}
+
+void Metrics::ClearGauges() {
+  std::lock_guard<std::mutex> locker(mtx_);
+  gauges_.clear();
+}
+
+uint64_t Metrics::Get(Counter c) const {
+  std::lock_guard<std::mutex> locker(mtx_);
+  uint64_t total = 0;
+  for (const Shard* shard : shards_) {
+    total += shard->counters[c].load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+std::string Metrics::Render() const {
+  std::lock_guard<std::mutex> locker(mtx_);
+  std::string out;
+  out.reserve(8192);
+  char value[64];
+  char label[64];
+
+  for (int c = 0; c < COUNTER_NUM; ++c) {
+    uint64_t total = 0;
+    for (const Shard* shard : shards_) {
+      total += shard->counters[c].load(std::memory_order_relaxed);
+    }
+    AppendHelp(&out, kCounterInfo[c].name, kCounterInfo[c].help, "counter");
+    snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(total));
+    AppendSample(&out, kCounterInfo[c].name, "", value);
+  }
+
+  for (const auto& gauge : gauges_) {
+    AppendHelp(&out, gauge.name.c_str(), gauge.help.c_str(), "gauge");
+    snprintf(value, sizeof(value), "%lld", static_cast<long long>(gauge.getter()));
+    AppendSample(&out, gauge.name.c_str(), "", value);
+  }
+
+  for (int h = 0; h < HISTOGRAM_NUM; ++h) {
+    uint64_t buckets[kBucketNum] = {0};
+    uint64_t sum_ns = 0;
+    for (const Shard* shard : shards_) {
+      for (int b = 0; b < kBucketNum; ++b) {
+        buckets[b] += shard->buckets[h][b].load(std::memory_order_relaxed);
+      }
+      sum_ns += shard->sums[h].load(std::memory_order_relaxed);
+    }
+
+    const char* name = kHistogramInfo[h].name;
+    AppendHelp(&out, name, kHistogramInfo[h].help, "histogram");
+    uint64_t cumulative = 0;
+    for (int b = 0; b < kBucketNum - 1; ++b) {
+      cumulative += buckets[b];
+      snprintf(label, sizeof(label), "_bucket{le=\"%g\"}", static_cast<double>(1ULL << b) / 1e6);
+      snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(cumulative));
+      AppendSample(&out, name, label, value);
+    }
+    cumulative += buckets[kBucketNum - 1];
+    snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(cumulative));
+    AppendSample(&out, name, "_bucket{le=\"+Inf\"}", value);
+    snprintf(label, sizeof(label), "%.9f", static_cast<double>(sum_ns) / 1e9);
+    AppendSample(&out, name, "_sum", label);
+    AppendSample(&out, name, "_count", value);
+  }
+  return out;
+}
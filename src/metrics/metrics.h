@@ -0,0 +1,166 @@
+// =============================================================================
+// Created by yangb on 2021/4/22.
+// 运行时指标: 计数器 + 延迟直方图, 以Prometheus文本格式导出
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_METRICS_METRICS_H_
+#define WEBSERVERCPP11_SRC_METRICS_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+///
+/// @brief 指标(单例模式)
+/// 每个线程第一次记录时分配一个分片(Shard), 之后只有该线程写自己的分片,
+/// 写操作是relaxed原子操作, 无锁无竞争; 导出时把所有分片相加.
+/// 线程退出时分片(连同计数)放回空闲列表, 由之后新建的线程继续使用, 分片数不超过同时存在的线程数的峰值.
+///
+class Metrics {
+ public:
+  /// @brief 计数器
+  enum Counter {
+    ACCEPTED = 0,     // 接受的连接数
+    REJECTED,         // 因连接数满而拒绝的连接数
+    EXECUTOR_REJECTED,  // 因执行器队列满而返回503的请求数
+    SHED_REQUESTS,    // 线程池过载时丢弃(返回503)的请求数
+    IP_CONN_LIMITED,  // 因来源IP的连接数达到上限而拒绝(返回429)的连接数
+    IP_RATE_LIMITED,  // 因来源IP的请求速率超限而拒绝(返回429)的请求数
+    IDLE_EVICTED,     // 为新连接腾出位置或超过内存预算而关闭的空闲连接数
+    RESOURCE_PACK_HITS,  // 由ResourcePack直接响应的请求数
+    NOT_MODIFIED,     // ETag匹配, 返回304的请求数
+    ACCEPT_BUDGET_EXHAUSTED,  // 一次监听事件用完accept预算的次数
+    REQUESTS,         // 处理的请求数
+    INLINE_REQUESTS,  // 在事件循环线程上处理的请求数
+    HTTP2_STREAMS,    // HTTP/2的请求(流)数
+    TLS_HANDSHAKES,   // 完成的TLS握手数
+    TLS_RESUMED,      // 其中通过会话恢复(票据或缓存)完成的握手数
+    TLS_KTLS,         // 其中使用kTLS发送的连接数
+    BAD_REQUESTS,     // 解析失败的请求数
+    BYTES_READ,       // 读取的字节数
+    BYTES_WRITTEN,    // 发送的字节数
+    TIMER_EXPIRED,    // 超时关闭的定时器数
+    COUNTER_NUM,
+  };
+
+  /// @brief 延迟直方图
+  enum Histogram {
+    EPOLL_WAIT = 0,   // epoll_wait阻塞时间
+    DISPATCH,         // 一轮事件分发的时间
+    QUEUE_WAIT,       // 任务在线程池队列中的等待时间
+    PARSE,            // 解析请求
+    RESPONSE_BUILD,   // 生成响应
+    SQL_ACQUIRE,      // 获取数据库连接
+    SQL_QUERY,        // 执行SQL语句
+    HISTOGRAM_NUM,
+  };
+
+  /// 直方图的桶: 上界依次为 1us, 2us, 4us, ..., 2^(kBucketNum-2)us, +Inf
+  static const int kBucketNum = 24;
+
+  /// 保留的请求路径, 访问该路径返回指标
+  static const char* const kPath;
+
+  static Metrics* Instance();
+
+  /// @brief 计数器加n
+  inline static void Add(Counter c, uint64_t n = 1) {
+    LocalShard_()->counters[c].fetch_add(n, std::memory_order_relaxed);
+  }
+
+  /// @brief 记录一次耗时
+  /// @param ns 耗时, 单位: 纳秒
+  inline static void Observe(Histogram h, int64_t ns) {
+    Shard* shard = LocalShard_();
+    // 向上取整到微秒, 否则1.999us会落在上界为1us的桶中(桶的含义是le, 小于等于上界)
+    uint64_t us = ns > 0 ? (static_cast<uint64_t>(ns) + 999) / 1000 : 0;
+    // 桶下标 = ceil(log2(us)), 0us和1us都落在第0个桶
+    int bucket = us <= 1 ? 0 : 64 - __builtin_clzll(us - 1);
+    if (bucket >= kBucketNum) {
+      bucket = kBucketNum - 1;
+    }
+    shard->buckets[h][bucket].fetch_add(1, std::memory_order_relaxed);
+    shard->sums[h].fetch_add(ns > 0 ? static_cast<uint64_t>(ns) : 0, std::memory_order_relaxed);
+  }
+
+  /// @brief 单调时钟, 单位: 纳秒
+  inline static int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /// @brief 注册一个在导出时读取的瞬时值(如当前连接数)
+  void RegisterGauge(const std::string& name, const std::string& help, const std::function<int64_t()>& getter);
+
+  /// @brief 清除所有瞬时值(其读取函数可能引用了即将销毁的对象)
+  void ClearGauges();
+
+  /// @brief 汇总所有线程的分片, 生成Prometheus文本格式
+  std::string Render() const;
+
+  /// @brief 计数器的当前总值
+  uint64_t Get(Counter c) const;
+
+  /// @brief 已分配的分片数
+  size_t ShardCount() const;
+
+ private:
+  struct Shard {
+    std::atomic<uint64_t> counters[COUNTER_NUM];
+    std::atomic<uint64_t> buckets[HISTOGRAM_NUM][kBucketNum];
+    std::atomic<uint64_t> sums[HISTOGRAM_NUM];  // 单位: 纳秒
+  };
+
+  struct Gauge {
+    std::string name;
+    std::string help;
+    std::function<int64_t()> getter;
+  };
+
+  Metrics() = default;
+  ~Metrics() = default;
+
+  /// 线程的分片, 线程退出时放回空闲列表
+  struct LocalHolder {
+    Shard* shard;
+    LocalHolder() : shard(Instance()->NewShard_()) {}
+    ~LocalHolder() { Instance()->ReleaseShard_(shard); }
+  };
+
+  inline static Shard* LocalShard_() {
+    static thread_local LocalHolder holder;
+    return holder.shard;
+  }
+
+  /// @brief 取一个空闲的分片, 没有时新建
+  Shard* NewShard_();
+
+  /// @brief 线程退出时调用, 分片仍参与导出
+  void ReleaseShard_(Shard* shard);
+
+ private:
+  mutable std::mutex mtx_;
+  std::vector<Shard*> shards_;  // 所有分片, 线程退出后分片保留, 计数不丢失
+  std::vector<Shard*> free_shards_;  // 其中线程已退出的分片
+  std::vector<Gauge> gauges_;
+};
+
+/// @brief 作用域计时, 析构时记录到直方图
+class ScopedLatency {
+ public:
+  explicit ScopedLatency(Metrics::Histogram h) : histogram_(h), start_(Metrics::NowNs()) {}
+  ~ScopedLatency() { Metrics::Observe(histogram_, Metrics::NowNs() - start_); }
+
+  ScopedLatency(const ScopedLatency&) = delete;
+  ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+ private:
+  Metrics::Histogram histogram_;
+  int64_t start_;
+};
+
+#endif //WEBSERVERCPP11_SRC_METRICS_METRICS_H_
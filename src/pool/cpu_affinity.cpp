@@ -0,0 +1,167 @@
+// =============================================================================
+// Created by yangb on 2021/4/30.
+// =============================================================================
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>  // MPOL_PREFERRED
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "cpu_affinity.h"
+
+std::vector<int> CpuAffinity::Parse(const char* spec) {
+  std::vector<int> cpus;
+  if (spec == nullptr || *spec == '\0') {
+    return cpus;
+  }
+  if (strncmp(spec, "node:", 5) == 0) {
+    char* end;
+    long node = strtol(spec + 5, &end, 10);
+    if (end == spec + 5 || *end != '\0' || node < 0) {
+      return cpus;
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%ld/cpulist", node);
+    FILE* fp = fopen(path, "r");
+    if (fp == nullptr) {
+      return cpus;
+    }
+    char list[1024] = {0};
+    if (fgets(list, sizeof(list), fp) != nullptr) {
+      list[strcspn(list, "\n")] = '\0';
+    }
+    fclose(fp);
+    if (!ParseList_(list, &cpus)) {
+      cpus.clear();
+    }
+    return cpus;
+  }
+  if (!ParseList_(spec, &cpus)) {
+    cpus.clear();
+  }
+  return cpus;
+}
+
+bool CpuAffinity::PinCurrentThread(const std::vector<int>& cpus) {
+  if (cpus.empty()) {
+    return true;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu >= CPU_SETSIZE) {
+      return false;
+    }
+    CPU_SET(cpu, &set);
+  }
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    return false;
+  }
+
+  // 绑定在同一个节点上时, 线程之后首次访问的内存(线程局部的缓冲区、指标分片等)从本节点分配;
+  // 跨节点绑定时保持默认策略(首次访问所在的节点)
+  int node = NodeOfCpu(cpus.front());
+  for (int cpu : cpus) {
+    if (NodeOfCpu(cpu) != node) {
+      return true;
+    }
+  }
+  if (node >= 0) {
+    PreferNode_(node);
+  }
+  return true;
+}
+
+void CpuAffinity::SetThreadName(const char* name) {
+  char buf[16];  // 内核限制为16字节, 包括结尾的'\0'
+  snprintf(buf, sizeof(buf), "%s", name);
+  pthread_setname_np(pthread_self(), buf);
+}
+
+int CpuAffinity::NodeOfCpu(int cpu) {
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+  DIR* dir = opendir(path);
+  if (dir == nullptr) {
+    return -1;
+  }
+  int node = -1;
+  while (struct dirent* entry = readdir(dir)) {  // cpuN目录下有指向所在节点的nodeM链接
+    if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+      node = atoi(entry->d_name + 4);
+      break;
+    }
+  }
+  closedir(dir);
+  return node;
+}
+
+std::string CpuAffinity::ToString(const std::vector<int>& cpus) {
+  std::string str;
+  for (size_t i = 0; i < cpus.size();) {
+    size_t j = i;
+    while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+      ++j;
+    }
+    if (!str.empty()) {
+      str += ',';
+    }
+    str += std::to_string(cpus[i]);
+    if (j > i) {
+      str += '-';
+      str += std::to_string(cpus[j]);
+    }
+    i = j + 1;
+  }
+  return str;
+}
+
+bool CpuAffinity::ParseList_(const char* list, std::vector<int>* cpus) {
+  const char* p = list;
+  while (*p != '\0') {
+    char* end;
+    long first = strtol(p, &end, 10);
+    if (end == p || first < 0) {
+      return false;
+    }
+    long last = first;
+    p = end;
+    if (*p == '-') {
+      ++p;
+      last = strtol(p, &end, 10);
+      if (end == p || last < first) {
+        return false;
+      }
+      p = end;
+    }
+    if (last >= CPU_SETSIZE) {
+      return false;
+    }
+    for (long cpu = first; cpu <= last; ++cpu) {
+      cpus->push_back(static_cast<int>(cpu));
+    }
+    if (*p == ',') {
+      ++p;
+    } else if (*p != '\0') {
+      return false;
+    }
+  }
+  std::sort(cpus->begin(), cpus->end());
+  cpus->erase(std::unique(cpus->begin(), cpus->end()), cpus->end());
+  return !cpus->empty();
+}
+
+bool CpuAffinity::PreferNode_(int node) {
+  const unsigned long kMaxNode = sizeof(unsigned long) * 8;
+  if (node >= static_cast<int>(kMaxNode)) {
+    return false;
+  }
+  unsigned long mask = 1UL << node;
+  // 直接使用系统调用, 不引入libnuma的依赖
+  return syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask, kMaxNode) == 0;
+}
@@ -0,0 +1,49 @@
+// =============================================================================
+// Created by yangb on 2021/4/30.
+// 线程的CPU绑定、NUMA内存策略和线程名
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_POOL_CPU_AFFINITY_H_
+#define WEBSERVERCPP11_SRC_POOL_CPU_AFFINITY_H_
+
+#include <string>
+#include <vector>
+
+///
+/// @brief 线程放置相关的工具函数, 都作用于调用线程自己
+/// NUMA拓扑从sysfs(/sys/devices/system/node)读取, 不依赖libnuma
+///
+class CpuAffinity {
+ public:
+  ///
+  /// @brief 解析CPU列表
+  /// @param spec 内核cpulist格式, 如"0-3,8,10-11"; 或"node:N", 表示NUMA节点N上的所有CPU
+  /// @return 升序、去重后的CPU编号; spec为空或格式错误时返回空
+  ///
+  static std::vector<int> Parse(const char* spec);
+
+  ///
+  /// @brief 把调用线程绑定到cpus上, 这些CPU都在同一个NUMA节点上时,
+  /// 同时把线程的内存策略设为优先从该节点分配(之后首次访问的内存都在本节点)
+  /// @return cpus为空时不做任何事, 返回true; 绑定失败(如CPU不存在)返回false
+  ///
+  static bool PinCurrentThread(const std::vector<int>& cpus);
+
+  /// @brief 设置调用线程的名字(top -H、gdb、perf中可见), 超过15个字符时截断
+  static void SetThreadName(const char* name);
+
+  /// @brief cpu所在的NUMA节点, 没有NUMA信息时返回-1
+  static int NodeOfCpu(int cpu);
+
+  /// @brief 把CPU列表格式化为cpulist格式, 用于日志
+  static std::string ToString(const std::vector<int>& cpus);
+
+ private:
+  /// @brief 解析"0-3,8"格式的列表, 失败时返回false
+  static bool ParseList_(const char* list, std::vector<int>* cpus);
+
+  /// @brief 设置内存策略为优先从node分配
+  static bool PreferNode_(int node);
+};
+
+#endif //WEBSERVERCPP11_SRC_POOL_CPU_AFFINITY_H_
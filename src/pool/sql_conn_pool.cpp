@@ -5,6 +5,7 @@
 #include <iostream>
 #include <cassert>
 #include "sql_conn_pool.h"
+#include "../metrics/metrics.h"
 
 SqlConnPool::SqlConnPool() : max_conn_(0) {}
 
@@ -23,6 +24,7 @@ MYSQL* SqlConnPool::GetConn() {
     std::cerr << "SqlConnPool busy!" << std::endl;
     return nullptr;
   }
+  ScopedLatency latency(Metrics::SQL_ACQUIRE);
   sem_wait(&sem_id_);
   {
     std::lock_guard<std::mutex> locker(mtx_);
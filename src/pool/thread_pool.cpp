@@ -0,0 +1,129 @@
+// =============================================================================
+// Created by yangb on 2021/4/30.
+// =============================================================================
+
+#include <chrono>
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(size_t thread_count, const std::vector<int>& cpus, const char* name)
+    : ThreadPool([&] {
+        Options options;
+        options.min_threads = thread_count;
+        options.max_threads = thread_count;
+        options.cpus = cpus;
+        options.name = name;
+        return options;
+      }()) {}
+
+ThreadPool::ThreadPool(const Options& options) : pool_(std::make_shared<Pool>()) {
+  assert(options.min_threads > 0);
+  assert(options.max_threads >= options.min_threads);
+  pool_->options = options;
+  pool_->grow_wait_ns = options.grow_wait_us * 1000;
+  pool_->codel_target_ns = options.codel_target_us * 1000;
+  pool_->codel_interval_ns = options.codel_interval_us * 1000;
+  std::lock_guard<std::mutex> locker(pool_->mtx);
+  for (size_t i = 0; i < options.min_threads; ++i) {
+    Spawn_(pool_);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  if (!static_cast<bool>(pool_)) { // 被移走的对象
+    return;
+  }
+  Shutdown();
+}
+
+void ThreadPool::Shutdown() {
+  std::list<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> locker(pool_->mtx);
+    pool_->is_closed = true;
+    // 关闭后不再有线程因空闲退出, workers不会再变化
+    threads.swap(pool_->workers);
+    threads.splice(threads.end(), pool_->exited);
+  }
+  pool_->cond.notify_all();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Spawn_(const std::shared_ptr<Pool>& pool) {
+  // 回收之前空闲退出的线程, 它们在加入exited之后只剩下返回
+  while (!pool->exited.empty()) {
+    pool->exited.front().join();
+    pool->exited.pop_front();
+  }
+  ++pool->threads;
+  ++pool->idle;
+  pool->thread_count.store(pool->threads, std::memory_order_relaxed);
+  // 先插入再创建线程: 线程持有自己在workers中的位置, 退出时移到exited中
+  auto self = pool->workers.emplace(pool->workers.end());
+  *self = std::thread(Worker_, pool, self, pool->next_id++);
+}
+
+bool ThreadPool::UpdateCodel_(Pool* pool, int64_t now, int64_t sojourn_ns) {
+  if (pool->codel_target_ns <= 0) {
+    return false;
+  }
+  if (sojourn_ns < pool->codel_target_ns || pool->tasks.empty()) { // 没有持续积压的队列
+    pool->codel_first_above_ns = 0;
+    pool->overloaded.store(false, std::memory_order_relaxed);
+  } else if (pool->codel_first_above_ns == 0) {
+    pool->codel_first_above_ns = now + pool->codel_interval_ns;
+  } else if (now >= pool->codel_first_above_ns) { // 整个观察窗口内排队时间都超过目标
+    pool->overloaded.store(true, std::memory_order_relaxed);
+  }
+  return pool->overloaded.load(std::memory_order_relaxed);
+}
+
+void ThreadPool::Worker_(std::shared_ptr<Pool> pool, std::list<std::thread>::iterator self, size_t id) {
+  const Options& options = pool->options;
+  // 先绑定再访问线程局部的数据(指标分片、追踪缓冲区), 使它们分配在本节点的内存上
+  CpuAffinity::SetThreadName((options.name + "-" + std::to_string(id)).c_str());
+  if (!options.cpus.empty()) {
+    CpuAffinity::PinCurrentThread({options.cpus[id % options.cpus.size()]});
+  }
+
+  std::unique_lock<std::mutex> locker(pool->mtx);
+  while (true) {
+    if (!pool->tasks.empty()) {
+      auto task = std::move(pool->tasks.front());
+      pool->tasks.pop();
+      pool->depth.fetch_sub(1, std::memory_order_relaxed);
+      --pool->idle;
+      pool->active_count.store(pool->threads - pool->idle, std::memory_order_relaxed);
+      int64_t now = Metrics::NowNs();
+      int64_t wait_ns = now - task.enqueue_ns;
+      bool shed = UpdateCodel_(pool.get(), now, wait_ns) && task.on_shed;
+      locker.unlock();
+      {
+        Metrics::Observe(Metrics::QUEUE_WAIT, wait_ns);
+        TRACE_SCOPE(shed ? "Shed" : "Task");
+        TRACE_EVENT("QueueWait", task.enqueue_ns, wait_ns);
+        if (shed) {
+          task.on_shed();
+        } else {
+          task.fn(); // 执行函数
+        }
+      }
+      locker.lock();
+      ++pool->idle;
+      pool->active_count.store(pool->threads - pool->idle, std::memory_order_relaxed);
+    } else if (pool->is_closed) {
+      break;
+    } else if (pool->cond.wait_for(locker, std::chrono::milliseconds(options.idle_timeout_ms)) ==
+                   std::cv_status::timeout &&
+               pool->tasks.empty() && !pool->is_closed && pool->threads > options.min_threads) {
+      // 空闲太久, 缩容
+      pool->exited.splice(pool->exited.end(), pool->workers, self);
+      break;
+    }
+  } // while
+  --pool->threads;
+  --pool->idle;
+  pool->thread_count.store(pool->threads, std::memory_order_relaxed);
+  pool->active_count.store(pool->threads - pool->idle, std::memory_order_relaxed);
+}
@@ -9,67 +9,169 @@
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <list>
 #include <functional>
 #include <memory>
 #include <cassert>
 #include <thread>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "cpu_affinity.h"
+#include "../metrics/metrics.h"
+#include "../trace/trace.h"
 
+///
+/// @brief 线程数在[min_threads, max_threads]之间自动调整的线程池
+/// - 扩容: 提交任务时没有空闲线程, 且队首任务已经排队超过grow_wait_us, 新建一个线程
+/// - 缩容: 线程空闲超过idle_timeout_ms, 且线程数多于min_threads时退出
+/// 过载保护(CoDel): 取出的任务排队时间持续超过codel_target_us达codel_interval_us时进入过载状态,
+/// 此时排队超过目标时间的可丢弃任务不执行, 改为执行它的on_shed(如直接返回503), 队列延迟维持在目标附近;
+/// 排队时间回到目标以下或队列取空时退出过载状态
+/// 析构时执行完队列中剩余的任务, 并等待(join)所有线程退出
+///
 class ThreadPool {
  public:
+  struct Options {
+    size_t min_threads = 8;
+    size_t max_threads = 8;
+    /// 排队时间超过该值且没有空闲线程时扩容, 单位: 微秒
+    int64_t grow_wait_us = 2000;
+    /// 多于min_threads的线程空闲超过该值时退出, 单位: 毫秒
+    int idle_timeout_ms = 30000;
+    /// 队列长度上限, 超过时TryAddTask失败; 0: 不限制
+    size_t max_queue = 0;
+    /// CoDel的目标排队时间, 单位: 微秒; 0: 不丢弃任务
+    int64_t codel_target_us = 0;
+    /// CoDel的观察窗口, 排队时间持续超过目标这么久才进入过载状态, 单位: 微秒
+    int64_t codel_interval_us = 100000;
+    /// 非空时第i个线程绑定到cpus[i % cpus.size()]上
+    std::vector<int> cpus;
+    /// 线程名的前缀, 第i个线程命名为"<name>-i"
+    std::string name = "worker";
+  };
+
   ThreadPool() = default;
 
   // 默认 move constructor
   ThreadPool(ThreadPool&&) = default;
 
-  ~ThreadPool() {
-    if (static_cast<bool>(pool_)) {
-      std::lock_guard<std::mutex> locker(pool_->mtx);
-      pool_->is_closed = true;
-    }
-    pool_->cond.notify_all();
-  }
+  ~ThreadPool();
 
-  /// @brief 构造函数
+  /// @brief 构造固定大小的线程池
   /// @param thread_count 线程池中线程的数量
-  explicit ThreadPool(size_t thread_count = 8) : pool_(std::make_shared<Pool>()) {
-    assert(thread_count > 0);
-    for (size_t i = 0; i < thread_count; ++i) {
-      std::thread([pool = pool_] {
-        std::unique_lock<std::mutex> locker(pool->mtx);
-        while (true) {
-          if (!pool->tasks.empty()) {
-            auto task = std::move(pool->tasks.front());
-            pool->tasks.pop();
-            locker.unlock();
-            task(); // 执行函数
-            locker.lock();
-          } else if (pool->is_closed) {
-            break;
-          } else {
-            pool->cond.wait(locker);
-          }
-        } // while
-      }).detach();
-    } // for
-  } // ThreadPool
+  /// @param cpus 非空时第i个线程绑定到cpus[i % cpus.size()]上
+  /// @param name 线程名的前缀
+  explicit ThreadPool(size_t thread_count = 8, const std::vector<int>& cpus = {}, const char* name = "worker");
 
+  /// @brief 构造线程池, 初始有min_threads个线程
+  explicit ThreadPool(const Options& options);
+
+  ///
+  /// @brief 关闭线程池: 执行完已提交的任务后等待所有线程退出, 析构时自动调用.
+  /// 关闭后提交的任务被丢弃(TryAddTask返回false); 多个线程池的任务互相提交时, 先全部关闭再析构
+  ///
+  void Shutdown();
+
+  /// @brief 提交任务
+  /// @param on_shed 非空时任务可以丢弃: 过载时不执行task, 改为执行on_shed
   template <typename F>
-  void AddTask(F&& task) {
-    {
-      std::lock_guard<std::mutex> locker(pool_->mtx);
-      pool_->tasks.emplace(std::forward<F>(task));
-    }
-    pool_->cond.notify_one();
+  void AddTask(F&& task, std::function<void()> on_shed = nullptr) {
+    Push_(std::forward<F>(task), std::move(on_shed), false);
+  }
+
+  /// @brief 提交任务, 队列长度达到Options::max_queue或已关闭时不提交, 返回false
+  template <typename F>
+  bool TryAddTask(F&& task, std::function<void()> on_shed = nullptr) {
+    return Push_(std::forward<F>(task), std::move(on_shed), true);
+  }
+
+  /// @brief 队列中等待执行的任务数(无锁读取, 用于监控)
+  size_t QueueSize() const {
+    return pool_->depth.load(std::memory_order_relaxed);
+  }
+
+  /// @brief 当前的线程数(无锁读取, 用于监控)
+  size_t ThreadCount() const {
+    return pool_->thread_count.load(std::memory_order_relaxed);
+  }
+
+  /// @brief 正在执行任务的线程数(无锁读取, 用于监控)
+  size_t ActiveCount() const {
+    return pool_->active_count.load(std::memory_order_relaxed);
+  }
+
+  /// @brief 是否处于过载状态(无锁读取, 用于监控)
+  bool IsOverloaded() const {
+    return pool_->overloaded.load(std::memory_order_relaxed);
   }
 
  private:
+  struct Task {
+    int64_t enqueue_ns; // 入队时间, 用于统计排队延迟和扩容
+    std::function<void()> fn;
+    std::function<void()> on_shed;  // 过载时代替fn执行, 为空时任务不能丢弃
+  };
+
   struct Pool {
     std::mutex mtx;
     std::condition_variable cond;
-    bool is_closed;
-    std::queue<std::function<void()>> tasks;
+    bool is_closed = false;
+    std::queue<Task> tasks;
+    std::atomic<size_t> depth{0};
+
+    Options options;
+    int64_t grow_wait_ns = 0;
+    size_t threads = 0;   // 存活的线程数
+    size_t idle = 0;      // 等待任务的线程数, 包括刚创建还没开始运行的
+    size_t next_id = 0;   // 下一个线程的编号
+    std::list<std::thread> workers;  // 存活的线程
+    std::list<std::thread> exited;   // 缩容时退出、还没有join的线程
+    std::atomic<size_t> thread_count{0};
+    std::atomic<size_t> active_count{0};
+
+    int64_t codel_target_ns = 0;
+    int64_t codel_interval_ns = 0;
+    int64_t codel_first_above_ns = 0;  // 排队时间超过目标后, 这一时刻之后仍然超过则进入过载状态; 0: 没有超过
+    std::atomic<bool> overloaded{false};
   };
 
+  /// @brief 提交任务, bounded: 是否检查队列长度上限
+  template <typename F>
+  bool Push_(F&& task, std::function<void()>&& on_shed, bool bounded) {
+    int64_t now = Metrics::NowNs();
+    {
+      std::lock_guard<std::mutex> locker(pool_->mtx);
+      if (pool_->is_closed) { // 线程可能都已退出, 也不能再创建线程
+        return false;
+      }
+      if (bounded && pool_->options.max_queue > 0 && pool_->tasks.size() >= pool_->options.max_queue) {
+        return false;
+      }
+      pool_->tasks.push(Task{now, std::forward<F>(task), std::move(on_shed)});
+      pool_->depth.fetch_add(1, std::memory_order_relaxed);
+      if (pool_->idle == 0 && pool_->threads < pool_->options.max_threads &&
+          now - pool_->tasks.front().enqueue_ns >= pool_->grow_wait_ns) {
+        Spawn_(pool_);
+      }
+    }
+    pool_->cond.notify_one();
+    return true;
+  }
+
+  /// @brief 新建一个线程, 调用时持有pool->mtx
+  static void Spawn_(const std::shared_ptr<Pool>& pool);
+
+  ///
+  /// @brief 取出任务时更新CoDel的状态, 调用时持有pool->mtx
+  /// @param sojourn_ns 任务的排队时间
+  /// @return 是否处于过载状态
+  ///
+  static bool UpdateCodel_(Pool* pool, int64_t now, int64_t sojourn_ns);
+
+  /// @brief 线程的主循环
+  static void Worker_(std::shared_ptr<Pool> pool, std::list<std::thread>::iterator self, size_t id);
+
  private:
   std::shared_ptr<Pool> pool_;
 };
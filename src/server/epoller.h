@@ -10,19 +10,20 @@
 #include <fcntl.h>  // fcntl
 #include <unistd.h> // close
 #include <cassert>
+#include "poller.h"
 
-class Epoller {
+class Epoller : public Poller {
  public:
   explicit Epoller(int max_event = 1024) : epoll_fd_(epoll_create(512)), events_(max_event) {
     assert(epoll_fd_ >= 0 && !events_.empty());
   }
 
-  ~Epoller() {
+  ~Epoller() override {
     close(epoll_fd_);
   }
 
   /// @brief 添加
-  inline bool AddFd(int fd, uint32_t events) { // NOLINT
+  inline bool AddFd(int fd, uint32_t events) override { // NOLINT
     if (fd < 0) {
       return false;
     }
@@ -34,7 +35,7 @@ class Epoller {
   }
 
   /// @brief 修改
-  inline bool ModFd(int fd, uint32_t events) {  // NOLINT
+  inline bool ModFd(int fd, uint32_t events) override {  // NOLINT
     if (fd < 0) {
       return false;
     }
@@ -46,7 +47,7 @@ class Epoller {
   }
 
   /// @brief 删除
-  inline bool DelFd(int fd) { // NOLINT
+  inline bool DelFd(int fd) override { // NOLINT
     if (fd < 0) {
       return false;
     }
@@ -55,20 +56,22 @@ class Epoller {
     return (0 == epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, &ev));
   }
 
-  inline int Wait(int timeout/*ms*/ = -1) {
+  inline int Wait(int timeout/*ms*/ = -1) override {
     return epoll_wait(epoll_fd_, &events_[0], static_cast<int>(events_.size()), timeout);
   }
 
-  inline int GetEventFd(size_t i) const {
+  inline int GetEventFd(size_t i) const override {
     assert(i < events_.size() && i >= 0);
     return events_[i].data.fd;
   }
 
-  inline uint32_t GetEvents(size_t i) const {
+  inline uint32_t GetEvents(size_t i) const override {
     assert(i < events_.size() && i >= 0);
     return events_[i].events;
   }
 
+  inline const char* Name() const override { return "epoll"; }
+
  private:
   int epoll_fd_;
   std::vector<struct epoll_event> events_;
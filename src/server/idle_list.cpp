@@ -0,0 +1,82 @@
+// =============================================================================
+// Created by yangb on 2021/5/2.
+// =============================================================================
+
+#include <cassert>
+#include "idle_list.h"
+
+IdleList::IdleList() : head_(-1), tail_(-1), size_(0), bytes_(0) {}
+
+void IdleList::Add(int fd, size_t bytes) {
+  assert(fd >= 0);
+  std::lock_guard<std::mutex> locker(mtx_);
+  Link_(fd, bytes);
+}
+
+bool IdleList::Remove(int fd) {
+  std::lock_guard<std::mutex> locker(mtx_);
+  if (fd < 0 || static_cast<size_t>(fd) >= nodes_.size() || !nodes_[fd].linked) {
+    return false;
+  }
+  Unlink_(fd);
+  return true;
+}
+
+int IdleList::PopOldest() {
+  std::lock_guard<std::mutex> locker(mtx_);
+  int fd = head_;
+  if (fd >= 0) {
+    Unlink_(fd);
+  }
+  return fd;
+}
+
+size_t IdleList::Size() const {
+  std::lock_guard<std::mutex> locker(mtx_);
+  return size_;
+}
+
+size_t IdleList::Bytes() const {
+  std::lock_guard<std::mutex> locker(mtx_);
+  return bytes_;
+}
+
+void IdleList::Link_(int fd, size_t bytes) {
+  if (static_cast<size_t>(fd) >= nodes_.size()) {
+    nodes_.resize(fd + 1);
+  }
+  if (nodes_[fd].linked) {
+    Unlink_(fd);
+  }
+  Node& node = nodes_[fd];
+  node.prev = tail_;
+  node.next = -1;
+  node.linked = true;
+  node.bytes = bytes;
+  if (tail_ >= 0) {
+    nodes_[tail_].next = fd;
+  } else {
+    head_ = fd;
+  }
+  tail_ = fd;
+  ++size_;
+  bytes_ += bytes;
+}
+
+void IdleList::Unlink_(int fd) {
+  Node& node = nodes_[fd];
+  assert(node.linked);
+  if (node.prev >= 0) {
+    nodes_[node.prev].next = node.next;
+  } else {
+    head_ = node.next;
+  }
+  if (node.next >= 0) {
+    nodes_[node.next].prev = node.prev;
+  } else {
+    tail_ = node.prev;
+  }
+  node.linked = false;
+  --size_;
+  bytes_ -= node.bytes;
+}
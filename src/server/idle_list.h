@@ -0,0 +1,79 @@
+// =============================================================================
+// Created by yangb on 2021/5/2.
+// 空闲连接表: 按LRU顺序记录等待下一个请求的keep-alive连接
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_SERVER_IDLE_LIST_H_
+#define WEBSERVERCPP11_SRC_SERVER_IDLE_LIST_H_
+
+#include <cassert>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+///
+/// @brief 以文件描述符为下标的侵入式双向链表, 表头是最久未使用的连接, 插入、删除、取出都是O(1)
+/// 连接在工作线程上变为空闲(Add), 在事件循环线程上变为活跃或被淘汰(Remove/PopOldest), 用一把锁保护
+///
+class IdleList {
+ public:
+  IdleList();
+
+  ///
+  /// @brief 连接变为空闲, 加入表尾; 已在表中时移到表尾
+  /// @param bytes 连接占用的缓冲区大小, 计入Bytes()
+  ///
+  void Add(int fd, size_t bytes);
+
+  ///
+  /// @brief 同Add, 并在持有锁时调用arm()重新注册读事件. 工作线程上加入空闲表用这个版本:
+  /// 加入后、注册前淘汰会关闭还在被工作线程使用的连接, 注册后、加入前收到的请求又无法把它移出表;
+  /// 持有锁时事件循环的Remove/PopOldest要等注册完成, 两种情况都不会发生
+  ///
+  template<typename Arm>
+  void Add(int fd, size_t bytes, Arm&& arm) {
+    assert(fd >= 0);
+    std::lock_guard<std::mutex> locker(mtx_);
+    Link_(fd, bytes);
+    arm();
+  }
+
+  ///
+  /// @brief 连接变为活跃(收到请求)或关闭时移出表
+  /// @return 是否在表中
+  ///
+  bool Remove(int fd);
+
+  /// @brief 取出最久未使用的空闲连接, 表为空时返回-1
+  int PopOldest();
+
+  /// @brief 空闲连接数
+  size_t Size() const;
+
+  /// @brief 空闲连接占用的缓冲区总大小, 单位: 字节
+  size_t Bytes() const;
+
+ private:
+  struct Node {
+    int prev = -1;
+    int next = -1;
+    bool linked = false;
+    size_t bytes = 0;
+  };
+
+  /// @brief 把fd加入表尾(已在表中时先摘下), 调用时持有mtx_
+  void Link_(int fd, size_t bytes);
+
+  /// @brief 从链表中摘下fd, 调用时持有mtx_且fd在表中
+  void Unlink_(int fd);
+
+ private:
+  mutable std::mutex mtx_;
+  std::vector<Node> nodes_;  // 按需扩大到最大的fd
+  int head_;  // 最久未使用
+  int tail_;  // 最近变为空闲
+  size_t size_;
+  size_t bytes_;
+};
+
+#endif //WEBSERVERCPP11_SRC_SERVER_IDLE_LIST_H_
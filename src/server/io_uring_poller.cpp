@@ -0,0 +1,281 @@
+// =============================================================================
+// Created by yangb on 2021/4/24.
+// =============================================================================
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include "io_uring_poller.h"
+
+namespace {
+
+const unsigned kSqEntries = 4096;
+const unsigned kCqEntries = 65536;  // 每个连接最多一个在途poll, 按最大连接数设置
+const uint64_t kIgnoreUserData = UINT64_MAX;  // 不关心完成结果的请求(如POLL_REMOVE)
+const uint32_t kPollMask = EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLRDHUP | EPOLLERR | EPOLLHUP;
+
+inline int IoUringSetup(unsigned entries, struct io_uring_params* p) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+inline int IoUringEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void* arg, size_t argsz) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz));
+}
+
+} // namespace
+
+std::unique_ptr<IoUringPoller> IoUringPoller::Create(int max_event) {
+  std::unique_ptr<IoUringPoller> poller(new IoUringPoller(max_event));
+  if (!poller->Setup_(kSqEntries)) {
+    return nullptr;
+  }
+  return poller;
+}
+
+IoUringPoller::IoUringPoller(int max_event)
+    : ring_fd_(-1), sq_entries_(0), cq_entries_(0),
+      sq_ptr_(MAP_FAILED), sq_size_(0), sq_head_(nullptr), sq_tail_(nullptr), sq_mask_(nullptr),
+      sq_array_(nullptr), sqes_(static_cast<struct io_uring_sqe*>(MAP_FAILED)), sqes_size_(0),
+      sqe_tail_(0), to_submit_(0),
+      cq_ptr_(MAP_FAILED), cq_size_(0), cq_head_(nullptr), cq_tail_(nullptr), cq_mask_(nullptr), cqes_(nullptr),
+      max_event_(max_event) {
+  assert(max_event > 0);
+  ready_.reserve(max_event);
+}
+
+IoUringPoller::~IoUringPoller() {
+  if (sqes_ != MAP_FAILED) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (sq_ptr_ != MAP_FAILED) {
+    munmap(sq_ptr_, sq_size_);
+  }
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+  }
+}
+
+bool IoUringPoller::Setup_(unsigned entries) {
+  struct io_uring_params params{};
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = kCqEntries;
+  ring_fd_ = IoUringSetup(entries, &params);
+  if (ring_fd_ < 0) {
+    return false;
+  }
+  // 需要: SQ/CQ共用一次mmap, 带超时的io_uring_enter
+  if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+    return false;
+  }
+  sq_entries_ = params.sq_entries;
+  cq_entries_ = params.cq_entries;
+
+  sq_size_ = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+  sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ptr_ == MAP_FAILED) {
+    return false;
+  }
+  cq_ptr_ = sq_ptr_;
+  cq_size_ = sq_size_;
+
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  sqes_ = static_cast<struct io_uring_sqe*>(mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                                                 MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+  if (sqes_ == MAP_FAILED) {
+    return false;
+  }
+
+  auto* sq = static_cast<char*>(sq_ptr_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  sqe_tail_ = *sq_tail_;
+
+  auto* cq = static_cast<char*>(cq_ptr_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+  return true;
+}
+
+struct io_uring_sqe* IoUringPoller::GetSqe_() {
+  unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  if (sqe_tail_ - head >= sq_entries_) { // 提交队列满, 先提交
+    Submit_();
+    head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sqe_tail_ - head >= sq_entries_) {
+      return nullptr;
+    }
+  }
+  unsigned index = sqe_tail_ & *sq_mask_;
+  struct io_uring_sqe* sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sq_array_[index] = index;
+  ++sqe_tail_;
+  ++to_submit_;
+  return sqe;
+}
+
+int IoUringPoller::Submit_() {
+  __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+  unsigned n = to_submit_;
+  to_submit_ = 0;
+  if (n == 0) {
+    return 0;
+  }
+  return IoUringEnter(ring_fd_, n, 0, 0, nullptr, 0);
+}
+
+IoUringPoller::FdState& IoUringPoller::State_(int fd) {
+  if (static_cast<size_t>(fd) >= fd_states_.size()) {
+    fd_states_.resize(std::max<size_t>(fd + 1, fd_states_.size() * 2));
+  }
+  return fd_states_[fd];
+}
+
+bool IoUringPoller::PrepPollAdd_(int fd, FdState& state) {
+  struct io_uring_sqe* sqe = GetSqe_();
+  if (!sqe) {
+    return false;
+  }
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = state.events & kPollMask;  // EPOLLET/EPOLLONESHOT由本类处理
+  sqe->user_data = UserData_(fd, state.gen);
+  state.armed = true;
+  return true;
+}
+
+void IoUringPoller::PrepPollRemove_(int fd, FdState& state) {
+  if (state.armed) {
+    struct io_uring_sqe* sqe = GetSqe_();
+    if (sqe) {
+      sqe->opcode = IORING_OP_POLL_REMOVE;
+      sqe->fd = -1;
+      sqe->addr = UserData_(fd, state.gen);
+      sqe->user_data = kIgnoreUserData;
+    }
+    state.armed = false;
+  }
+  ++state.gen;  // 旧请求的完成事件(如果已经产生)将被丢弃
+}
+
+bool IoUringPoller::AddFd(int fd, uint32_t events) {
+  if (fd < 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> locker(mtx_);
+  FdState& state = State_(fd);
+  if (state.registered) {
+    return false;
+  }
+  ++state.gen;
+  state.events = events;
+  state.registered = true;
+  bool ok = PrepPollAdd_(fd, state);
+  if (!InLoop_()) {
+    Submit_();
+  }
+  return ok;
+}
+
+bool IoUringPoller::ModFd(int fd, uint32_t events) {
+  if (fd < 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> locker(mtx_);
+  FdState& state = State_(fd);
+  if (!state.registered) {
+    return false;
+  }
+  PrepPollRemove_(fd, state);
+  state.events = events;
+  bool ok = PrepPollAdd_(fd, state);
+  if (!InLoop_()) {
+    Submit_();
+  }
+  return ok;
+}
+
+bool IoUringPoller::DelFd(int fd) {
+  if (fd < 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> locker(mtx_);
+  if (static_cast<size_t>(fd) >= fd_states_.size() || !fd_states_[fd].registered) {
+    return false;
+  }
+  FdState& state = fd_states_[fd];
+  PrepPollRemove_(fd, state);
+  state.registered = false;
+  if (!InLoop_()) {
+    Submit_();
+  }
+  return true;
+}
+
+int IoUringPoller::Wait(int timeout) {
+  unsigned to_submit;
+  bool has_cqe;
+  {
+    std::lock_guard<std::mutex> locker(mtx_);
+    loop_thread_ = std::this_thread::get_id();
+    __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+    to_submit = to_submit_;
+    to_submit_ = 0;
+    has_cqe = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE) != *cq_head_;
+  }
+
+  // 提交本轮积累的所有请求, 并等待至少一个完成事件
+  struct __kernel_timespec ts{};
+  struct io_uring_getevents_arg arg{};
+  if (timeout >= 0) {
+    ts.tv_sec = timeout / 1000;
+    ts.tv_nsec = static_cast<long long>(timeout % 1000) * 1000000;
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+  }
+  unsigned min_complete = (timeout == 0 || has_cqe) ? 0 : 1;
+  int ret = IoUringEnter(ring_fd_, to_submit, min_complete,
+                         IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+  if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+    return -1;
+  }
+
+  std::lock_guard<std::mutex> locker(mtx_);
+  ready_.clear();
+  unsigned head = *cq_head_;
+  unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  for (; head != tail && ready_.size() < max_event_; ++head) {
+    const struct io_uring_cqe* cqe = &cqes_[head & *cq_mask_];
+    if (cqe->user_data == kIgnoreUserData) {
+      continue;
+    }
+    int fd = static_cast<int>(cqe->user_data & 0xffffffffu);
+    auto gen = static_cast<uint32_t>(cqe->user_data >> 32);
+    if (static_cast<size_t>(fd) >= fd_states_.size()) {
+      continue;
+    }
+    FdState& state = fd_states_[fd];
+    if (!state.registered || state.gen != gen) { // 已删除或已修改, 过期的完成事件
+      continue;
+    }
+    state.armed = false;
+    if (cqe->res == -ECANCELED) {
+      continue;
+    }
+    uint32_t events = cqe->res < 0 ? EPOLLERR : static_cast<uint32_t>(cqe->res);
+    ready_.push_back({fd, events});
+    if (!(state.events & EPOLLONESHOT)) { // 非oneshot, 自动重新注册, 随下一次Wait提交
+      PrepPollAdd_(fd, state);
+    }
+  }
+  __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+  return static_cast<int>(ready_.size());
+}
@@ -0,0 +1,114 @@
+// =============================================================================
+// Created by yangb on 2021/4/24.
+// 基于io_uring的I/O多路复用后端(直接使用系统调用, 不依赖liburing)
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_SERVER_IO_URING_POLLER_H_
+#define WEBSERVERCPP11_SRC_SERVER_IO_URING_POLLER_H_
+
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "poller.h"
+
+///
+/// @brief 用IORING_OP_POLL_ADD实现epoll语义的后端.
+/// 与epoll的区别在于: 事件循环线程上的AddFd/ModFd/DelFd只把SQE放进提交队列,
+/// 到下一次Wait时与等待合并为一次io_uring_enter, 因此处理完一批事件后重新注册
+/// 的所有fd只需要一次系统调用; 其他线程上的修改则立即提交, 开销与epoll_ctl相同.
+///
+/// - 带EPOLLONESHOT的fd: 每次就绪后poll请求即失效, 等待ModFd重新注册;
+/// - 不带EPOLLONESHOT的fd(如监听socket): 就绪后自动重新注册, 随下一次Wait提交.
+///
+/// 需要内核支持IORING_FEAT_EXT_ARG(5.11+), 否则Create返回nullptr.
+///
+class IoUringPoller : public Poller {
+ public:
+  /// @brief 创建, 内核不支持时返回nullptr
+  static std::unique_ptr<IoUringPoller> Create(int max_event = 1024);
+
+  ~IoUringPoller() override;
+
+  bool AddFd(int fd, uint32_t events) override;
+  bool ModFd(int fd, uint32_t events) override;
+  bool DelFd(int fd) override;
+  int Wait(int timeout/*ms*/ = -1) override;
+
+  inline int GetEventFd(size_t i) const override { return ready_[i].fd; }
+  inline uint32_t GetEvents(size_t i) const override { return ready_[i].events; }
+  inline const char* Name() const override { return "io_uring"; }
+
+ private:
+  /// @brief 每个fd的注册信息
+  struct FdState {
+    uint32_t gen = 0;       // 每次注册/取消时自增, 用于丢弃过期的完成事件
+    uint32_t events = 0;
+    bool registered = false;
+    bool armed = false;     // 是否有尚未完成的POLL_ADD请求
+  };
+
+  struct ReadyEvent {
+    int fd;
+    uint32_t events;
+  };
+
+  explicit IoUringPoller(int max_event);
+
+  bool Setup_(unsigned entries);
+
+  /// @brief 获取一个空闲的SQE, 提交队列满时先提交(需持有mtx_)
+  struct io_uring_sqe* GetSqe_();
+
+  /// @brief 放入一个POLL_ADD请求(需持有mtx_)
+  bool PrepPollAdd_(int fd, FdState& state);
+
+  /// @brief 取消尚未完成的POLL_ADD请求, 并使其完成事件失效(需持有mtx_)
+  void PrepPollRemove_(int fd, FdState& state);
+
+  /// @brief 提交队列中尚未提交的SQE(需持有mtx_)
+  int Submit_();
+
+  inline bool InLoop_() const { return std::this_thread::get_id() == loop_thread_; }
+
+  inline static uint64_t UserData_(int fd, uint32_t gen) {
+    return (static_cast<uint64_t>(gen) << 32) | static_cast<uint32_t>(fd);
+  }
+
+  FdState& State_(int fd);
+
+ private:
+  int ring_fd_;
+  unsigned sq_entries_;
+  unsigned cq_entries_;
+
+  // 提交队列(SQ)
+  void* sq_ptr_;
+  size_t sq_size_;
+  unsigned* sq_head_;     // 由内核推进, 使用__atomic读取
+  unsigned* sq_tail_;
+  unsigned* sq_mask_;
+  unsigned* sq_array_;
+  struct io_uring_sqe* sqes_;
+  size_t sqes_size_;
+  unsigned sqe_tail_;     // 本地的SQ尾部, 提交时写回sq_tail_
+  unsigned to_submit_;    // 已放入但尚未提交的SQE数
+
+  // 完成队列(CQ)
+  void* cq_ptr_;
+  size_t cq_size_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;     // 由内核推进
+  unsigned* cq_mask_;
+  struct io_uring_cqe* cqes_;
+
+  std::mutex mtx_;  // 保护提交队列和fd_states_
+  std::vector<FdState> fd_states_;
+  std::vector<ReadyEvent> ready_;
+  size_t max_event_;
+  std::thread::id loop_thread_;  // 调用Wait的线程(需持有mtx_)
+};
+
+#endif //WEBSERVERCPP11_SRC_SERVER_IO_URING_POLLER_H_
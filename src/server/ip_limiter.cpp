@@ -0,0 +1,152 @@
+// =============================================================================
+// Created by yangb on 2021/5/1.
+// =============================================================================
+
+#include <cassert>
+#include "ip_limiter.h"
+
+namespace {
+
+/// @brief 纳秒 -> 毫秒(截断为32位, 只用于计算间隔)
+inline uint32_t ToMs(int64_t now_ns) {
+  return static_cast<uint32_t>(now_ns / 1000000);
+}
+
+} // namespace
+
+IpLimiter::IpLimiter() : max_conns_(0), rate_(0), burst_ms_(0) {
+  Init(0, 0, 1);
+}
+
+void IpLimiter::Init(int max_conns, double rate, double burst) {
+  assert(max_conns >= 0 && rate >= 0);
+  max_conns_ = max_conns < UINT16_MAX ? max_conns : UINT16_MAX;
+  rate_ = rate;
+  burst_ms_ = static_cast<int32_t>((burst < 1 ? 1 : burst) * 1000);
+  for (Shard& shard : shards_) {
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    shard.slots.assign(kInitSlots, Entry{});
+    shard.size = 0;
+  }
+}
+
+bool IpLimiter::AcquireConn(uint32_t ip, int64_t now_ns) {
+  uint32_t hash = Hash_(ip);
+  Shard& shard = ShardOf_(hash);
+  std::lock_guard<std::mutex> locker(shard.mtx);
+  Entry* entry = FindOrInsert_(shard, ip, hash, ToMs(now_ns));
+  if (max_conns_ > 0 && entry->conns >= max_conns_) {
+    return false;
+  }
+  if (entry->conns < UINT16_MAX) {
+    ++entry->conns;
+  }
+  return true;
+}
+
+void IpLimiter::ReleaseConn(uint32_t ip, int64_t now_ns) {
+  uint32_t hash = Hash_(ip);
+  Shard& shard = ShardOf_(hash);
+  std::lock_guard<std::mutex> locker(shard.mtx);
+  Entry* entry = FindOrInsert_(shard, ip, hash, ToMs(now_ns));
+  if (entry->conns > 0) {
+    --entry->conns;
+  }
+}
+
+bool IpLimiter::AllowRequest(uint32_t ip, int64_t now_ns) {
+  if (rate_ <= 0) {
+    return true;
+  }
+  uint32_t hash = Hash_(ip);
+  Shard& shard = ShardOf_(hash);
+  std::lock_guard<std::mutex> locker(shard.mtx);
+  uint32_t now_ms = ToMs(now_ns);
+  Entry* entry = FindOrInsert_(shard, ip, hash, now_ms);
+  Refill_(entry, now_ms);
+  if (entry->tokens_ms < 1000) {
+    return false;
+  }
+  entry->tokens_ms -= 1000;
+  return true;
+}
+
+size_t IpLimiter::Size() const {
+  size_t size = 0;
+  for (const Shard& shard : shards_) {
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    size += shard.size;
+  }
+  return size;
+}
+
+size_t IpLimiter::MaxProbe() const {
+  size_t max_probe = 0;
+  for (const Shard& shard : shards_) {
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    size_t mask = shard.slots.size() - 1;
+    for (size_t i = 0; i < shard.slots.size(); ++i) {
+      if (shard.slots[i].used) {
+        size_t probe = (i - Hash_(shard.slots[i].ip)) & mask;
+        max_probe = probe > max_probe ? probe : max_probe;
+      }
+    }
+  }
+  return max_probe;
+}
+
+IpLimiter::Entry* IpLimiter::FindOrInsert_(Shard& shard, uint32_t ip, uint32_t hash, uint32_t now_ms) {
+  if ((shard.size + 1) * 4 > shard.slots.size() * 3) { // 装载因子不超过3/4
+    Rebuild_(shard, now_ms);
+  }
+  size_t mask = shard.slots.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    Entry& entry = shard.slots[i];
+    if (!entry.used) {
+      entry = Entry{ip, 0, 1, burst_ms_, now_ms};
+      ++shard.size;
+      return &entry;
+    }
+    if (entry.ip == ip) {
+      return &entry;
+    }
+  }
+}
+
+void IpLimiter::Refill_(Entry* entry, uint32_t now_ms) const {
+  uint32_t elapsed = now_ms - entry->last_ms;
+  entry->last_ms = now_ms;
+  double tokens = entry->tokens_ms + elapsed * rate_;
+  entry->tokens_ms = tokens < burst_ms_ ? static_cast<int32_t>(tokens) : burst_ms_;
+}
+
+bool IpLimiter::Expired_(const Entry& entry, uint32_t now_ms) const {
+  if (entry.conns > 0) {
+    return false;
+  }
+  return rate_ <= 0 || entry.tokens_ms + (now_ms - entry.last_ms) * rate_ >= burst_ms_;
+}
+
+void IpLimiter::Rebuild_(Shard& shard, uint32_t now_ms) {
+  std::vector<Entry> live;
+  live.reserve(shard.size);
+  for (const Entry& entry : shard.slots) {
+    if (entry.used && !Expired_(entry, now_ms)) {
+      live.push_back(entry);
+    }
+  }
+  size_t slots = shard.slots.size();
+  while ((live.size() + 1) * 2 > slots) { // 清除后仍然超过一半时扩容
+    slots *= 2;
+  }
+  shard.slots.assign(slots, Entry{});
+  shard.size = live.size();
+  size_t mask = slots - 1;
+  for (const Entry& entry : live) {
+    size_t i = Hash_(entry.ip) & mask;
+    while (shard.slots[i].used) {
+      i = (i + 1) & mask;
+    }
+    shard.slots[i] = entry;
+  }
+}
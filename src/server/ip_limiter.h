@@ -0,0 +1,111 @@
+// =============================================================================
+// Created by yangb on 2021/5/1.
+// 按来源IP限制连接数和请求速率
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_SERVER_IP_LIMITER_H_
+#define WEBSERVERCPP11_SRC_SERVER_IP_LIMITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+///
+/// @brief 每个来源IP一个条目: 在线连接数和请求的令牌桶
+/// 按IP的哈希分成kShardNum个分片, 每个分片一把锁(连接在事件循环线程上建立, 在工作线程上关闭);
+/// 分片内是线性探测的开放寻址表, 条目只有16字节. 没有连接且令牌桶已满(长时间没有请求)的条目视为过期,
+/// 表快满时先清除过期条目再决定是否扩容, 不需要单独的清理线程
+///
+class IpLimiter {
+ public:
+  IpLimiter();
+
+  ///
+  /// @brief 设置限制, 清空所有条目
+  /// @param max_conns 每个IP同时在线的最大连接数, 0: 不限制
+  /// @param rate 每个IP每秒补充的令牌数(每个请求一个令牌), 0: 不限制请求速率
+  /// @param burst 令牌桶的容量(允许的突发请求数), 不小于1
+  ///
+  void Init(int max_conns, double rate, double burst);
+
+  /// @brief 是否开启了连接数限制
+  inline bool LimitsConns() const { return max_conns_ > 0; }
+
+  /// @brief 是否开启了请求速率限制
+  inline bool LimitsRate() const { return rate_ > 0; }
+
+  ///
+  /// @brief 新连接建立时调用
+  /// @return 该IP的连接数已达上限时返回false(连接数不增加)
+  ///
+  bool AcquireConn(uint32_t ip, int64_t now_ns);
+
+  /// @brief 连接关闭时调用, 与AcquireConn成功的调用一一对应
+  void ReleaseConn(uint32_t ip, int64_t now_ns);
+
+  ///
+  /// @brief 收到请求时调用, 从令牌桶中取出一个令牌
+  /// @return 令牌不足时返回false
+  ///
+  bool AllowRequest(uint32_t ip, int64_t now_ns);
+
+  /// @brief 表中的条目数(包括还没清除的过期条目)
+  size_t Size() const;
+
+  /// @brief 最长的探测距离(条目离它的起始槽有多远), 用于检查哈希分布
+  size_t MaxProbe() const;
+
+ private:
+  static const int kShardNum = 16;
+  static const size_t kInitSlots = 64;   // 每个分片初始的槽数, 2的幂
+
+  struct Entry {
+    uint32_t ip;
+    uint16_t conns;      // 在线连接数
+    uint16_t used;       // 槽是否被占用
+    int32_t tokens_ms;   // 上次更新时的令牌数(千分之一个令牌为单位)
+    uint32_t last_ms;    // 上次更新的时间(毫秒, 只用于计算间隔, 允许回绕)
+  };
+
+  struct Shard {
+    mutable std::mutex mtx;
+    std::vector<Entry> slots;
+    size_t size = 0;
+  };
+
+  ///
+  /// @brief IP的哈希值(murmur3的fmix32), 高位选分片, 低位选槽
+  /// IP是网络字节序, 同一网段的地址低位字节相同; 只做乘法时低位只取决于低位, 整个网段会落到同一个起始槽
+  ///
+  inline static uint32_t Hash_(uint32_t ip) {
+    ip ^= ip >> 16;
+    ip *= 0x85ebca6bu;
+    ip ^= ip >> 13;
+    ip *= 0xc2b2ae35u;
+    ip ^= ip >> 16;
+    return ip;
+  }
+
+  inline Shard& ShardOf_(uint32_t hash) { return shards_[hash >> 28]; }
+
+  /// @brief 查找ip的条目, 没有时插入新条目(令牌桶是满的), 调用时持有shard的锁
+  Entry* FindOrInsert_(Shard& shard, uint32_t ip, uint32_t hash, uint32_t now_ms);
+
+  /// @brief 把令牌补充到now_ms
+  void Refill_(Entry* entry, uint32_t now_ms) const;
+
+  /// @brief 条目是否可以清除: 没有连接, 且令牌桶已经补满
+  bool Expired_(const Entry& entry, uint32_t now_ms) const;
+
+  /// @brief 清除过期条目, 剩下的条目仍然太多时扩容, 调用时持有shard的锁
+  void Rebuild_(Shard& shard, uint32_t now_ms);
+
+ private:
+  int max_conns_;
+  double rate_;       // 每毫秒补充的令牌数(千分之一个令牌为单位), 即每秒的令牌数
+  int32_t burst_ms_;  // 令牌桶容量(千分之一个令牌为单位)
+  Shard shards_[kShardNum];
+};
+
+#endif //WEBSERVERCPP11_SRC_SERVER_IP_LIMITER_H_
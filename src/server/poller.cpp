@@ -0,0 +1,19 @@
+// =============================================================================
+// Created by yangb on 2021/4/24.
+// =============================================================================
+
+#include "poller.h"
+#include "epoller.h"
+#include "io_uring_poller.h"
+#include "../log/log.h"
+
+std::unique_ptr<Poller> Poller::Create(Backend backend, int max_event) {
+  if (backend == IO_URING) {
+    std::unique_ptr<Poller> poller = IoUringPoller::Create(max_event);
+    if (poller) {
+      return poller;
+    }
+    LOG_WARN("io_uring is not available, fall back to epoll!");
+  }
+  return std::unique_ptr<Poller>(new Epoller(max_event));
+}
@@ -0,0 +1,55 @@
+// =============================================================================
+// Created by yangb on 2021/4/24.
+// I/O多路复用后端的抽象接口
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_SERVER_POLLER_H_
+#define WEBSERVERCPP11_SRC_SERVER_POLLER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+///
+/// @brief I/O多路复用后端, 接口语义与epoll一致:
+/// 事件使用EPOLLIN/EPOLLOUT/EPOLLRDHUP/EPOLLET/EPOLLONESHOT等标志;
+/// AddFd/ModFd/DelFd可以在任意线程调用, Wait/GetEventFd/GetEvents只在事件循环线程调用.
+///
+class Poller {
+ public:
+  /// @brief 后端类型
+  enum Backend {
+    EPOLL = 0,
+    IO_URING,
+  };
+
+  virtual ~Poller() = default;
+
+  /// @brief 添加
+  virtual bool AddFd(int fd, uint32_t events) = 0;
+
+  /// @brief 修改
+  virtual bool ModFd(int fd, uint32_t events) = 0;
+
+  /// @brief 删除
+  virtual bool DelFd(int fd) = 0;
+
+  /// @brief 等待事件
+  /// @param timeout 超时时间, 单位: ms, -1表示一直等待
+  /// @return 就绪的事件数
+  virtual int Wait(int timeout/*ms*/ = -1) = 0;
+
+  virtual int GetEventFd(size_t i) const = 0;
+
+  virtual uint32_t GetEvents(size_t i) const = 0;
+
+  /// @brief 后端名称
+  virtual const char* Name() const = 0;
+
+  /// @brief 创建后端, 指定的后端不可用时退回epoll
+  /// @param backend 希望使用的后端
+  /// @param max_event 每次Wait最多返回的事件数
+  static std::unique_ptr<Poller> Create(Backend backend, int max_event = 1024);
+};
+
+#endif //WEBSERVERCPP11_SRC_SERVER_POLLER_H_
@@ -0,0 +1,118 @@
+// =============================================================================
+// Created by yangb on 2021/4/24.
+// 服务器的可选配置
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_SERVER_SERVER_OPTIONS_H_
+#define WEBSERVERCPP11_SRC_SERVER_SERVER_OPTIONS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include "poller.h"
+
+///
+/// @brief WebServer构造函数之外的可选配置, 默认值即原有行为
+///
+struct ServerOptions {
+  /// @brief 连接数超过上限时的处理方式
+  enum ShedPolicy {
+    SHED_503 = 0, // 发送预先生成的503响应后关闭
+    SHED_RST,     // 直接发送RST(SO_LINGER超时为0), 不产生TIME_WAIT
+  };
+
+  /// I/O多路复用后端, 不可用时退回epoll
+  Poller::Backend io_backend = Poller::EPOLL;
+
+  /// listen的backlog(全连接队列长度), 实际值受限于net.core.somaxconn
+  int listen_backlog = 1024;
+  /// 每次监听事件最多accept的连接数, 防止连接风暴时饿死已有连接的事件
+  int accept_budget = 64;
+  /// TCP_DEFER_ACCEPT(单位: 秒), 客户端发来数据后才唤醒accept; 0: 不开启
+  int defer_accept_s = 0;
+  /// TCP_FASTOPEN的队列长度; 0: 不开启
+  int tcp_fastopen_qlen = 0;
+  /// 同时在线的最大连接数, 超过后按shed_policy拒绝
+  int max_connections = 65536;
+  ShedPolicy shed_policy = SHED_503;
+
+  /// 空闲连接管理: 等待下一个请求的keep-alive连接按LRU顺序记录, 并释放多余的缓冲区;
+  /// 连接数达到max_connections或fd耗尽时先关闭最久未使用的空闲连接, 接受新连接而不是拒绝它
+  bool idle_lru = false;
+  /// 空闲连接占用的缓冲区总大小上限, 超过时关闭最久未使用的空闲连接, 单位: 字节; 0: 不限制(需开启idle_lru)
+  size_t idle_memory_budget = 0;
+
+  /// 每个来源IP同时在线的最大连接数, 超过时返回429并关闭; 0: 不限制
+  int max_conns_per_ip = 0;
+  /// 每个来源IP的请求速率(令牌桶, 每次读事件算一个请求): 每秒补充ip_request_rate个令牌,
+  /// 最多积攒ip_request_burst个(0: 等于ip_request_rate), 令牌不足时返回429并关闭; 0: 不限制
+  double ip_request_rate = 0;
+  double ip_request_burst = 0;
+
+  /// 连接超时由注册在Poller中的timerfd驱动: timerfd可读时才批量处理到期的定时器, epoll_wait不再带超时,
+  /// 事件分发不再穿插定时器的处理; 触发时间按timer_slack_ms向上取整, 相近的超时合并为一次唤醒
+  bool timer_fd = false;
+  int timer_slack_ms = 10;
+
+  /// 连接上开启TCP_NODELAY(关闭Nagle算法), 响应的最后一个小报文段不等待ACK
+  bool tcp_nodelay = false;
+  /// 一个响应需要多次系统调用发送时(响应头部 + sendfile的正文, 或流水线中的多个响应),
+  /// 发送期间开启TCP_CORK, 全部写入后再取消, 只发出满的报文段
+  bool tcp_cork = false;
+  /// 连接的发送缓冲区大小(SO_SNDBUF), 单位: 字节; 0: 使用系统默认值(自动调整)
+  int so_sndbuf = 0;
+
+  /// 线程池的线程数范围, 0: 使用WebServer构造函数的thread_num(即固定大小)
+  /// 没有空闲线程且任务排队超过worker_grow_wait_us时扩容, 多出的线程空闲超过worker_idle_timeout_ms后退出
+  size_t worker_threads_min = 0;
+  size_t worker_threads_max = 0;
+  int64_t worker_grow_wait_us = 2000;
+  int worker_idle_timeout_ms = 30000;
+
+  /// 过载保护(CoDel): 线程池中任务的排队时间持续超过shed_target_us达shed_interval_us时, 排队超过目标的新请求
+  /// 不再处理, 直接返回预先生成的503并关闭连接, 已在处理中的请求照常完成; 0: 不开启
+  int64_t shed_target_us = 0;
+  int64_t shed_interval_us = 100000;
+
+  /// 执行器(见Router::Executor): 可能阻塞的处理函数(DB, 如登录/注册查询数据库)和计算量较大的处理函数(CPU)
+  /// 在各自的线程池中执行, 数据库变慢时不会占满处理静态文件的线程(IO, 即上面配置的线程池)
+  /// 线程数为0时与IO共用线程池
+  size_t db_threads = 0;
+  size_t cpu_threads = 0;
+  /// 单独的DB/CPU线程池的队列长度上限, 超过时直接返回503; 0: 不限制
+  size_t db_queue_limit = 0;
+  size_t cpu_queue_limit = 0;
+
+  /// CPU绑定, 内核cpulist格式("0-3,8")或"node:N"(NUMA节点N上的所有CPU); nullptr: 不绑定.
+  /// 绑定在同一个NUMA节点内时, 线程的内存也优先从该节点分配
+  /// 事件循环(调用Start的线程)
+  const char* loop_cpus = nullptr;
+  /// 线程池的工作线程, 依次轮流绑定到其中的一个CPU上
+  const char* worker_cpus = nullptr;
+  /// 异步日志的写线程
+  const char* log_cpus = nullptr;
+
+  /// 快速路径: 事件循环线程直接读取、解析并发送命中FileCache的GET请求,
+  /// 只有需要阻塞的请求(SQL, 未缓存的文件)交给线程池, 发送返回EAGAIN时才注册EPOLLOUT
+  bool inline_fast_path = false;
+  /// FileCache可缓存的最大文件, 单位: 字节; 0: 不缓存
+  size_t file_cache_max_file = 64 * 1024;
+  /// FileCache的总大小上限, 单位: 字节
+  size_t file_cache_capacity = 32 * 1024 * 1024;
+
+  /// 资源包(见ResourcePack): 启动时把资源目录下不超过resource_pack_max_file的文件载入一块连续的只读内存,
+  /// 附带预先生成的响应头部、ETag和gzip版本, 命中时不再stat/open, 返回的正文不复制
+  bool resource_pack = false;
+  size_t resource_pack_max_file = 1024 * 1024;
+  /// 资源包文件: 不存在时生成并保存, 之后启动直接mmap(资源更新后删除它即可重新生成); nullptr: 每次启动遍历资源目录
+  const char* resource_pack_file = nullptr;
+
+  /// TLS的证书(链)和私钥, PEM格式; 都设置时监听端口只接受TLS连接, nullptr: 不开启
+  const char* tls_cert_file = nullptr;
+  const char* tls_key_file = nullptr;
+  /// 内核支持时(tls模块)使用kTLS发送, 响应正文由内核加密, 不经过用户态复制
+  bool tls_ktls = true;
+  /// 服务端会话缓存的条目数, 0: 只使用会话票据(session ticket)
+  size_t tls_session_cache = 20480;
+};
+
+#endif //WEBSERVERCPP11_SRC_SERVER_SERVER_OPTIONS_H_
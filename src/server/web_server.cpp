@@ -4,6 +4,18 @@
 
 #include "web_server.h"
 
+const char WebServer::kBusyResponse[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Connection: close\r\n"
+    "Retry-After: 1\r\n"
+    "Content-Length: 0\r\n\r\n";
+
+const char WebServer::kTooManyResponse[] =
+    "HTTP/1.1 429 Too Many Requests\r\n"
+    "Connection: close\r\n"
+    "Retry-After: 1\r\n"
+    "Content-Length: 0\r\n\r\n";
+
 WebServer::WebServer(int port,
                      int trig_mode,
                      int timeout,
@@ -16,29 +28,46 @@ WebServer::WebServer(int port,
                      int thread_num,
                      bool open_log,
                      int log_level,
-                     int log_que_size) : port_(port),
+                     int log_que_size,
+                     const ServerOptions& options) : port_(port),
                                          open_linger_(opt_linger),
                                          timeout_(timeout),
                                          is_close_(false),
                                          timer_(new HeapTimer()),
-                                         thread_pool_(new ThreadPool(thread_num)),
-                                         epoller_(new Epoller()) {
+                                         thread_pool_(new ThreadPool(PoolOptions_(thread_num, options))),
+                                         options_(options),
+                                         epoller_(Poller::Create(options.io_backend)) {
+  idle_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
   src_dir_ = getcwd(nullptr, 256);
   assert(src_dir_);
   strncat(src_dir_, "/resources/", 16);
 
   HttpConn::user_count = 0;
   HttpConn::kSrcDir = src_dir_;
+  HttpConn::tcp_cork = options_.tcp_cork;
+  FileCache::Instance()->Init(options_.file_cache_max_file, options_.file_cache_capacity);
+  bool pack_loaded = false;
+  if (options_.resource_pack) {
+    pack_loaded = ResourcePack::Instance()->Init(src_dir_, options_.resource_pack_file, options_.resource_pack_max_file);
+  } else {
+    ResourcePack::Instance()->Clear();
+  }
+  ip_limiter_.Init(options_.max_conns_per_ip, options_.ip_request_rate,
+                   options_.ip_request_burst > 0 ? options_.ip_request_burst : options_.ip_request_rate);
   SqlConnPool::Instance()->Init("localhost", sql_port, sql_user, sql_passwd, db_name, conn_pool_num);
 
   InitEventMode_(trig_mode);
+  InitTimer_();
+  InitExecutors_();
+  InitMetrics_();
+  InitRoutes_();
 
   if (!InitSocket_()) {
     is_close_ = true;
   }
 
   if (open_log) {
-    Log::Instance()->Init(log_level, "./log", ".log", log_que_size);
+    Log::Instance()->Init(log_level, "./log", ".log", log_que_size, CpuAffinity::Parse(options_.log_cpus));
     if (is_close_) {
       LOG_ERROR("============== Server init error! ==============");
     } else {
@@ -48,8 +77,49 @@ WebServer::WebServer(int port,
                (listen_event_ & EPOLLET ? "ET" : "LT"),
                (conn_event_ & EPOLLET ? "ET" : "LT"));
       LOG_INFO("Log level(0: debug, 1: info, 2: warn, 3: error): %d", log_level);
+      LOG_INFO("IO backend: %s", epoller_->Name());
+      LOG_INFO("Max connections: %d\t\tAccept budget: %d", options_.max_connections, options_.accept_budget);
+      LOG_INFO("Timer: %s\t\tSlack: %d ms", timer_fd_ ? "timerfd" : "epoll_wait timeout", options_.timer_slack_ms);
+      LOG_INFO("Idle LRU: %s\t\tIdle memory budget: %zu bytes", options_.idle_lru ? "on" : "off",
+               options_.idle_memory_budget);
+      LOG_INFO("Inline fast path: %s\t\tFile cache: %zu bytes", options_.inline_fast_path ? "on" : "off",
+               options_.file_cache_capacity);
+      LOG_INFO("Scan kernel: %s", Scan::Name(Scan::Current()));
+      if (pack_loaded) {
+        LOG_INFO("Resource pack: %zu files, %zu bytes", ResourcePack::Instance()->Count(),
+                 ResourcePack::Instance()->Bytes());
+      } else if (options_.resource_pack) {
+        LOG_WARN("Load resource pack error, serve files from %s", src_dir_);
+      }
+      LOG_INFO("TCP_NODELAY: %s\t\tTCP_CORK: %s\t\tSO_SNDBUF: %d", options_.tcp_nodelay ? "on" : "off",
+               options_.tcp_cork ? "on" : "off", options_.so_sndbuf);
+      LOG_INFO("CPU affinity: loop [%s]\t\tworker [%s]\t\tlog [%s]",
+               CpuAffinity::ToString(CpuAffinity::Parse(options_.loop_cpus)).c_str(),
+               CpuAffinity::ToString(CpuAffinity::Parse(options_.worker_cpus)).c_str(),
+               CpuAffinity::ToString(CpuAffinity::Parse(options_.log_cpus)).c_str());
+      for (const char* spec : {options_.loop_cpus, options_.worker_cpus, options_.log_cpus}) {
+        if (spec && CpuAffinity::Parse(spec).empty()) {
+          LOG_WARN("Invalid CPU list \"%s\", thread not pinned", spec);
+        }
+      }
       LOG_INFO("Source Dir: %s", HttpConn::kSrcDir);
-      LOG_INFO("SqlConnPool num: %d\t\tThreadPool num: %d", conn_pool_num, thread_num);
+      ThreadPool::Options pool_options = PoolOptions_(thread_num, options_);
+      LOG_INFO("SqlConnPool num: %d\t\tThreadPool num: %zu-%zu", conn_pool_num,
+               pool_options.min_threads, pool_options.max_threads);
+      LOG_INFO("Per-IP max connections: %d\t\tPer-IP request rate: %g/s", options_.max_conns_per_ip,
+               options_.ip_request_rate);
+      LOG_INFO("Shed target: %lld us\t\tShed interval: %lld us", static_cast<long long>(options_.shed_target_us),
+               static_cast<long long>(options_.shed_interval_us));
+      LOG_INFO("DB executor: %zu threads, queue limit %zu\t\tCPU executor: %zu threads, queue limit %zu",
+               options_.db_threads, options_.db_queue_limit, options_.cpu_threads, options_.cpu_queue_limit);
+    }
+  }
+
+  if (options_.tls_cert_file || options_.tls_key_file) { // 配置了TLS但加载失败时不启动, 避免以明文提供服务
+    if (!TlsContext::Instance()->Init(options_.tls_cert_file, options_.tls_key_file,
+                                      options_.tls_ktls, options_.tls_session_cache)) {
+      LOG_ERROR("============== TLS init error! ==============");
+      is_close_ = true;
     }
   }
 
@@ -57,20 +127,42 @@ WebServer::WebServer(int port,
 
 void WebServer::Start() {
   int time_ms = -1; // epoll wait timeout == -1 无事件阻塞
+  // 在循环线程上绑定, 之后首次访问的线程局部数据分配在本节点; 主线程的名字即进程名, 不修改
+  if (!CpuAffinity::PinCurrentThread(CpuAffinity::Parse(options_.loop_cpus))) {
+    LOG_WARN("Pin event loop to CPU [%s] failed", options_.loop_cpus);
+  }
   if (!is_close_) {
     LOG_INFO("============== Server start ==============");
   }
   while (!is_close_) {
-    if (timeout_ > 0) {
+    if (timer_fd_) {
+      uint32_t expires;
+      if (timer_->NextExpires(&expires)) {
+        timer_fd_->Arm(expires, timer_->NowMs());
+      }
+    } else if (timeout_ > 0) {
       time_ms = timer_->GetNextTick();
     }
-    int event_cnt = epoller_->Wait(time_ms);
+    int64_t wait_start = Metrics::NowNs();
+    int event_cnt;
+    {
+      TRACE_SCOPE("EpollWait");
+      event_cnt = epoller_->Wait(time_ms);
+    }
+    timer_->UpdateClock();  // 本轮事件的超时时间都从这一时刻算起, 处理事件时不再读取时钟
+    TRACE_SCOPE("Dispatch");
+    int64_t dispatch_start = Metrics::NowNs();
+    Metrics::Observe(Metrics::EPOLL_WAIT, dispatch_start - wait_start);
+    bool timer_fired = false;
+    bool listen_ready = false;
     for (int i = 0; i < event_cnt; ++i) { // 处理事件
       int fd = epoller_->GetEventFd(i);
       uint32_t events = epoller_->GetEvents(i);
 
-      if (fd == listen_fd_) {  // 监听事件
-        DealListen_();
+      if (fd == listen_fd_) {  // 监听事件: 本轮的连接事件处理完后再accept
+        listen_ready = true;
+      } else if (timer_fd_ && fd == timer_fd_->GetFd()) { // 定时器: 本轮的连接事件处理完后再执行
+        timer_fired = true;
       } else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) { // 关闭连接
         assert(users_.count(fd) > 0);
         CloseConn_(&users_[fd]);
@@ -84,9 +176,47 @@ void WebServer::Start() {
         LOG_ERROR("Unexpected event!");
       } // if
     } // for
+    // 超时关闭的连接在本轮中可能还有读写事件, 先执行定时器会把事件分发给已关闭的连接(并Adjust已删除的定时器)
+    if (timer_fired) {
+      OnTimer_();
+    }
+    // accept时可能淘汰空闲连接, 新连接通常复用它的fd; 本轮中该fd还没分发的事件会被当成新连接的事件
+    if (listen_ready) {
+      DealListen_();
+    }
+    if (event_cnt > 0) {
+      Metrics::Observe(Metrics::DISPATCH, Metrics::NowNs() - dispatch_start);
+    }
+    // 工作线程把连接加入空闲表后由事件循环淘汰, 淘汰与空闲连接的读事件都在本线程上处理
+    if (options_.idle_lru && options_.idle_memory_budget > 0) {
+      while (idle_.Bytes() > options_.idle_memory_budget && EvictIdle_()) {
+      }
+    }
   } // while
 }
 
+void WebServer::InitTimer_() {
+  if (!options_.timer_fd || timeout_ <= 0) {
+    return;
+  }
+  timer_fd_.reset(new TimerFd(options_.timer_slack_ms));
+  if (timer_fd_->GetFd() < 0 || !epoller_->AddFd(timer_fd_->GetFd(), EPOLLIN)) {
+    LOG_WARN("Create timerfd error, timers fall back to epoll_wait timeout!");
+    timer_fd_.reset();
+  }
+}
+
+void WebServer::OnTimer_() {
+  uint32_t fired_at;
+  if (!timer_fd_->Consume(&fired_at)) {
+    return;
+  }
+  TRACE_SCOPE("Timer");
+  // 粗粒度时钟可能还没走到触发时间, 但触发时间之前的定时器都已到期
+  uint32_t now = timer_->NowMs();
+  timer_->TickUntil(LoopClock::Before(now, fired_at) ? fired_at : now);
+}
+
 bool WebServer::InitSocket_() {
   if (port_ < 1024 || port_ > 65535) {
     LOG_ERROR("Port: %d error!", port_);
@@ -105,7 +235,7 @@ bool WebServer::InitSocket_() {
     opt_linger.l_onoff = 1;
   }
 
-  listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
   if (listen_fd_ < 0) {
     LOG_ERROR("[Port:%d]Create socket error!", port_);
     return false;
@@ -135,7 +265,37 @@ bool WebServer::InitSocket_() {
     return false;
   }
 
-  ret = listen(listen_fd_, 6);
+  if (options_.defer_accept_s > 0) {
+    // 三次握手完成后, 等客户端发来数据(或超时)才放入全连接队列
+    ret = setsockopt(listen_fd_, IPPROTO_TCP, TCP_DEFER_ACCEPT, &options_.defer_accept_s, sizeof(int));
+    if (ret < 0) {
+      LOG_WARN("Set TCP_DEFER_ACCEPT error!");
+    }
+  }
+
+  if (options_.tcp_fastopen_qlen > 0) {
+    ret = setsockopt(listen_fd_, IPPROTO_TCP, TCP_FASTOPEN, &options_.tcp_fastopen_qlen, sizeof(int));
+    if (ret < 0) {
+      LOG_WARN("Set TCP_FASTOPEN error!");
+    }
+  }
+
+  // 以下两个选项由accept得到的连接继承, 不需要对每个连接设置
+  if (options_.tcp_nodelay) {
+    ret = setsockopt(listen_fd_, IPPROTO_TCP, TCP_NODELAY, &opt_val, sizeof(int));
+    if (ret < 0) {
+      LOG_WARN("Set TCP_NODELAY error!");
+    }
+  }
+
+  if (options_.so_sndbuf > 0) {
+    ret = setsockopt(listen_fd_, SOL_SOCKET, SO_SNDBUF, &options_.so_sndbuf, sizeof(int));
+    if (ret < 0) {
+      LOG_WARN("Set SO_SNDBUF error!");
+    }
+  }
+
+  ret = listen(listen_fd_, options_.listen_backlog);
   if (ret < 0) {
     LOG_ERROR("Listen port:%d error!", port_);
     close(listen_fd_);
@@ -149,8 +309,7 @@ bool WebServer::InitSocket_() {
     return false;
   }
 
-  SetFdNonBlock_(listen_fd_);
-  LOG_INFO("Server port:%d", port_);
+  LOG_INFO("Server port:%d, backlog: %d", port_, options_.listen_backlog);
   return true;
 }
 
@@ -178,18 +337,288 @@ void WebServer::InitEventMode_(int trig_mode) {
 }
 
 void WebServer::DealListen_() {
+  TRACE_SCOPE("Accept");
   struct sockaddr_in addr{};
-  socklen_t len = sizeof(addr);
-  do {
-    int fd = accept(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), &len);
-    if (fd <= 0) {
+  // LT和ET模式都最多accept accept_budget个连接, 剩下的留到下一轮事件循环
+  const int max_conn = options_.max_connections < kMaxFd ? options_.max_connections : kMaxFd;
+  for (int i = 0; i < options_.accept_budget; ++i) {
+    socklen_t len = sizeof(addr);
+    // accept4直接设置非阻塞, 省去fcntl
+    int fd = accept4(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      if (errno == EMFILE || errno == ENFILE) {
+        if (options_.idle_lru && EvictIdle_()) { // 关闭一个空闲连接腾出fd, 重新accept
+          continue;
+        }
+        ShedOnFdExhausted_();
+      } else if (errno != EAGAIN) {
+        LOG_WARN("Accept error: %s", strerror(errno));
+      }
       return;
-    } else if (HttpConn::user_count >= kMaxFd) {
-      SendError_(fd, "Server busy!");
+    }
+    if (HttpConn::user_count >= max_conn && !(options_.idle_lru && EvictIdle_())) {
       LOG_WARN("Clients are full!");
-      return;
+      Metrics::Add(Metrics::REJECTED);
+      Shed_(fd);
+      continue;
+    }
+    if (ip_limiter_.LimitsConns() && !ip_limiter_.AcquireConn(addr.sin_addr.s_addr, Metrics::NowNs())) {
+      Metrics::Add(Metrics::IP_CONN_LIMITED);
+      Shed_(fd, kTooManyResponse);
+      continue;
     }
+    Metrics::Add(Metrics::ACCEPTED);
     AddClient_(fd, addr);
-  } while (listen_event_ & EPOLLET);
+  }
+
+  // 预算用完时队列中可能还有连接, ET模式下不会再次触发, 需要重新注册监听事件
+  Metrics::Add(Metrics::ACCEPT_BUDGET_EXHAUSTED);
+  if (listen_event_ & EPOLLET) {
+    epoller_->ModFd(listen_fd_, listen_event_ | EPOLLIN);
+  }
+}
+
+void WebServer::OnReadInline_(HttpConn* client) {
+  TRACE_SCOPE_ARG("OnReadInline", client->GetFd());
+  int read_errno = 0;
+  ssize_t ret = client->Read(&read_errno);
+  if (ret <= 0 && read_errno != EAGAIN) {
+    LOG_ERROR("Read error!");
+    CloseConn_(client);
+    return;
+  }
+  if (!client->HasPendingInput() || client->IsHeaderIncomplete()) { // 请求头不完整时等待剩下的数据
+    WaitRequest_(client);
+  } else if (client->CanProcessInline()) {
+    OnProcessInline_(client);
+  } else {  // 可能阻塞, 交给线程池; 数据已读入缓冲区, 直接处理
+    Dispatch_(client, false);
+  }
+}
+
+void WebServer::Dispatch_(HttpConn* client, bool on_io) {
+  ThreadPool* pool = has_bulkheads_ ? executors_[client->GetExecutor()] : thread_pool_.get();
+  if (pool == thread_pool_.get()) {
+    if (on_io) {
+      OnProcess_(client);
+    } else {
+      pool->AddTask(std::bind(&WebServer::OnProcess_, this, client), std::bind(&WebServer::OnShed_, this, client));
+    }
+    return;
+  }
+  if (!pool->TryAddTask(std::bind(&WebServer::OnProcess_, this, client),
+                        std::bind(&WebServer::OnShed_, this, client))) {
+    Metrics::Add(Metrics::EXECUTOR_REJECTED);
+    client->Reject(kBusyResponse, sizeof(kBusyResponse) - 1);
+    epoller_->ModFd(client->GetFd(), conn_event_ | EPOLLOUT);
+  }
+}
+
+void WebServer::OnShed_(HttpConn* client) {
+  if (client->HasDeferredStreams()) { // 交给DB/CPU线程池的HTTP/2流: 拒绝这些流, 连接照常处理
+    Metrics::Add(Metrics::SHED_REQUESTS);
+    client->Reject(kBusyResponse, sizeof(kBusyResponse) - 1);
+    epoller_->ModFd(client->GetFd(), conn_event_ | EPOLLOUT);
+    return;
+  }
+  // HTTP/2连接上不能直接发送HTTP/1.1的响应, TLS握手没有完成时无法发送, 照常处理
+  if (client->IsHttp2() || client->IsTlsHandshaking()) {
+    OnRead_(client);
+    return;
+  }
+  TRACE_SCOPE_ARG("OnShed", client->GetFd());
+  Metrics::Add(Metrics::SHED_REQUESTS);
+  Reject_(client, kBusyResponse);
+}
+
+void WebServer::Reject_(HttpConn* client, const char* response) {
+  // 先读出请求, 否则关闭时接收缓冲区中还有数据, 内核会发送RST, 客户端可能收不到响应
+  int read_errno = 0;
+  ssize_t ret = client->Read(&read_errno);
+  if (ret <= 0 && read_errno != EAGAIN) {
+    CloseConn_(client);
+    return;
+  }
+  client->Reject(response, strlen(response));
+  OnWrite_(client);
+}
+
+void WebServer::OnProcessInline_(HttpConn* client) {
+  TRACE_SCOPE_ARG("OnProcessInline", client->GetFd());
+  Metrics::Add(Metrics::INLINE_REQUESTS);
+  if (!client->Process()) {
+    WaitRequest_(client);
+    return;
+  }
+
+  // 直接发送, 大多数小响应一次writev就能发完, 不需要注册EPOLLOUT
+  int write_errno = 0;
+  ssize_t ret = client->Write(&write_errno);
+  if (client->ToWriteBytes() == 0) {
+    if (client->IsHttp2()) { // 刚通过Upgrade切换到HTTP/2, 之后的帧交给线程池处理
+      thread_pool_->AddTask(std::bind(&WebServer::OnProcess_, this, client));
+      return;
+    }
+    if (client->IsKeepAlive()) {
+      WaitRequest_(client);
+      return;
+    }
+  } else if (ret > 0 || write_errno == EAGAIN) { // 发送缓冲区满, 剩下的由DealWrite_继续发送
+    epoller_->ModFd(client->GetFd(), conn_event_ | EPOLLOUT);
+    return;
+  }
+  CloseConn_(client);
+}
+
+void WebServer::Shed_(int fd, const char* response) {
+  assert(fd >= 0);
+  if (options_.shed_policy == ServerOptions::SHED_RST) {
+    struct linger opt_linger = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &opt_linger, sizeof(opt_linger));
+  } else if (!TlsContext::Instance()->IsEnabled()) {  // 非阻塞发送, 发不出去也不等待
+    send(fd, response, strlen(response), MSG_DONTWAIT | MSG_NOSIGNAL);
+  }
+  close(fd);
+}
+
+bool WebServer::EvictIdle_() {
+  int fd = idle_.PopOldest();
+  if (fd < 0) {
+    return false;
+  }
+  assert(users_.count(fd) > 0);
+  LOG_INFO("Client[%d] idle, evicted", fd);
+  Metrics::Add(Metrics::IDLE_EVICTED);
+  CloseConn_(&users_[fd]);
+  return true;
+}
+
+void WebServer::ShedOnFdExhausted_() {
+  LOG_WARN("Too many open files!");
+  if (idle_fd_ < 0) {
+    return;
+  }
+  close(idle_fd_);
+  int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (fd >= 0) {
+    Metrics::Add(Metrics::REJECTED);
+    Shed_(fd);
+  }
+  idle_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
 }
 
+
+void WebServer::InitMetrics_() {
+  Metrics* metrics = Metrics::Instance();
+  metrics->RegisterGauge("webserver_connections", "Currently open client connections.",
+                         [] { return static_cast<int64_t>(HttpConn::user_count); });
+  ThreadPool* pool = thread_pool_.get();
+  metrics->RegisterGauge("webserver_thread_pool_queue_depth", "Tasks waiting in the thread pool queue.",
+                         [pool] { return static_cast<int64_t>(pool->QueueSize()); });
+  metrics->RegisterGauge("webserver_thread_pool_threads", "Threads in the thread pool.",
+                         [pool] { return static_cast<int64_t>(pool->ThreadCount()); });
+  metrics->RegisterGauge("webserver_thread_pool_active", "Thread pool threads running a task.",
+                         [pool] { return static_cast<int64_t>(pool->ActiveCount()); });
+  IpLimiter* limiter = &ip_limiter_;
+  metrics->RegisterGauge("webserver_ip_limiter_entries", "Source IPs tracked by the per-IP limiter.",
+                         [limiter] { return static_cast<int64_t>(limiter->Size()); });
+  IdleList* idle = &idle_;
+  metrics->RegisterGauge("webserver_idle_connections", "Keep-alive connections waiting for the next request.",
+                         [idle] { return static_cast<int64_t>(idle->Size()); });
+  metrics->RegisterGauge("webserver_idle_buffer_bytes", "Buffer memory held by idle connections.",
+                         [idle] { return static_cast<int64_t>(idle->Bytes()); });
+  metrics->RegisterGauge("webserver_thread_pool_overloaded", "1 while the thread pool sheds requests (CoDel).",
+                         [pool] { return static_cast<int64_t>(pool->IsOverloaded()); });
+  for (ThreadPool* executor : {db_pool_.get(), cpu_pool_.get()}) {
+    if (!executor) {
+      continue;
+    }
+    std::string prefix = executor == db_pool_.get() ? "webserver_db_executor" : "webserver_cpu_executor";
+    metrics->RegisterGauge(prefix + "_queue_depth", "Tasks waiting in the executor queue.",
+                           [executor] { return static_cast<int64_t>(executor->QueueSize()); });
+    metrics->RegisterGauge(prefix + "_active", "Executor threads running a task.",
+                           [executor] { return static_cast<int64_t>(executor->ActiveCount()); });
+  }
+}
+
+ThreadPool::Options WebServer::PoolOptions_(int thread_num, const ServerOptions& options) {
+  ThreadPool::Options pool_options;
+  pool_options.min_threads = options.worker_threads_min > 0 ? options.worker_threads_min : thread_num;
+  pool_options.max_threads = options.worker_threads_max > 0 ? options.worker_threads_max : thread_num;
+  if (pool_options.max_threads < pool_options.min_threads) {
+    pool_options.max_threads = pool_options.min_threads;
+  }
+  pool_options.grow_wait_us = options.worker_grow_wait_us;
+  pool_options.idle_timeout_ms = options.worker_idle_timeout_ms;
+  pool_options.cpus = CpuAffinity::Parse(options.worker_cpus);
+  pool_options.name = "io";
+  pool_options.codel_target_us = options.shed_target_us;
+  pool_options.codel_interval_us = options.shed_interval_us;
+  return pool_options;
+}
+
+void WebServer::InitExecutors_() {
+  auto make_pool = [this](size_t threads, size_t queue_limit, const char* name) {
+    ThreadPool::Options pool_options;
+    pool_options.min_threads = threads;
+    pool_options.max_threads = threads;
+    pool_options.max_queue = queue_limit;
+    pool_options.cpus = CpuAffinity::Parse(options_.worker_cpus);
+    pool_options.name = name;
+    pool_options.codel_target_us = options_.shed_target_us;
+    pool_options.codel_interval_us = options_.shed_interval_us;
+    return std::unique_ptr<ThreadPool>(new ThreadPool(pool_options));
+  };
+  if (options_.db_threads > 0) {
+    db_pool_ = make_pool(options_.db_threads, options_.db_queue_limit, "db");
+  }
+  if (options_.cpu_threads > 0) {
+    cpu_pool_ = make_pool(options_.cpu_threads, options_.cpu_queue_limit, "cpu");
+  }
+  executors_[Router::IO] = thread_pool_.get();
+  executors_[Router::DB] = db_pool_ ? db_pool_.get() : thread_pool_.get();
+  executors_[Router::CPU] = cpu_pool_ ? cpu_pool_.get() : thread_pool_.get();
+  has_bulkheads_ = db_pool_ || cpu_pool_;
+  HttpConn::bulkheads = has_bulkheads_;
+}
+
+void WebServer::InitRoutes_() {
+  Router* router = Router::Instance();
+  router->Clear();
+  // 其他路径: 资源目录下的同名文件
+  router->AddFile(Router::ANY, "/**", "");
+  router->AddFile(Router::ANY, "/", "/index.html");
+  for (const char* page : {"/index", "/register", "/login", "/welcome", "/video", "/picture"}) {
+    router->AddFile(Router::ANY, page, std::string(page) + ".html");
+  }
+
+  // 登录/注册表单, 验证通过返回欢迎页面, 否则返回错误页面
+  auto user_verify = [](bool is_login, const char* page) {
+    return [is_login, page](HttpRequest& request, HttpResponse& response, Buffer& buff) {
+      if (strcasecmp(request.GetHeader(HttpHeaders::CONTENT_TYPE), "application/x-www-form-urlencoded") != 0) {
+        response.SetFile(page);
+      } else if (HttpRequest::UserVerify(request.GetPost("username"), request.GetPost("password"), is_login)) {
+        response.SetFile("/welcome.html");
+      } else {
+        response.SetFile("/error.html");
+      }
+      response.MakeResponse(buff);
+    };
+  };
+  router->AddHandler(Router::POST, "/register", user_verify(false, "/register.html"));
+  router->AddHandler(Router::POST, "/register.html", user_verify(false, "/register.html"));
+  router->AddHandler(Router::POST, "/login", user_verify(true, "/login.html"));
+  router->AddHandler(Router::POST, "/login.html", user_verify(true, "/login.html"));
+
+  // 监控指标(不读取文件, 可以在事件循环线程上处理)和追踪数据
+  router->AddHandler(Router::ANY, Metrics::kPath, [](HttpRequest&, HttpResponse& response, Buffer& buff) {
+    response.MakeResponse(buff, Metrics::Instance()->Render(), "text/plain; version=0.0.4");
+  }, false, Router::CPU);
+  // 序列化所有线程的追踪缓冲区, 计算量较大, 不在事件循环线程上处理
+  router->AddHandler(Router::ANY, Tracer::kPath, [](HttpRequest&, HttpResponse& response, Buffer& buff) {
+    response.MakeResponse(buff, Tracer::Instance()->DumpChromeJson(), "application/json");
+  }, true, Router::CPU);
+}
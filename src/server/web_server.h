@@ -6,15 +6,26 @@
 #define WEBSERVERCPP11_SRC_SERVER_WEB_SERVER_H_
 
 #include <fcntl.h>  // fcntl
+#include <sys/epoll.h>  // EPOLLIN, EPOLLOUT ...
+#include <sys/socket.h> // accept4
+#include <netinet/tcp.h>  // TCP_DEFER_ACCEPT, TCP_FASTOPEN
 #include <cassert>
 #include <cstdint>
 #include <memory>
 #include <string>
 #include <cstring>
 #include "../timer/heap_timer.h"
+#include "../timer/timer_fd.h"
 #include "../pool/thread_pool.h"
-#include "epoller.h"
+#include "poller.h"
+#include "server_options.h"
+#include "ip_limiter.h"
+#include "idle_list.h"
 #include "../http/http_conn.h"
+#include "../http/file_cache.h"
+#include "../tls/tls_context.h"
+#include "../metrics/metrics.h"
+#include "../trace/trace.h"
 
 class WebServer {
  public:
@@ -39,15 +50,32 @@ class WebServer {
   ///     0: debug, 1: info, 2: warn, 3: error
   /// @param log_que_size 日志同步队列长度
   ///     <=0: 同步日志;   >0: 异步日志
+  /// @param options 其他可选配置, 见ServerOptions
   ///
   WebServer(int port, int trig_mode, int timeout, bool opt_linger,
             int sql_port, const char* sql_user, const char* sql_passwd,
             const char* db_name, int conn_pool_num, int thread_num,
-            bool open_log, int log_level, int log_que_size);
+            bool open_log, int log_level, int log_que_size,
+            const ServerOptions& options = ServerOptions());
 
   ~WebServer() {
+    // 先等待线程池中的任务执行完, 它们会访问下面释放的资源.
+    // IO线程池的任务会把请求交给DB/CPU线程池, 先关闭它; DB/CPU线程池之间也会互相提交(HTTP/2暂存的流),
+    // 关闭后的提交被拒绝, 全部关闭后再释放, 执行中的任务不会访问已释放的线程池
+    thread_pool_->Shutdown();
+    if (db_pool_) {
+      db_pool_->Shutdown();
+    }
+    if (cpu_pool_) {
+      cpu_pool_->Shutdown();
+    }
+    thread_pool_.reset();
+    db_pool_.reset();
+    cpu_pool_.reset();
     close(listen_fd_);
+    close(idle_fd_);
     is_close_ = true;
+    Metrics::Instance()->ClearGauges();
     free(src_dir_);
     SqlConnPool::Instance()->ClosePool();
   }
@@ -74,7 +102,22 @@ class WebServer {
   ///
   void InitEventMode_(int trig_mode);
 
-  /// @brief 处理监听事件
+  /// @brief 开启ServerOptions::timer_fd时创建timerfd并注册到Poller, 失败时退回epoll_wait的超时
+  void InitTimer_();
+
+  /// @brief 注册监控指标中的瞬时值(连接数, 线程池队列长度和线程数)
+  void InitMetrics_();
+
+  /// @brief 线程池的配置: 线程数范围默认固定为thread_num
+  static ThreadPool::Options PoolOptions_(int thread_num, const ServerOptions& options);
+
+  /// @brief 创建单独的DB/CPU线程池(配置了线程数时), 填写executors_
+  void InitExecutors_();
+
+  /// @brief 注册默认的路由: 静态页面, 登录/注册, 监控指标和追踪数据
+  static void InitRoutes_();
+
+  /// @brief 处理监听事件, 在本轮连接事件分发完后调用(可能淘汰空闲连接)
   void DealListen_();
 
   /// @brief 处理写事件
@@ -88,19 +131,77 @@ class WebServer {
   inline void DealRead_(HttpConn* client) {
     assert(client);
     ExtentTime_(client);
-    thread_pool_->AddTask(std::bind(&WebServer::OnRead_, this, client));
+    if (options_.idle_lru) {
+      idle_.Remove(client->GetFd());
+    }
+    // 每次读事件算一个请求; HTTP/2的一次读可能包含多个流, TLS握手还不能发送响应, 都不限制
+    if (ip_limiter_.LimitsRate() && !client->IsHttp2() && !client->IsTlsHandshaking() &&
+        !ip_limiter_.AllowRequest(client->GetAddr().sin_addr.s_addr, Metrics::NowNs())) {
+      Metrics::Add(Metrics::IP_RATE_LIMITED);
+      Reject_(client, kTooManyResponse);
+      return;
+    }
+    if (options_.inline_fast_path && !client->IsTlsHandshaking()) {
+      OnReadInline_(client);
+      return;
+    }
+    thread_pool_->AddTask(std::bind(&WebServer::OnRead_, this, client), std::bind(&WebServer::OnShed_, this, client));
   }
 
-  /// @brief 发送错误信息给FD
-  inline void SendError_(int fd, const char* info) {
-    assert(fd > 0);
-    int ret = send(fd, info, strlen(info), 0);
-    if (ret < 0) {
-      LOG_WARN("Send error to client[%d] error!", fd);
+  ///
+  /// @brief 处理读缓冲区中的请求: 属于IO执行器的在IO线程池中处理(on_io时直接处理),
+  /// 否则交给对应的线程池, 队列满时返回503
+  /// @param on_io 是否在IO线程池的线程上调用
+  ///
+  void Dispatch_(HttpConn* client, bool on_io);
+
+  ///
+  /// @brief 线程池过载(见ThreadPool的CoDel)时代替OnRead_/OnProcess_执行: 读出请求后直接返回预先生成的503,
+  /// 发送后关闭连接, 不解析、不处理. 已经在处理中的请求(发送响应)不会被丢弃
+  ///
+  void OnShed_(HttpConn* client);
+
+  /// @brief 快速路径: 在事件循环线程上读取, 能直接处理的请求就地处理, 否则交给线程池
+  void OnReadInline_(HttpConn* client);
+
+  /// @brief 快速路径: 在事件循环线程上生成响应并尝试发送
+  void OnProcessInline_(HttpConn* client);
+
+  /// @brief 拒绝连接(过载保护), 按ServerOptions::shed_policy发送response(默认503)或RST(TLS连接不发送)
+  void Shed_(int fd, const char* response = kBusyResponse);
+
+  ///
+  /// @brief 拒绝连接上的请求: 读出请求, 发送预先生成的response后关闭连接
+  /// 在事件循环线程或工作线程上都可以调用
+  ///
+  void Reject_(HttpConn* client, const char* response);
+
+  ///
+  /// @brief 注册读事件等待下一个请求. 连接上没有待处理的请求和待发送的数据时释放多余的缓冲区并加入空闲表(开启idle_lru时),
+  /// 加入和注册在空闲表的锁内完成: 事件循环在注册完成之前不会淘汰它(工作线程还在使用), 注册后收到的请求也一定能把它移出表
+  ///
+  inline void WaitRequest_(HttpConn* client) {
+    int fd = client->GetFd();
+    if (options_.idle_lru && !client->HasPendingInput() && client->ToWriteBytes() == 0) {
+      idle_.Add(fd, client->ShrinkBuffers(kIdleBufferMax), [this, fd]() { epoller_->ModFd(fd, conn_event_ | EPOLLIN); });
+      return;
     }
-    close(fd);
+    epoller_->ModFd(fd, conn_event_ | EPOLLIN);
   }
 
+  ///
+  /// @brief 关闭最久未使用的空闲连接, 只在事件循环线程上调用(空闲连接的事件也只由它分发, 不会同时被处理)
+  /// @return 没有空闲连接时返回false
+  ///
+  bool EvictIdle_();
+
+  /// @brief 文件描述符耗尽(EMFILE/ENFILE)时, 释放预留的fd来accept并拒绝一个连接,
+  /// 否则该连接会一直留在全连接队列中, LT模式下监听事件不断触发
+  void ShedOnFdExhausted_();
+
+  /// @brief timerfd可读: 在本轮事件分发完后批量执行到期的定时器
+  void OnTimer_();
+
   inline void ExtentTime_(HttpConn* client) {
     assert(client);
     if (timeout_ > 0) {
@@ -113,46 +214,60 @@ class WebServer {
     assert(client);
     LOG_INFO("Client[%d] quit!", client->GetFd());
     epoller_->DelFd(client->GetFd());
-    client->Close();
+    if (options_.idle_lru) {
+      idle_.Remove(client->GetFd());
+    }
+    if (client->Close() && ip_limiter_.LimitsConns()) {
+      ip_limiter_.ReleaseConn(client->GetAddr().sin_addr.s_addr, Metrics::NowNs());
+    }
   }
 
   inline void OnRead_(HttpConn* client) {
     assert(client);
+    TRACE_SCOPE_ARG("OnRead", client->GetFd());
     int ret = -1;
     int read_errno = 0;
-    ret = client->Read(&read_errno);
+    {
+      TRACE_SCOPE("Read");
+      ret = client->Read(&read_errno);
+    }
     if (ret <= 0 && read_errno != EAGAIN) {
       LOG_ERROR("Read error!");
       CloseConn_(client);
       return;
     }
-    OnProcess_(client);
+    Dispatch_(client, true);
   }
 
   inline void OnWrite_(HttpConn* client) {
     assert(client);
+    TRACE_SCOPE_ARG("OnWrite", client->GetFd());
     int ret = -1;
     int write_errno = 0;
     ret = client->Write(&write_errno);
     if (client->ToWriteBytes() == 0) { // 传输完成
       if (client->IsKeepAlive()) {
-        OnProcess_(client);
-        return;
-      }
-    } else if (ret < 0) {
-      if (write_errno == EAGAIN) { // 继续传输
-        epoller_->ModFd(client->GetFd(), conn_event_ | EPOLLOUT);
+        Dispatch_(client, true);
         return;
       }
+    } else if (ret > 0 || write_errno == EAGAIN) { // 继续传输(LT模式下一次没有写完也会返回)
+      epoller_->ModFd(client->GetFd(), conn_event_ | EPOLLOUT);
+      return;
     }
     CloseConn_(client);
   }
 
   inline void OnProcess_(HttpConn* client) {
-    if (client->Process()) {
+    TRACE_SCOPE_ARG("OnProcess", client->GetFd());
+    bool has_output = client->Process();
+    if (client->HasDeferredStreams()) { // HTTP/2连接上可能阻塞的流交给DB/CPU线程池, 已生成的帧随其响应一起发送
+      Dispatch_(client, false);
+      return;
+    }
+    if (has_output) {
       epoller_->ModFd(client->GetFd(), conn_event_ | EPOLLOUT);
     } else {
-      epoller_->ModFd(client->GetFd(), conn_event_ | EPOLLIN);
+      WaitRequest_(client);
     }
   }
 
@@ -163,35 +278,43 @@ class WebServer {
     if (timeout_ > 0) {
       timer_->Add(fd, timeout_, std::bind(&WebServer::CloseConn_, this, &users_[fd]));
     }
+    if (options_.idle_lru) {  // 还没有收到请求的连接也是空闲的, 复用的HttpConn可能留有上一个连接的大缓冲区
+      idle_.Add(fd, users_[fd].ShrinkBuffers(kIdleBufferMax));
+    }
 
     epoller_->AddFd(fd, EPOLLIN | conn_event_);
-    SetFdNonBlock_(fd);
     LOG_INFO("Client[%d] in!", users_[fd].GetFd());
   }
 
-  /// @brief 设置句柄非阻塞IO
-  inline static int SetFdNonBlock_(int fd) {
-    assert(fd > 0);
-    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFD, 0) | O_NONBLOCK);
-  }
-
  private:
   static const int kMaxFd = 65536;
+  static const size_t kIdleBufferMax = 4096;  // 空闲连接的缓冲区超过该大小时释放到初始大小
+  static const char kBusyResponse[];  // 预先生成的503响应
+  static const char kTooManyResponse[];  // 预先生成的429响应
 
   int port_;
   bool open_linger_;  // 是否开启优雅关闭
   int timeout_; // 单位：ms
   bool is_close_;
   int listen_fd_;
+  int idle_fd_;   // 预留的fd, 见ShedOnFdExhausted_
   char* src_dir_; // 资源路径
 
   uint32_t listen_event_; // 监听事件
   uint32_t conn_event_;   // 连接事件
 
   std::unique_ptr<HeapTimer> timer_;  // 时间堆
-  std::unique_ptr<ThreadPool> thread_pool_; // 线程池
-  std::unique_ptr<Epoller> epoller_;
+  std::unique_ptr<TimerFd> timer_fd_; // 驱动时间堆的timerfd(开启ServerOptions::timer_fd时), 否则为空
+  std::unique_ptr<ThreadPool> thread_pool_; // 线程池(IO执行器)
+  std::unique_ptr<ThreadPool> db_pool_;     // 单独的DB执行器, 没有配置时为空
+  std::unique_ptr<ThreadPool> cpu_pool_;    // 单独的CPU执行器, 没有配置时为空
+  ThreadPool* executors_[Router::EXECUTOR_NUM];  // 各执行器使用的线程池
+  bool has_bulkheads_;  // 是否有单独的DB/CPU执行器, 没有时不需要查找请求的路由
+  ServerOptions options_;
+  std::unique_ptr<Poller> epoller_;
   std::unordered_map<int/*句柄*/, HttpConn> users_;
+  IpLimiter ip_limiter_;  // 按来源IP限制连接数和请求速率
+  IdleList idle_;         // 空闲连接的LRU表(开启idle_lru时)
 };
 
 #endif //WEBSERVERCPP11_SRC_SERVER_WEB_SERVER_H_
@@ -4,28 +4,31 @@
 
 #include <cassert>
 #include "heap_timer.h"
+#include "../metrics/metrics.h"
 
 void HeapTimer::Adjust(int id, int new_expires) {
   assert(!heap_.empty() && ref_.count(id) != 0);
-  heap_[ref_[id]].expires = Clock::now() + static_cast<Ms>(new_expires);
+  size_t i = ref_[id].index;
+  heap_[i].expires = clock_.NowMs() + new_expires;
   // 更新生效时间后, 一定比之前的生效时间大, 所以只需要执行下滤即可
-  SiftDown_(ref_[id], heap_.size());
+  SiftDown_(i, heap_.size());
 }
 
 void HeapTimer::Add(int id, int timeout, const TimeoutCallBack& cb) {
   assert(id >= 0);
   size_t i;
 
-  if (ref_.count(id) == 0) { // 新的节点, 先插入堆尾, 然后再调整
+  uint32_t expires = clock_.NowMs() + timeout;
+  auto it = ref_.find(id);
+  if (it == ref_.end()) { // 新的节点, 先插入堆尾, 然后再调整
     i = heap_.size();
-    ref_[id] = i;
-    heap_.push_back({id, Clock ::now() + static_cast<Ms>(timeout), cb});
-//    heap_.emplace_back(TimerNode(id, Clock::now() + static_cast<Ms>(timeout), cb));
+    ref_.emplace(id, Ref{i, cb});
+    heap_.push_back({id, expires});
     SiftUp_(i);
   } else {  // 已有节点, 更新后调整堆
-    i = ref_[id];
-    heap_[i].expires = Clock::now() + static_cast<Ms>(timeout);
-    heap_[i].cb = cb;
+    i = it->second.index;
+    it->second.cb = cb;
+    heap_[i].expires = expires;
     // 调整节点
     if (!SiftDown_(i, heap_.size())) {
       SiftUp_(i);
@@ -35,13 +38,13 @@ void HeapTimer::Add(int id, int timeout, const TimeoutCallBack& cb) {
 
 void HeapTimer::DoWork(int id) {
   // 删除指定id节点, 并触发回调函数
-  if (heap_.empty() || ref_.count(id) == 0) {
+  auto it = ref_.find(id);
+  if (heap_.empty() || it == ref_.end()) {
     return;
   }
-  size_t i = ref_[id];
-  auto node = heap_[i];
-  node.cb();  // 执行回调函数
-  Del_(i);    // 删除该节点
+  TimeoutCallBack cb = std::move(it->second.cb);
+  Del_(it->second.index);  // 先删除该节点, 回调函数中可以重新添加
+  cb();  // 执行回调函数
 }
 
 void HeapTimer::Tick() {
@@ -49,14 +52,28 @@ void HeapTimer::Tick() {
   if (heap_.empty()) {
     return;
   }
+  TickUntil(clock_.NowMs());
+}
+
+void HeapTimer::TickUntil(uint32_t deadline) {
   while (!heap_.empty()) {
-    TimerNode node = heap_.front();
-    if (std::chrono::duration_cast<Ms>(node.expires - Clock::now()).count() > 0) {
+    const TimerNode& node = heap_.front();
+    if (LoopClock::Before(deadline, node.expires)) {
       break;
     }
-    node.cb();
+    TimeoutCallBack cb = std::move(ref_[node.id].cb);
     Pop();
+    cb();
+    Metrics::Add(Metrics::TIMER_EXPIRED);
+  }
+}
+
+bool HeapTimer::NextExpires(uint32_t* expires) const {
+  if (heap_.empty()) {
+    return false;
   }
+  *expires = heap_.front().expires;
+  return true;
 }
 
 void HeapTimer::Pop() {
@@ -67,9 +84,9 @@ void HeapTimer::Pop() {
 
 int HeapTimer::GetNextTick() {
   Tick();
-  size_t res = -1;
+  int res = -1;
   if (!heap_.empty()) {
-    res = std::chrono::duration_cast<Ms>(heap_.front().expires - Clock::now()).count();
+    res = static_cast<int32_t>(heap_.front().expires - clock_.NowMs());
     if (res < 0) {
       res = 0;
     }
@@ -97,15 +114,14 @@ void HeapTimer::Del_(size_t i) {
 
 void HeapTimer::SiftUp_(size_t i) {
   assert(i >= 0 && i < heap_.size());
-  size_t j = (i - 1) / 2; // 父节点
-  while (j >= 0) {
+  while (i > 0) {
+    size_t j = (i - 1) / 2; // 父节点
     // 如果父节点已经比子节点小
     if (heap_[j] < heap_[i]) {
       break;
     }
     SwapNode_(i, j);
     i = j;
-    j = (i - 1) / 2;
   }
 }
 
@@ -117,7 +133,7 @@ bool HeapTimer::SiftDown_(size_t index, size_t n) {
   int j = 2 * i + 1;
   while (j < n) {
     // 取左右节点中生效时间最小的
-    if (j + 1 < n && heap_[j + 1].expires < heap_[j].expires) {
+    if (j + 1 < n && heap_[j + 1] < heap_[j]) {
       ++j;
     }
     // 如果根节点的生效时间已经比左右节点的生效时间小
@@ -138,6 +154,6 @@ void HeapTimer::SwapNode_(size_t i, size_t j) {
   assert(j >= 0 && j < heap_.size());
 
   std::swap(heap_[i], heap_[j]);
-  ref_[heap_[i].id] = i;
-  ref_[heap_[j].id] = j;
+  ref_[heap_[i].id].index = i;
+  ref_[heap_[j].id].index = j;
 }
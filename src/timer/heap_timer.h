@@ -6,36 +6,37 @@
 #ifndef WEBSERVERCPP11_SRC_TIMER_HEAP_TIMER_H_
 #define WEBSERVERCPP11_SRC_TIMER_HEAP_TIMER_H_
 
+#include <cstdint>
 #include <functional>
-#include <chrono>
 #include <vector>
 #include <unordered_map>
+#include "loop_clock.h"
 
 using TimeoutCallBack = std::function<void()>;  // 回调函数指针
-using Clock = std::chrono::high_resolution_clock; // 时钟
-using Ms = std::chrono::milliseconds; // 毫秒
-using TimeStamp = Clock::time_point;  // 时间戳
 
-/// @brief 定时器结构体
+/// @brief 定时器结构体, 回调函数放在ref_中, 堆中只有8字节, 上滤/下滤时移动的数据少
 struct TimerNode {
   int id;             // 句柄(文件描述符)
-  TimeStamp expires;  // 生效时间
-  TimeoutCallBack cb; // 回调函数
-
-  TimerNode(int _id, TimeStamp _expires, const TimeoutCallBack& _cb)
-      : id(_id), expires(_expires), cb(_cb) {}
+  uint32_t expires;   // 生效时间, 见LoopClock
 
   bool operator<(const TimerNode& rhs) const {
-    return expires < rhs.expires;
+    return LoopClock::Before(expires, rhs.expires);
   }
 };
 
+///
 /// @brief 时间堆
+/// 不读取系统时钟, 使用UpdateClock时缓存的时间(见LoopClock): 事件循环每轮调用一次,
+/// 之后每个读写事件延长超时时间(Adjust)不再调用clock_gettime
+///
 class HeapTimer {
  public:
-  explicit HeapTimer(int _n = 64) { heap_.reserve(_n); }
+  explicit HeapTimer(int _n = 64) { heap_.reserve(_n); clock_.Update(); }
   ~HeapTimer() { clear(); }
 
+  /// @brief 更新缓存的时间, 每轮事件循环调用一次
+  inline void UpdateClock() { clock_.Update(); }
+
   // 调整句柄id的生效时间
   void Adjust(int id, int new_expires);
   // 添加节点
@@ -44,9 +45,15 @@ class HeapTimer {
   void DoWork(int id);
   // 心搏函数
   void Tick();
+  // 执行生效时间不晚于deadline的所有定时器(timerfd触发时, 触发时间之前的定时器都已到期)
+  void TickUntil(uint32_t deadline);
+  // 下一个定时器的生效时间, 没有定时器时返回false
+  bool NextExpires(uint32_t* expires) const;
+  // 缓存的当前时间
+  inline uint32_t NowMs() const { return clock_.NowMs(); }
   // 删除堆顶节点
   void Pop();
-  // 获取下一次心搏
+  // 获取下一次心搏(距离下一个定时器生效的毫秒数, 没有定时器时返回-1)
   int GetNextTick();
 
   // 清空
@@ -66,10 +73,16 @@ class HeapTimer {
   void SwapNode_(size_t i, size_t j);
 
  private:
+  struct Ref {
+    size_t index;       // 节点位置(在heap_中的位置)
+    TimeoutCallBack cb; // 回调函数
+  };
+
+  LoopClock clock_;
   // 时间堆的底层结构为数组
   std::vector<TimerNode> heap_;
-  // key: 句柄  value: 节点位置(在heap_中的位置)
-  std::unordered_map<int, size_t> ref_;
+  // key: 句柄  value: 节点位置和回调函数
+  std::unordered_map<int, Ref> ref_;
 };
 
 #endif //WEBSERVERCPP11_SRC_TIMER_HEAP_TIMER_H_
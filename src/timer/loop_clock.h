@@ -0,0 +1,42 @@
+// =============================================================================
+// Created by yangb on 2021/5/2.
+// 事件循环的缓存时钟
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_TIMER_LOOP_CLOCK_H_
+#define WEBSERVERCPP11_SRC_TIMER_LOOP_CLOCK_H_
+
+#include <time.h>
+#include <cstdint>
+
+///
+/// @brief 每轮事件循环(epoll_wait返回后)读取一次CLOCK_MONOTONIC_COARSE并缓存, 处理事件时只读缓存的值.
+/// 时间用距离时钟创建时的毫秒数表示, 截断为32位(约49.7天回绕), 比较时用差值的符号(Before), 只要求
+/// 比较的两个时间相差不超过24.8天. 粗粒度时钟的精度是一个时钟节拍(通常1~4ms), 对秒级的连接超时足够
+///
+class LoopClock {
+ public:
+  LoopClock() : start_ms_(ReadMs_()), now_ms_(0) {}
+
+  /// @brief 重新读取时钟, 每轮事件循环调用一次
+  inline void Update() { now_ms_ = static_cast<uint32_t>(ReadMs_() - start_ms_); }
+
+  /// @brief 上一次Update时的时间, 单位: 毫秒
+  inline uint32_t NowMs() const { return now_ms_; }
+
+  /// @brief 时间a是否早于b(考虑回绕)
+  inline static bool Before(uint32_t a, uint32_t b) { return static_cast<int32_t>(a - b) < 0; }
+
+ private:
+  inline static int64_t ReadMs_() {
+    struct timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+  }
+
+ private:
+  int64_t start_ms_;
+  uint32_t now_ms_;
+};
+
+#endif //WEBSERVERCPP11_SRC_TIMER_LOOP_CLOCK_H_
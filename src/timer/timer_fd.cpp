@@ -0,0 +1,44 @@
+// =============================================================================
+// Created by yangb on 2021/5/2.
+// =============================================================================
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include "timer_fd.h"
+#include "loop_clock.h"
+
+TimerFd::TimerFd(int slack_ms)
+    : fd_(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+      slack_ms_(slack_ms > 1 ? slack_ms : 1), armed_(false), armed_at_(0) {}
+
+TimerFd::~TimerFd() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+void TimerFd::Arm(uint32_t expires, uint32_t now) {
+  uint32_t fire_at = expires + (slack_ms_ - expires % slack_ms_) % slack_ms_;
+  if (fd_ < 0 || (armed_ && !LoopClock::Before(fire_at, armed_at_))) {
+    return;
+  }
+  // 已经到期时马上触发(it_value为0会取消定时)
+  int64_t delay_ns = LoopClock::Before(now, fire_at) ? static_cast<int64_t>(fire_at - now) * 1000000 : 1;
+  struct itimerspec spec{};
+  spec.it_value.tv_sec = delay_ns / 1000000000;
+  spec.it_value.tv_nsec = delay_ns % 1000000000;
+  if (timerfd_settime(fd_, 0, &spec, nullptr) == 0) {
+    armed_ = true;
+    armed_at_ = fire_at;
+  }
+}
+
+bool TimerFd::Consume(uint32_t* fired_at) {
+  uint64_t expirations = 0;
+  if (read(fd_, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+    return false;
+  }
+  armed_ = false;
+  *fired_at = armed_at_;
+  return true;
+}
@@ -0,0 +1,50 @@
+// =============================================================================
+// Created by yangb on 2021/5/2.
+// 驱动时间堆的timerfd
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_TIMER_TIMER_FD_H_
+#define WEBSERVERCPP11_SRC_TIMER_TIMER_FD_H_
+
+#include <cstdint>
+
+///
+/// @brief 注册在Poller中的timerfd, 可读时由事件循环批量处理到期的定时器(HeapTimer::TickUntil)
+/// 触发时间按slack_ms向上取整到网格上, 相近的生效时间合并为一次唤醒; 只有新的触发时间更早时才重新设置,
+/// 延长超时时间(最常见的情况)不需要系统调用, 提前触发时没有到期的定时器, 重新设置即可
+/// 时间使用LoopClock的毫秒数
+///
+class TimerFd {
+ public:
+  explicit TimerFd(int slack_ms);
+
+  ~TimerFd();
+
+  TimerFd(const TimerFd&) = delete;
+  TimerFd& operator=(const TimerFd&) = delete;
+
+  /// @brief 创建失败时为-1
+  inline int GetFd() const { return fd_; }
+
+  ///
+  /// @brief 确保不晚于expires向上取整到slack_ms倍数的时刻触发
+  /// @param expires 下一个定时器的生效时间
+  /// @param now 当前时间
+  ///
+  void Arm(uint32_t expires, uint32_t now);
+
+  ///
+  /// @brief timerfd可读时调用, 读出到期次数
+  /// @param fired_at 设置的触发时间, 此时该时间之前的定时器都已到期
+  /// @return 没有到期(读之前又重新设置了)时返回false
+  ///
+  bool Consume(uint32_t* fired_at);
+
+ private:
+  int fd_;
+  uint32_t slack_ms_;
+  bool armed_;          // 是否已设置且还没有触发
+  uint32_t armed_at_;   // 设置的触发时间
+};
+
+#endif //WEBSERVERCPP11_SRC_TIMER_TIMER_FD_H_
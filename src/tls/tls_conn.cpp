@@ -0,0 +1,184 @@
+// =============================================================================
+// Created by yangb on 2021/4/27.
+// =============================================================================
+
+#include <cerrno>
+#include "tls_conn.h"
+#include "tls_context.h"
+#include "../log/log.h"
+#include "../metrics/metrics.h"
+
+#ifdef WEBSERVER_ENABLE_TLS
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+TlsConn::TlsConn(int fd) : fd_(fd), ssl_(nullptr), established_(false), ktls_send_(false), failed_(false) {
+  ssl_ = SSL_new(TlsContext::Instance()->Get());
+  if (!ssl_ || SSL_set_fd(ssl_, fd) != 1) {
+    LOG_ERROR("Client[%d] SSL_new error!", fd);
+    failed_ = true;
+    return;
+  }
+  SSL_set_accept_state(ssl_);
+}
+
+TlsConn::~TlsConn() {
+  if (!ssl_) {
+    return;
+  }
+  if (established_ && !failed_) { // 非阻塞, 只发送close_notify
+    ERR_clear_error();
+    SSL_shutdown(ssl_);
+  }
+  SSL_free(ssl_);
+  ERR_clear_error();
+}
+
+ssize_t TlsConn::Read(Buffer& buff, int* save_errno) {
+  if (!established_) {
+    int ret = Handshake_(save_errno);
+    if (ret <= 0) {
+      return ret;
+    }
+  }
+
+  static const size_t kReadChunk = 16 * 1024;  // 一个TLS记录的最大长度
+  ssize_t total = 0;
+  while (true) {
+    buff.EnsureWritable(kReadChunk);
+    size_t len = 0;
+    ERR_clear_error();
+    int ret = SSL_read_ex(ssl_, buff.BeginWrite(), buff.WritableBytes(), &len);
+    if (ret == 1) {
+      buff.HasWritten(len);
+      total += static_cast<ssize_t>(len);
+      continue;
+    }
+    ret = OnError_(ret);
+    if (total > 0) { // 先处理已读到的数据, 错误或关闭在下次读取时返回
+      return total;
+    }
+    if (ret < 0) {
+      *save_errno = errno;
+    }
+    return ret;
+  }
+}
+
+ssize_t TlsConn::Writev(const struct iovec* iov, int iov_cnt) {
+  if (ktls_send_) { // 内核加密, 与普通socket相同
+    return writev(fd_, iov, iov_cnt);
+  }
+
+  // 每个iovec分别SSL_write; 返回WANT_WRITE时OpenSSL要求下次用同样的数据重试,
+  // 调用者按返回值前移iov后, 下次调用的开头正好是这部分数据
+  ssize_t total = 0;
+  for (int i = 0; i < iov_cnt; ++i) {
+    if (iov[i].iov_len == 0) {
+      continue;
+    }
+    size_t len = 0;
+    ERR_clear_error();
+    int ret = SSL_write_ex(ssl_, iov[i].iov_base, iov[i].iov_len, &len);
+    if (ret != 1) {
+      if (total > 0) {
+        return total;
+      }
+      if (OnError_(ret) == 0) {
+        errno = EPIPE;
+      }
+      return -1;
+    }
+    total += static_cast<ssize_t>(len);
+    if (len < iov[i].iov_len) {
+      break;
+    }
+  }
+  return total;
+}
+
+int TlsConn::Handshake_(int* save_errno) {
+  if (failed_) {
+    *save_errno = EPROTO;
+    return -1;
+  }
+  ERR_clear_error();
+  int ret = SSL_do_handshake(ssl_);
+  if (ret != 1) {
+    ret = OnError_(ret);
+    if (ret < 0) {
+      *save_errno = errno;
+    }
+    return ret;
+  }
+
+  established_ = true;
+  ktls_send_ = BIO_get_ktls_send(SSL_get_wbio(ssl_));
+  Metrics::Add(Metrics::TLS_HANDSHAKES);
+  if (SSL_session_reused(ssl_)) {
+    Metrics::Add(Metrics::TLS_RESUMED);
+  }
+  if (ktls_send_) {
+    Metrics::Add(Metrics::TLS_KTLS);
+  }
+  LOG_DEBUG("Client[%d] TLS established: %s %s, resumed: %d, kTLS: %d", fd_, SSL_get_version(ssl_),
+            SSL_get_cipher_name(ssl_), SSL_session_reused(ssl_), ktls_send_);
+  return 1;
+}
+
+int TlsConn::OnError_(int ret) {
+  int err = SSL_get_error(ssl_, ret);
+  switch (err) {
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+      // 握手时很少需要等待可写(服务端的握手消息远小于socket发送缓冲区), 和等待可读一样处理
+      errno = EAGAIN;
+      return -1;
+    case SSL_ERROR_ZERO_RETURN:
+      return 0;
+    case SSL_ERROR_SYSCALL:
+      failed_ = true;
+      if (errno == 0) {
+        errno = ECONNRESET;
+      }
+      return -1;
+    default:
+      failed_ = true;
+      LOG_WARN("Client[%d] TLS error: %s", fd_, ERR_error_string(ERR_get_error(), nullptr));
+      errno = EPROTO;
+      return -1;
+  }
+}
+
+#else // WEBSERVER_ENABLE_TLS
+
+TlsConn::TlsConn(int fd) : fd_(fd), ssl_(nullptr), established_(false), ktls_send_(false), failed_(true) {}
+
+TlsConn::~TlsConn() = default;
+
+ssize_t TlsConn::Read(Buffer& buff, int* save_errno) {
+  (void) buff;
+  *save_errno = ENOTSUP;
+  return -1;
+}
+
+ssize_t TlsConn::Writev(const struct iovec* iov, int iov_cnt) {
+  (void) iov;
+  (void) iov_cnt;
+  errno = ENOTSUP;
+  return -1;
+}
+
+int TlsConn::Handshake_(int* save_errno) {
+  *save_errno = ENOTSUP;
+  return -1;
+}
+
+int TlsConn::OnError_(int ret) {
+  (void) ret;
+  errno = ENOTSUP;
+  return -1;
+}
+
+#endif // WEBSERVER_ENABLE_TLS
@@ -0,0 +1,62 @@
+// =============================================================================
+// Created by yangb on 2021/4/27.
+// 一个TLS连接: 非阻塞握手, 解密读, 加密写
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_TLS_TLS_CONN_H_
+#define WEBSERVERCPP11_SRC_TLS_TLS_CONN_H_
+
+#include <sys/types.h>
+#include <sys/uio.h>  // iovec
+#include "../buffer/buffer.h"
+
+struct ssl_st;
+
+///
+/// @brief 非阻塞socket上的TLS连接, 由HttpConn持有
+/// Read/Writev的返回值和errno与readv/writev相同, 需要等待socket可读/可写时返回-1, errno为EAGAIN.
+/// 握手在第一次Read中进行, 握手完成后如果kTLS发送可用, Writev直接调用writev, 由内核加密.
+///
+class TlsConn {
+ public:
+  /// @param fd 已accept的socket, 使用TlsContext::Instance()的配置
+  explicit TlsConn(int fd);
+
+  /// @brief 发送close_notify(不等待对端的应答)并释放连接
+  ~TlsConn();
+
+  TlsConn(const TlsConn&) = delete;
+  TlsConn& operator=(const TlsConn&) = delete;
+
+  /// @brief 握手是否已完成
+  inline bool IsEstablished() const { return established_; }
+
+  /// @brief 发送是否由内核加密(kTLS)
+  inline bool IsKtlsSend() const { return ktls_send_; }
+
+  ///
+  /// @brief 读取并解密数据, 追加到buff; 握手未完成时先继续握手
+  /// 一直读到socket中没有完整的记录, 否则OpenSSL内部缓存的数据不会再触发可读事件
+  /// @return >0: 读取的字节数; 0: 对端关闭; -1: 出错或需要等待(errno)
+  ///
+  ssize_t Read(Buffer& buff, int* save_errno);
+
+  /// @brief 加密并发送iov中的数据, 一次调用可能只发送一部分
+  ssize_t Writev(const struct iovec* iov, int iov_cnt);
+
+ private:
+  /// @brief 继续握手, 返回值同Read(完成时返回1)
+  int Handshake_(int* save_errno);
+
+  /// @brief 把SSL_get_error的结果转换为errno, 返回-1或0(对端关闭)
+  int OnError_(int ret);
+
+ private:
+  int fd_;
+  ssl_st* ssl_;
+  bool established_;
+  bool ktls_send_;
+  bool failed_;   // 出现过致命错误, 不能再发送close_notify
+};
+
+#endif //WEBSERVERCPP11_SRC_TLS_TLS_CONN_H_
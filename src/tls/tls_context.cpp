@@ -0,0 +1,114 @@
+// =============================================================================
+// Created by yangb on 2021/4/27.
+// =============================================================================
+
+#include "tls_context.h"
+#include "../log/log.h"
+
+#ifdef WEBSERVER_ENABLE_TLS
+
+#include <csignal>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+namespace {
+
+/// ALPN: 客户端支持时优先选择h2, 否则使用http/1.1
+int SelectAlpn(SSL* ssl, const unsigned char** out, unsigned char* out_len,
+               const unsigned char* in, unsigned int in_len, void* arg) {
+  (void) ssl;
+  (void) arg;
+  static const unsigned char kProtocols[] = "\x02h2\x08http/1.1";
+  unsigned char* selected = nullptr;
+  if (SSL_select_next_proto(&selected, out_len, kProtocols, sizeof(kProtocols) - 1, in, in_len)
+      != OPENSSL_NPN_NEGOTIATED) {
+    return SSL_TLSEXT_ERR_NOACK;
+  }
+  *out = selected;
+  return SSL_TLSEXT_ERR_OK;
+}
+
+} // namespace
+
+TlsContext* TlsContext::Instance() {
+  static TlsContext context;
+  return &context;
+}
+
+bool TlsContext::Init(const char* cert_file, const char* key_file, bool enable_ktls, size_t session_cache_size) {
+  if (ctx_) {
+    SSL_CTX_free(ctx_);
+    ctx_ = nullptr;
+  }
+  if (!cert_file || !key_file) {
+    return false;
+  }
+
+  SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+  if (!ctx) {
+    LOG_ERROR("SSL_CTX_new error!");
+    return false;
+  }
+  SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+  // 对端不发送close_notify直接关闭时当作正常关闭(SSL_read返回0), 而不是错误
+  SSL_CTX_set_options(ctx, SSL_OP_NO_RENEGOTIATION | SSL_OP_CIPHER_SERVER_PREFERENCE | SSL_OP_IGNORE_UNEXPECTED_EOF);
+  if (enable_ktls) {
+    SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+  }
+  // 允许部分写入(返回已发送的字节数), 和HttpConn::Write中writev的用法一致
+  SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER | SSL_MODE_RELEASE_BUFFERS);
+
+  if (SSL_CTX_use_certificate_chain_file(ctx, cert_file) != 1
+      || SSL_CTX_use_PrivateKey_file(ctx, key_file, SSL_FILETYPE_PEM) != 1
+      || SSL_CTX_check_private_key(ctx) != 1) {
+    LOG_ERROR("Load certificate %s / key %s error: %s", cert_file, key_file,
+              ERR_error_string(ERR_get_error(), nullptr));
+    SSL_CTX_free(ctx);
+    return false;
+  }
+
+  // 会话恢复: 会话票据(无状态, 默认开启)和服务端会话缓存
+  static const unsigned char kSessionIdContext[] = "WebServerCpp11";
+  SSL_CTX_set_session_id_context(ctx, kSessionIdContext, sizeof(kSessionIdContext) - 1);
+  if (session_cache_size > 0) {
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(ctx, static_cast<long>(session_cache_size));
+  } else {
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+  }
+  SSL_CTX_set_num_tickets(ctx, 1); // TLS 1.3默认发送2个票据, 浏览器只用一个
+  SSL_CTX_set_alpn_select_cb(ctx, SelectAlpn, nullptr);
+
+  // OpenSSL通过write发送, 无法传入MSG_NOSIGNAL, 对端关闭后写入会收到SIGPIPE
+  signal(SIGPIPE, SIG_IGN);
+
+  ctx_ = ctx;
+  LOG_INFO("TLS enabled, cert: %s, kTLS: %s", cert_file, enable_ktls ? "on" : "off");
+  return true;
+}
+
+TlsContext::~TlsContext() {
+  if (ctx_) {
+    SSL_CTX_free(ctx_);
+  }
+}
+
+#else // WEBSERVER_ENABLE_TLS
+
+TlsContext* TlsContext::Instance() {
+  static TlsContext context;
+  return &context;
+}
+
+bool TlsContext::Init(const char* cert_file, const char* key_file, bool enable_ktls, size_t session_cache_size) {
+  (void) enable_ktls;
+  (void) session_cache_size;
+  if (cert_file || key_file) {
+    LOG_ERROR("TLS is not compiled in (cmake -DWEBSERVER_TLS=ON)!");
+  }
+  return false;
+}
+
+TlsContext::~TlsContext() = default;
+
+#endif // WEBSERVER_ENABLE_TLS
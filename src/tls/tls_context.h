@@ -0,0 +1,47 @@
+// =============================================================================
+// Created by yangb on 2021/4/27.
+// TLS(OpenSSL)的全局配置: 证书、会话恢复、ALPN、kTLS
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_TLS_TLS_CONTEXT_H_
+#define WEBSERVERCPP11_SRC_TLS_TLS_CONTEXT_H_
+
+#include <cstddef>
+
+struct ssl_ctx_st;
+
+///
+/// @brief TLS上下文(单例模式), 所有连接共用一个SSL_CTX
+/// 会话缓存和会话票据(session ticket)都在SSL_CTX中, 客户端重连时可以跳过完整握手;
+/// 开启kTLS后, 握手完成的连接由内核加密发送, 正文仍然可以直接writev/sendfile, 不经过用户态加密.
+///
+/// 编译时没有OpenSSL(-DWEBSERVER_TLS=OFF)时, Init总是返回false.
+///
+class TlsContext {
+ public:
+  static TlsContext* Instance();
+
+  ///
+  /// @brief 加载证书和私钥
+  /// @param cert_file PEM格式的证书(链)
+  /// @param key_file PEM格式的私钥
+  /// @param enable_ktls 内核支持时使用kTLS发送
+  /// @param session_cache_size 服务端会话缓存的条目数, 0: 只使用会话票据
+  /// @return false: 加载失败或不支持TLS, 此时IsEnabled()为false
+  ///
+  bool Init(const char* cert_file, const char* key_file, bool enable_ktls, size_t session_cache_size);
+
+  inline bool IsEnabled() const { return ctx_ != nullptr; }
+
+  inline ssl_ctx_st* Get() const { return ctx_; }
+
+ private:
+  TlsContext() : ctx_(nullptr) {}
+
+  ~TlsContext();
+
+ private:
+  ssl_ctx_st* ctx_;
+};
+
+#endif //WEBSERVERCPP11_SRC_TLS_TLS_CONTEXT_H_
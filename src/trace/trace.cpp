@@ -0,0 +1,131 @@
+// =============================================================================
+// Created by yangb on 2021/4/23.
+// =============================================================================
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <cstdio>
+#include "trace.h"
+
+const char* const Tracer::kPath = "/__trace";
+
+Tracer* Tracer::Instance() {
+  static Tracer tracer;
+  return &tracer;
+}
+
+Tracer::ThreadState& Tracer::Local_() {
+  static thread_local ThreadState state;
+  return state;
+}
+
+Tracer::ThreadState::~ThreadState() {
+  if (ring) {
+    Instance()->ReleaseRing_(ring);
+  }
+}
+
+Tracer::Ring* Tracer::NewRing_() {
+  int tid = static_cast<int>(syscall(SYS_gettid));
+  {
+    // 导出时持有锁, 清空时不会有读者; 旧线程的事件不再导出
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (!free_rings_.empty()) {
+      Ring* ring = free_rings_.back();
+      free_rings_.pop_back();
+      ring->tid = tid;
+      ring->head.store(0, std::memory_order_relaxed);
+      return ring;
+    }
+  }
+  auto* ring = new Ring;
+  ring->tid = tid;
+  ring->events.resize(kRingSize);
+  std::lock_guard<std::mutex> locker(mtx_);
+  rings_.push_back(ring);
+  return ring;
+}
+
+void Tracer::ReleaseRing_(Ring* ring) {
+  std::lock_guard<std::mutex> locker(mtx_);
+  free_rings_.push_back(ring);
+}
+
+Tracer::Scope::Scope(const char* name, int arg) : name_(name), arg_(arg), sampled_(false), start_ns_(0) {
+  ThreadState& state = Local_();
+  if (state.depth++ == 0) { // 最外层追踪点, 决定本次是否采样
+    uint32_t every = Instance()->GetSampleRate();
+    state.sampled = every > 0 && (state.tick++ % every == 0);
+  }
+  sampled_ = state.sampled;
+  if (sampled_) {
+    start_ns_ = Metrics::NowNs();
+  }
+}
+
+Tracer::Scope::~Scope() {
+  ThreadState& state = Local_();
+  if (sampled_) {
+    Instance()->Record(name_, start_ns_, Metrics::NowNs() - start_ns_, arg_);
+  }
+  --state.depth;
+}
+
+void Tracer::Record(const char* name, int64_t start_ns, int64_t dur_ns, int arg) {
+  ThreadState& state = Local_();
+  if (state.depth > 0 ? !state.sampled : GetSampleRate() == 0) {
+    return;
+  }
+  if (!state.ring) {
+    state.ring = NewRing_();
+  }
+  Ring* ring = state.ring;
+  uint64_t head = ring->head.load(std::memory_order_relaxed);
+  ring->events[head & (kRingSize - 1)] = {name, start_ns, dur_ns, arg};
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+std::string Tracer::DumpChromeJson() const {
+  std::lock_guard<std::mutex> locker(mtx_);
+  std::string out = "{\"traceEvents\":[";
+  char line[256];
+  int pid = static_cast<int>(getpid());
+  bool first = true;
+
+  for (const Ring* ring : rings_) {
+    snprintf(line, sizeof(line),
+             "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"thread-%d\"}}",
+             first ? "" : ",", pid, ring->tid, ring->tid);
+    out += line;
+    first = false;
+
+    // 只读取尚未被覆盖的事件; 写线程可能正在写最旧的那一个, 因此少读一个
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t count = std::min<uint64_t>(head, kRingSize - 1);
+    for (uint64_t i = head - count; i < head; ++i) {
+      const Event& ev = ring->events[i & (kRingSize - 1)];
+      int n = snprintf(line, sizeof(line),
+                       ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                       ev.name, pid, ring->tid, ev.start_ns / 1e3, ev.dur_ns / 1e3);
+      if (ev.arg >= 0 && n > 0 && n < static_cast<int>(sizeof(line))) {
+        snprintf(line + n, sizeof(line) - n, ",\"args\":{\"fd\":%d}", ev.arg);
+      }
+      out += line;
+      out += '}';
+    }
+  }
+  out += "\n],\"displayTimeUnit\":\"ns\"}\n";
+  return out;
+}
+
+bool Tracer::DumpToFile(const char* path) const {
+  FILE* fp = fopen(path, "w");
+  if (!fp) {
+    return false;
+  }
+  std::string json = DumpChromeJson();
+  bool ok = fwrite(json.data(), 1, json.size(), fp) == json.size();
+  fclose(fp);
+  return ok;
+}
@@ -0,0 +1,126 @@
+// =============================================================================
+// Created by yangb on 2021/4/23.
+// 热路径追踪: 作用域追踪点 + 每线程环形缓冲区, 导出为Chrome trace JSON
+// (chrome://tracing 或 https://ui.perfetto.dev 打开)
+// =============================================================================
+
+#ifndef WEBSERVERCPP11_SRC_TRACE_TRACE_H_
+#define WEBSERVERCPP11_SRC_TRACE_TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../metrics/metrics.h"
+
+///
+/// @brief 追踪器(单例模式)
+/// 每个线程第一次记录时分配一个环形缓冲区, 只有该线程写入; 缓冲区满后覆盖最旧的事件.
+/// 线程退出时缓冲区放回空闲列表(其中的事件仍可导出), 之后新建的线程清空后复用.
+/// 采样以线程上最外层的追踪点为单位: 最外层追踪点决定是否记录, 内层追踪点跟随,
+/// 因此一次OnRead_/OnWrite_中的各个阶段要么全部记录, 要么全部不记录.
+///
+class Tracer {
+ public:
+  /// 每个线程的环形缓冲区能保存的事件数
+  static const size_t kRingSize = 1 << 14;
+
+  /// 保留的请求路径, 访问该路径返回Chrome trace JSON
+  static const char* const kPath;
+
+  static Tracer* Instance();
+
+  /// @brief 设置采样率
+  /// @param every_n 每n个最外层追踪点记录1个; 0: 关闭记录
+  inline void SetSampleRate(uint32_t every_n) { sample_every_.store(every_n, std::memory_order_relaxed); }
+
+  inline uint32_t GetSampleRate() const { return sample_every_.load(std::memory_order_relaxed); }
+
+  /// @brief 记录一个已完成的事件
+  /// @param name 事件名, 必须是字符串常量
+  /// @param start_ns 开始时间(Metrics::NowNs)
+  /// @param dur_ns 持续时间
+  /// @param arg 附加参数(如文件描述符), <0 表示没有
+  void Record(const char* name, int64_t start_ns, int64_t dur_ns, int arg = -1);
+
+  /// @brief 将所有线程缓冲区中的事件导出为Chrome trace JSON
+  std::string DumpChromeJson() const;
+
+  /// @brief 导出到文件
+  bool DumpToFile(const char* path) const;
+
+  /// @brief 作用域追踪点, 构造时开始计时, 析构时记录
+  class Scope {
+   public:
+    explicit Scope(const char* name, int arg = -1);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    const char* name_;
+    int arg_;
+    bool sampled_;
+    int64_t start_ns_;
+  };
+
+ private:
+  struct Event {
+    const char* name;
+    int64_t start_ns;
+    int64_t dur_ns;
+    int arg;
+  };
+
+  struct Ring {
+    int tid;
+    std::atomic<uint64_t> head{0};  // 已写入的事件总数
+    std::vector<Event> events;
+  };
+
+  /// @brief 每个线程的状态
+  struct ThreadState {
+    Ring* ring = nullptr;
+    int depth = 0;        // 当前追踪点嵌套深度
+    bool sampled = false; // 最外层追踪点是否被采样
+    uint32_t tick = 0;    // 最外层追踪点计数, 用于采样
+
+    ~ThreadState();
+  };
+
+  Tracer() = default;
+  ~Tracer() = default;
+
+  static ThreadState& Local_();
+  /// @brief 取一个空闲的缓冲区(清空后复用), 没有时新建
+  Ring* NewRing_();
+
+  /// @brief 线程退出时调用
+  void ReleaseRing_(Ring* ring);
+
+ private:
+  std::atomic<uint32_t> sample_every_{1};
+  mutable std::mutex mtx_;
+  std::vector<Ring*> rings_;
+  std::vector<Ring*> free_rings_;  // 其中线程已退出的缓冲区
+};
+
+#ifdef WEBSERVER_ENABLE_TRACE
+#define TRACE_CONCAT_INNER_(a, b) a##b
+#define TRACE_CONCAT_(a, b) TRACE_CONCAT_INNER_(a, b)
+/// 追踪当前作用域, 例如 TRACE_SCOPE("Parse");
+#define TRACE_SCOPE(name) Tracer::Scope TRACE_CONCAT_(trace_scope_, __LINE__)(name)
+/// 追踪当前作用域并附带一个整数参数, 例如 TRACE_SCOPE_ARG("OnRead", fd);
+#define TRACE_SCOPE_ARG(name, arg) Tracer::Scope TRACE_CONCAT_(trace_scope_, __LINE__)(name, arg)
+/// 记录一个已知起止时间的事件(如任务在队列中的等待)
+#define TRACE_EVENT(name, start_ns, dur_ns) \
+  do { Tracer::Instance()->Record(name, start_ns, dur_ns); } while (0)
+#else
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_SCOPE_ARG(name, arg) do {} while (0)
+#define TRACE_EVENT(name, start_ns, dur_ns) do {} while (0)
+#endif
+
+#endif //WEBSERVERCPP11_SRC_TRACE_TRACE_H_
@@ -0,0 +1,60 @@
+// =============================================================================
+// Created by yangb on 2021/4/28.
+// =============================================================================
+
+#include <unordered_map>
+#include "gtest/gtest.h"
+#include "../src/buffer/arena.h"
+
+TEST(TestArena, testAllocate) {
+  Arena arena(256);
+  char* a = static_cast<char*>(arena.Allocate(10, 1));
+  auto* b = static_cast<uint64_t*>(arena.Allocate(sizeof(uint64_t), alignof(uint64_t)));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % alignof(uint64_t), 0u);
+  EXPECT_GE(reinterpret_cast<char*>(b), a + 10);
+  EXPECT_EQ(arena.Capacity(), 256u);
+
+  // 超过块大小的分配单独分配一个块
+  arena.Allocate(1000, 1);
+  size_t capacity = arena.Capacity();
+  EXPECT_GT(capacity, 256u);
+
+  // Reset之后重复同样的分配不再增加内存
+  for (int i = 0; i < 10; ++i) {
+    arena.Reset();
+    EXPECT_EQ(arena.Allocate(10, 1), a);
+    arena.Allocate(sizeof(uint64_t), alignof(uint64_t));
+    arena.Allocate(1000, 1);
+    EXPECT_EQ(arena.Capacity(), capacity);
+  }
+
+  // 超过kMaxRetained的部分在Reset时释放
+  arena.Allocate(Arena::kMaxRetained, 1);
+  arena.Reset();
+  EXPECT_EQ(arena.Capacity(), 256u);
+}
+
+TEST(TestArena, testContainer) {
+  typedef std::unordered_map<ArenaString, ArenaString, ArenaStringHash, std::equal_to<ArenaString>,
+                             ArenaAllocator<std::pair<const ArenaString, ArenaString>>> Map;
+  Arena arena;
+  size_t capacity = 0;
+  for (int round = 0; round < 3; ++round) {
+    arena.Reset();
+    ArenaAllocator<char> alloc(&arena);
+    Map map(16, ArenaStringHash(), std::equal_to<ArenaString>(), alloc);
+    for (int i = 0; i < 100; ++i) {
+      ArenaString key(("key-" + std::to_string(i) + std::string(20, 'k')).c_str(), alloc);
+      map.emplace(key, ArenaString(std::string(i, 'v').c_str(), alloc));
+    }
+    ASSERT_EQ(map.size(), 100u);
+    auto it = map.find(ArenaString(("key-42" + std::string(20, 'k')).c_str()));
+    ASSERT_NE(it, map.end());
+    EXPECT_EQ(it->second, ArenaString(std::string(42, 'v').c_str()));
+    map.clear();
+    if (round == 0) {
+      capacity = arena.Capacity();
+    }
+    EXPECT_EQ(arena.Capacity(), capacity);
+  }
+}
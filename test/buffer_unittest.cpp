@@ -2,15 +2,74 @@
 // Created by yangb on 2021/4/2.
 // =============================================================================
 
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
 #include "gtest/gtest.h"
 #include "../src/buffer/buffer.h"
 
 TEST(TestBuffer, testAppendRetrieve) {
   Buffer buf;
   EXPECT_EQ(buf.ReadableBytes(), 0);
-  EXPECT_EQ(buf.PrependableBytes(), 0);
+  EXPECT_EQ(buf.PrependableBytes(), Buffer::kCheapPrepend);
 
   const std::string str(200, 'x');
   buf.Append(str);
   EXPECT_EQ(buf.ReadableBytes(), str.size());
 }
+
+TEST(TestBuffer, testGrowPrepend) {
+  Buffer buf(16);
+  buf.Append("0123456789");
+  buf.Retrieve(4);
+  // 空间不够时搬移或扩容, 内容不变, 开头仍预留kCheapPrepend
+  const std::string big(100, 'y');
+  buf.Append(big);
+  EXPECT_EQ(std::string(buf.Peek(), buf.ReadableBytes()), "456789" + big);
+  EXPECT_EQ(buf.PrependableBytes(), Buffer::kCheapPrepend);
+
+  uint32_t len = 42;
+  buf.Prepend(&len, sizeof(len));
+  EXPECT_EQ(buf.ReadableBytes(), sizeof(len) + 106);
+  EXPECT_EQ(memcmp(buf.Peek(), &len, sizeof(len)), 0);
+
+  buf.RetrieveAll();
+  EXPECT_EQ(buf.ReadableBytes(), 0u);
+  EXPECT_EQ(buf.PrependableBytes(), Buffer::kCheapPrepend);
+}
+
+TEST(TestBuffer, testReadFd) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  const std::string payload(100 * 1024, 'z');
+  ASSERT_EQ(write(fds[1], payload.data(), 60 * 1024), 60 * 1024);  // 不超过管道容量
+  Buffer buf;
+  int err = 0;
+  // 读满预留空间时扩容继续读, 一次读出管道中的全部数据
+  EXPECT_EQ(buf.ReadFd(fds[0], &err), 60 * 1024);
+  EXPECT_EQ(std::string(buf.Peek(), buf.ReadableBytes()), payload.substr(0, 60 * 1024));
+
+  // 没有数据时返回read的返回值
+  close(fds[1]);
+  EXPECT_EQ(buf.ReadFd(fds[0], &err), 0);
+  close(fds[0]);
+}
+
+TEST(TestBuffer, testReadFdWholeRequest) {
+  // LT模式下每次读事件只调用一次ReadFd, 超过初始预留空间(1KB)的请求也要完整读入
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  std::string request = "GET /index.html HTTP/1.1\r\nHost: localhost\r\nCookie: " + std::string(2500, 'c') + "\r\n\r\n";
+  ASSERT_EQ(write(fds[1], request.data(), request.size()), static_cast<ssize_t>(request.size()));
+  Buffer buf;
+  int err = 0;
+  EXPECT_EQ(buf.ReadFd(fds[0], &err), static_cast<ssize_t>(request.size()));
+  EXPECT_EQ(std::string(buf.Peek(), buf.ReadableBytes()), request);
+
+  // 读完后没有数据: EAGAIN
+  EXPECT_LT(buf.ReadFd(fds[0], &err), 0);
+  EXPECT_EQ(err, EAGAIN);
+  close(fds[0]);
+  close(fds[1]);
+}
@@ -0,0 +1,38 @@
+// =============================================================================
+// Created by yangb on 2021/4/30.
+// =============================================================================
+
+#include <pthread.h>
+#include <sched.h>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../src/pool/cpu_affinity.h"
+
+TEST(TestCpuAffinity, testParse) {
+  EXPECT_EQ(CpuAffinity::Parse("0-3,8"), std::vector<int>({0, 1, 2, 3, 8}));
+  EXPECT_EQ(CpuAffinity::Parse("5,1,2-3,3"), std::vector<int>({1, 2, 3, 5}));  // 排序去重
+  EXPECT_EQ(CpuAffinity::ToString({0, 1, 2, 3, 8, 10, 11}), "0-3,8,10-11");
+  EXPECT_TRUE(CpuAffinity::Parse(nullptr).empty());
+  EXPECT_TRUE(CpuAffinity::Parse("").empty());
+  EXPECT_TRUE(CpuAffinity::Parse("3-1").empty());
+  EXPECT_TRUE(CpuAffinity::Parse("1,x").empty());
+  EXPECT_TRUE(CpuAffinity::Parse("node:").empty());
+  EXPECT_TRUE(CpuAffinity::Parse("node:100000").empty());
+}
+
+TEST(TestCpuAffinity, testPinAndName) {
+  std::thread([] {
+    ASSERT_TRUE(CpuAffinity::PinCurrentThread({0}));
+    cpu_set_t set;
+    ASSERT_EQ(pthread_getaffinity_np(pthread_self(), sizeof(set), &set), 0);
+    EXPECT_EQ(CPU_COUNT(&set), 1);
+    EXPECT_TRUE(CPU_ISSET(0, &set));
+
+    CpuAffinity::SetThreadName("a-very-long-thread-name");
+    char name[16];
+    ASSERT_EQ(pthread_getname_np(pthread_self(), name, sizeof(name)), 0);
+    EXPECT_STREQ(name, "a-very-long-thr");  // 截断为15个字符
+  }).join();
+}
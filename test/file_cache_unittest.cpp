@@ -0,0 +1,117 @@
+// =============================================================================
+// Created by yangb on 2021/4/25.
+// =============================================================================
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../src/http/file_cache.h"
+
+namespace {
+
+class TestFileCache : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char dir[] = "/tmp/file_cache_unittest_XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    dir_ = dir;
+    FileCache::Instance()->Init(100, 150);
+  }
+
+  void TearDown() override {
+    FileCache::Instance()->Init(0, 0);
+    for (const std::string& file : files_) {
+      unlink(file.c_str());
+    }
+    rmdir(dir_.c_str());
+  }
+
+  std::string Write_(const std::string& name, const std::string& content) {
+    std::string file = dir_ + name;
+    int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    EXPECT_GE(fd, 0);
+    EXPECT_EQ(write(fd, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+    close(fd);
+    files_.push_back(file);
+    return file;
+  }
+
+  std::shared_ptr<const FileCache::Entry> Load_(const std::string& file) {
+    int fd = open(file.c_str(), O_RDONLY);
+    EXPECT_GE(fd, 0);
+    struct stat st{};
+    fstat(fd, &st);
+    auto entry = FileCache::Instance()->Load(file, fd, st);
+    close(fd);
+    return entry;
+  }
+
+  std::string dir_;
+  std::vector<std::string> files_;
+};
+
+} // namespace
+
+TEST_F(TestFileCache, testLoadAndHit) {
+  FileCache* cache = FileCache::Instance();
+  std::string file = Write_("/a.html", "hello");
+  EXPECT_FALSE(cache->Find(file));
+
+  auto entry = Load_(file);
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(entry->data, "hello");
+  EXPECT_EQ(cache->Find(file), entry);
+  EXPECT_EQ(cache->Find(dir_.c_str(), "/a.html"), entry);  // 目录和路径分开传入
+  EXPECT_FALSE(cache->Find(dir_.c_str(), "/b.html"));
+
+  std::string big = Write_("/big.html", std::string(101, 'x'));
+  EXPECT_FALSE(Load_(big));  // 超过max_file_size
+  EXPECT_FALSE(cache->Find(big));
+}
+
+TEST_F(TestFileCache, testRevalidate) {
+  FileCache* cache = FileCache::Instance();
+  std::string file = Write_("/a.html", "hello");
+  auto entry = Load_(file);
+  ASSERT_TRUE(entry);
+
+  Write_("/a.html", "hello, world");
+  EXPECT_EQ(cache->Find(file), entry);  // kRevalidateMs内不检查
+  std::this_thread::sleep_for(std::chrono::milliseconds(FileCache::kRevalidateMs + 50));
+  EXPECT_FALSE(cache->Find(file));  // 文件已修改, 丢弃旧内容
+  EXPECT_EQ(entry->data, "hello");  // 持有引用的响应不受影响
+
+  auto reloaded = Load_(file);
+  ASSERT_TRUE(reloaded);
+  EXPECT_EQ(cache->Find(file), reloaded);
+  EXPECT_EQ(reloaded->data, "hello, world");
+}
+
+TEST_F(TestFileCache, testFull) {
+  FileCache* cache = FileCache::Instance();
+  std::string a = Write_("/a.html", std::string(100, 'a'));
+  std::string b = Write_("/b.html", std::string(100, 'b'));
+  std::string c = Write_("/c.html", std::string(50, 'c'));
+
+  auto entry_a = Load_(a);
+  ASSERT_TRUE(entry_a);
+  auto entry_b = Load_(b);  // 超过capacity: 返回内容, 但不加入缓存
+  ASSERT_TRUE(entry_b);
+  EXPECT_EQ(entry_b->data, std::string(100, 'b'));
+  EXPECT_FALSE(cache->Find(b));
+  EXPECT_EQ(cache->Find(a), entry_a);
+
+  EXPECT_TRUE(Load_(c));  // 剩余空间还能放下
+  EXPECT_TRUE(cache->Find(c));
+
+  cache->Clear();
+  EXPECT_FALSE(cache->Find(a));
+  EXPECT_TRUE(Load_(b));
+  EXPECT_TRUE(cache->Find(b));
+}
@@ -0,0 +1,56 @@
+// =============================================================================
+// Created by yangb on 2021/5/2.
+// =============================================================================
+
+#include <poll.h>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../src/timer/heap_timer.h"
+#include "../src/timer/timer_fd.h"
+
+TEST(TestHeapTimer, testClockWrap) {
+  EXPECT_TRUE(LoopClock::Before(1, 2));
+  EXPECT_FALSE(LoopClock::Before(2, 2));
+  EXPECT_TRUE(LoopClock::Before(UINT32_MAX - 10, 5));  // 回绕后仍然在前
+  EXPECT_FALSE(LoopClock::Before(5, UINT32_MAX - 10));
+}
+
+TEST(TestHeapTimer, testExpireOrder) {
+  HeapTimer timer;
+  std::vector<int> fired;
+  timer.Add(1, 0, [&fired] { fired.push_back(1); });
+  timer.Add(2, 60000, [&fired] { fired.push_back(2); });
+  timer.Add(3, 0, [&fired] { fired.push_back(3); });
+  timer.Add(3, 30000, [&fired] { fired.push_back(30); });  // 已有节点, 更新超时时间和回调
+  EXPECT_EQ(timer.GetNextTick(), 30000);  // 执行已到期的1
+  EXPECT_EQ(fired, std::vector<int>({1}));
+
+  timer.Adjust(3, 90000);
+  EXPECT_EQ(timer.GetNextTick(), 60000);
+  timer.DoWork(2);
+  EXPECT_EQ(fired, std::vector<int>({1, 2}));
+  EXPECT_EQ(timer.GetNextTick(), 90000);
+  timer.DoWork(3);
+  EXPECT_EQ(timer.GetNextTick(), -1);
+  EXPECT_EQ(fired, std::vector<int>({1, 2, 30}));
+}
+
+TEST(TestHeapTimer, testTimerFdCoalesce) {
+  TimerFd timer_fd(10);
+  ASSERT_GE(timer_fd.GetFd(), 0);
+  uint32_t fired_at = 0;
+  EXPECT_FALSE(timer_fd.Consume(&fired_at));  // 没有设置
+
+  timer_fd.Arm(3, 0);   // 取整到10ms
+  timer_fd.Arm(7, 0);   // 同一个网格, 不重新设置
+  timer_fd.Arm(25, 0);  // 更晚, 不重新设置
+  struct pollfd pfd{timer_fd.GetFd(), POLLIN, 0};
+  ASSERT_EQ(poll(&pfd, 1, 1000), 1);
+  EXPECT_TRUE(timer_fd.Consume(&fired_at));
+  EXPECT_EQ(fired_at, 10u);
+
+  timer_fd.Arm(5, 10);  // 已经到期, 马上触发
+  ASSERT_EQ(poll(&pfd, 1, 1000), 1);
+  EXPECT_TRUE(timer_fd.Consume(&fired_at));
+  EXPECT_EQ(fired_at, 10u);
+}
@@ -0,0 +1,134 @@
+// =============================================================================
+// Created by yangb on 2021/4/26.
+// =============================================================================
+
+#include "gtest/gtest.h"
+#include "../src/http2/hpack.h"
+
+namespace {
+
+std::string FromHex(const std::string& hex) {
+  std::string out;
+  for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+    out.push_back(static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+  }
+  return out;
+}
+
+bool DecodeHex(HpackDecoder& decoder, const std::string& hex, std::vector<HeaderField>* headers) {
+  std::string data = FromHex(hex);
+  return decoder.Decode(reinterpret_cast<const uint8_t*>(data.data()), data.size(), headers);
+}
+
+} // namespace
+
+TEST(TestHpack, testInteger) {
+  // RFC 7541 C.1
+  std::string out;
+  Hpack::EncodeInteger(10, 5, 0, &out);
+  EXPECT_EQ(out, FromHex("0a"));
+  out.clear();
+  Hpack::EncodeInteger(1337, 5, 0, &out);
+  EXPECT_EQ(out, FromHex("1f9a0a"));
+
+  const auto* p = reinterpret_cast<const uint8_t*>(out.data());
+  uint64_t value = 0;
+  EXPECT_TRUE(Hpack::DecodeInteger(p, p + out.size(), 5, &value));
+  EXPECT_EQ(value, 1337);
+}
+
+TEST(TestHpack, testHuffman) {
+  std::string encoded;
+  Hpack::HuffmanEncode("www.example.com", &encoded);
+  EXPECT_EQ(encoded, FromHex("f1e3c2e5f23a6ba0ab90f4ff"));
+
+  std::string decoded;
+  EXPECT_TRUE(Hpack::HuffmanDecode(reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size(), &decoded));
+  EXPECT_EQ(decoded, "www.example.com");
+
+  // 填充位不是全1
+  std::string bad = FromHex("f1e3c2e5f23a6ba0ab90f4fe");
+  decoded.clear();
+  EXPECT_FALSE(Hpack::HuffmanDecode(reinterpret_cast<const uint8_t*>(bad.data()), bad.size(), &decoded));
+}
+
+TEST(TestHpack, testDecodeRequests) {
+  // RFC 7541 C.4: 同一连接上的三个请求, 使用Huffman编码和动态表
+  HpackDecoder decoder;
+  std::vector<HeaderField> headers;
+  ASSERT_TRUE(DecodeHex(decoder, "828684418cf1e3c2e5f23a6ba0ab90f4ff", &headers));
+  ASSERT_EQ(headers.size(), 4);
+  EXPECT_EQ(headers[0], HeaderField(":method", "GET"));
+  EXPECT_EQ(headers[3], HeaderField(":authority", "www.example.com"));
+
+  headers.clear();
+  ASSERT_TRUE(DecodeHex(decoder, "828684be5886a8eb10649cbf", &headers));
+  ASSERT_EQ(headers.size(), 5);
+  EXPECT_EQ(headers[3], HeaderField(":authority", "www.example.com"));
+  EXPECT_EQ(headers[4], HeaderField("cache-control", "no-cache"));
+
+  headers.clear();
+  ASSERT_TRUE(DecodeHex(decoder, "828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf", &headers));
+  ASSERT_EQ(headers.size(), 5);
+  EXPECT_EQ(headers[1], HeaderField(":scheme", "https"));
+  EXPECT_EQ(headers[2], HeaderField(":path", "/index.html"));
+  EXPECT_EQ(headers[4], HeaderField("custom-key", "custom-value"));
+
+  // 引用不存在的动态表条目
+  headers.clear();
+  EXPECT_FALSE(DecodeHex(decoder, "ff00", &headers));
+}
+
+TEST(TestHpack, testEncodeRoundTrip) {
+  HpackEncoder encoder;
+  HpackDecoder decoder;
+  std::vector<HeaderField> fields = {
+      {":status", "200"}, {"content-type", "text/html"}, {"content-length", "3064"}};
+
+  std::string first;
+  encoder.Encode(fields, &first);
+  std::string second;
+  encoder.Encode(fields, &second);
+  EXPECT_LT(second.size(), first.size());  // 第二次content-type命中动态表
+
+  std::vector<HeaderField> headers;
+  ASSERT_TRUE(decoder.Decode(reinterpret_cast<const uint8_t*>(first.data()), first.size(), &headers));
+  EXPECT_EQ(headers, fields);
+  headers.clear();
+  ASSERT_TRUE(decoder.Decode(reinterpret_cast<const uint8_t*>(second.data()), second.size(), &headers));
+  EXPECT_EQ(headers, fields);
+}
+
+TEST(TestHpack, testHeaderListLimit) {
+  HpackDecoder decoder;
+  // 带索引的字面量: 新名称"x-bomb", 值4000字节, 进入动态表索引62
+  std::string block = std::string("\x40\x06x-bomb", 8);
+  std::string value(4000, 'a');
+  block.push_back(static_cast<char>(0x7f));  // 非Huffman, 长度127 + 续字节
+  size_t rest = value.size() - 127;
+  while (rest >= 128) {
+    block.push_back(static_cast<char>((rest & 0x7f) | 0x80));
+    rest >>= 7;
+  }
+  block.push_back(static_cast<char>(rest));
+  block += value;
+  // 之后每个字节0xbe(索引62)都会展开成4KB的头部
+  block += std::string(1000, static_cast<char>(0xbe));
+
+  std::vector<HeaderField> headers;
+  EXPECT_FALSE(decoder.Decode(reinterpret_cast<const uint8_t*>(block.data()), block.size(), &headers));
+  size_t list_size = 0;
+  for (const auto& field : headers) {
+    list_size += field.first.size() + field.second.size() + 32;
+  }
+  EXPECT_LE(list_size, HpackDecoder::kMaxHeaderListSize);
+  EXPECT_GT(headers.size(), 1u);  // 限制前的字段仍正常解码
+
+  // 限制以内的头部块不受影响
+  HpackDecoder small;
+  std::string ok = block.substr(0, block.size() - 1000) + std::string(10, static_cast<char>(0xbe));
+  headers.clear();
+  ASSERT_TRUE(small.Decode(reinterpret_cast<const uint8_t*>(ok.data()), ok.size(), &headers));
+  EXPECT_EQ(headers.size(), 11u);
+  EXPECT_EQ(headers.back(), HeaderField("x-bomb", value));
+}
@@ -0,0 +1,328 @@
+// =============================================================================
+// Created by yangb on 2021/5/2.
+// =============================================================================
+
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../src/http/http_conn.h"
+#include "../src/http2/http2_session.h"
+
+namespace {
+
+const std::string kPreface(Http2Session::kPreface, Http2Session::kPrefaceLen);
+
+struct Frame {
+  uint8_t type;
+  uint8_t flags;
+  uint32_t stream_id;
+  std::string payload;
+};
+
+std::string U32(uint32_t v) {
+  return {static_cast<char>(v >> 24), static_cast<char>(v >> 16), static_cast<char>(v >> 8), static_cast<char>(v)};
+}
+
+uint32_t ReadU32(const std::string& s, size_t pos) {
+  const auto* p = reinterpret_cast<const uint8_t*>(s.data() + pos);
+  return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+void WriteFrame(Buffer& in, uint8_t type, uint8_t flags, uint32_t stream_id, const std::string& payload) {
+  size_t len = payload.size();
+  std::string header = {static_cast<char>(len >> 16), static_cast<char>(len >> 8), static_cast<char>(len),
+                        static_cast<char>(type), static_cast<char>(flags)};
+  in.Append(header + U32(stream_id) + payload);
+}
+
+/// 一个SETTINGS参数
+std::string Setting(uint16_t id, uint32_t value) {
+  return std::string{static_cast<char>(id >> 8), static_cast<char>(id)} + U32(value);
+}
+
+/// 取出out中所有完整的帧
+std::vector<Frame> ReadFrames(Buffer& out) {
+  std::vector<Frame> frames;
+  std::string data = out.RetrieveAllToStr();
+  size_t pos = 0;
+  while (pos + 9 <= data.size()) {
+    const auto* p = reinterpret_cast<const uint8_t*>(data.data() + pos);
+    size_t len = (static_cast<size_t>(p[0]) << 16) | (p[1] << 8) | p[2];
+    Frame frame{p[3], p[4], ReadU32(data, pos + 5) & 0x7fffffff, data.substr(pos + 9, len)};
+    frames.push_back(frame);
+    pos += 9 + len;
+  }
+  EXPECT_EQ(pos, data.size());
+  return frames;
+}
+
+/// GOAWAY的错误码, 没有GOAWAY时返回-1
+int GoAwayCode(const std::vector<Frame>& frames) {
+  for (const Frame& frame : frames) {
+    if (frame.type == Http2Session::GOAWAY) {
+      return static_cast<int>(ReadU32(frame.payload, 4));
+    }
+  }
+  return -1;
+}
+
+/// 某个流收到的DATA字节数
+size_t DataBytes(const std::vector<Frame>& frames, uint32_t stream_id) {
+  size_t bytes = 0;
+  for (const Frame& frame : frames) {
+    if (frame.type == Http2Session::DATA && frame.stream_id == stream_id) {
+      bytes += frame.payload.size();
+    }
+  }
+  return bytes;
+}
+
+const uint8_t kEndStream = 0x1;
+const uint8_t kAck = 0x1;
+const uint8_t kEndHeaders = 0x4;
+
+} // namespace
+
+class TestHttp2Session : public ::testing::Test {
+ protected:
+  static const size_t kBigSize = 100000;
+
+  void SetUp() override {
+    HttpConn::kSrcDir = "/nonexistent";
+    Router* router = Router::Instance();
+    router->Clear();
+    router->AddHandler(Router::ANY, "/small", [](HttpRequest&, HttpResponse& response, Buffer& buff) {
+      response.MakeResponse(buff, "hello", "text/plain");
+    }, false, Router::IO);
+    router->AddHandler(Router::ANY, "/big", [](HttpRequest&, HttpResponse& response, Buffer& buff) {
+      response.MakeResponse(buff, std::string(kBigSize, 'b'), "text/plain");
+    }, false, Router::IO);
+    router->AddHandler(Router::ANY, "/db", [](HttpRequest&, HttpResponse& response, Buffer& buff) {
+      response.MakeResponse(buff, "db", "text/plain");
+    }, true, Router::DB);
+  }
+
+  void TearDown() override {
+    Router::Instance()->Clear();
+  }
+
+  /// 发送连接前言和SETTINGS, 丢弃服务端的SETTINGS和ACK
+  void Start(const std::string& settings = "") {
+    in_.Append(kPreface);
+    WriteFrame(in_, Http2Session::SETTINGS, 0, 0, settings);
+    session_.Process(in_, out_);
+    std::vector<Frame> frames = ReadFrames(out_);
+    ASSERT_EQ(frames.size(), 2u);
+    EXPECT_EQ(frames[0].type, Http2Session::SETTINGS);
+    EXPECT_EQ(frames[1].type, Http2Session::SETTINGS);
+    EXPECT_EQ(frames[1].flags, kAck);
+  }
+
+  /// 请求的头部块
+  std::string Headers(const std::string& method, const std::string& path) {
+    std::string block;
+    encoder_.Encode({{":method", method}, {":scheme", "http"}, {":path", path}, {":authority", "localhost"}},
+                    &block);
+    return block;
+  }
+
+  void Get(uint32_t stream_id, const std::string& path) {
+    WriteFrame(in_, Http2Session::HEADERS, kEndHeaders | kEndStream, stream_id, Headers("GET", path));
+  }
+
+  std::vector<Frame> Process(bool defer_blocking = false) {
+    session_.Process(in_, out_, defer_blocking);
+    return ReadFrames(out_);
+  }
+
+  Http2Session session_;
+  HpackEncoder encoder_;
+  Buffer in_;
+  Buffer out_;
+};
+
+const size_t TestHttp2Session::kBigSize;
+
+TEST_F(TestHttp2Session, testPreface) {
+  // 前言不完整时等待剩下的部分
+  in_.Append(kPreface.substr(0, 10));
+  EXPECT_TRUE(Process().empty());
+  EXPECT_EQ(in_.ReadableBytes(), 10u);
+  in_.Append(kPreface.substr(10));
+  Get(1, "/small");
+  // 收到完整的前言后先发送SETTINGS
+  std::vector<Frame> frames = Process();
+  ASSERT_EQ(frames.size(), 3u);
+  EXPECT_EQ(frames[0].type, Http2Session::SETTINGS);
+  EXPECT_EQ(frames[0].payload, Setting(0x3, Http2Session::kMaxConcurrentStreams) +
+                               Setting(0x6, HpackDecoder::kMaxHeaderListSize));
+  frames.erase(frames.begin());
+  EXPECT_EQ(frames[0].type, Http2Session::HEADERS);
+  EXPECT_EQ(frames[1].type, Http2Session::DATA);
+  EXPECT_EQ(frames[1].flags, kEndStream);
+  EXPECT_EQ(frames[1].payload, "hello");
+}
+
+TEST_F(TestHttp2Session, testBadPreface) {
+  in_.Append("PRI * HTTP/1.1\r\n\r\nSM\r\n\r\n");
+  std::vector<Frame> frames = Process();
+  EXPECT_EQ(GoAwayCode(frames), Http2Session::PROTOCOL_ERROR);
+  EXPECT_TRUE(session_.IsClosing());
+  EXPECT_EQ(in_.ReadableBytes(), 0u);
+}
+
+TEST_F(TestHttp2Session, testSettingsAndPing) {
+  Start(Setting(0x5, 32768));  // SETTINGS_MAX_FRAME_SIZE
+  WriteFrame(in_, Http2Session::PING, 0, 0, "12345678");
+  std::vector<Frame> frames = Process();
+  ASSERT_EQ(frames.size(), 1u);
+  EXPECT_EQ(frames[0].type, Http2Session::PING);
+  EXPECT_EQ(frames[0].flags, kAck);
+  EXPECT_EQ(frames[0].payload, "12345678");
+
+  // 长度不是6的倍数
+  WriteFrame(in_, Http2Session::SETTINGS, 0, 0, "12345");
+  EXPECT_EQ(GoAwayCode(Process()), Http2Session::FRAME_SIZE_ERROR);
+  EXPECT_TRUE(session_.IsClosing());
+}
+
+TEST_F(TestHttp2Session, testInvalidInitialWindow) {
+  Start();
+  WriteFrame(in_, Http2Session::SETTINGS, 0, 0, Setting(0x4, 0x80000000u));
+  EXPECT_EQ(GoAwayCode(Process()), Http2Session::FLOW_CONTROL_ERROR);
+}
+
+TEST_F(TestHttp2Session, testFlowControl) {
+  Start(Setting(0x4, 100));  // SETTINGS_INITIAL_WINDOW_SIZE
+  Get(1, "/big");
+  std::vector<Frame> frames = Process();
+  ASSERT_EQ(frames.size(), 2u);
+  EXPECT_EQ(frames[0].type, Http2Session::HEADERS);
+  EXPECT_EQ(DataBytes(frames, 1), 100u);  // 流的窗口用完
+
+  WriteFrame(in_, Http2Session::WINDOW_UPDATE, 0, 1, U32(1000));
+  EXPECT_EQ(DataBytes(Process(), 1), 1000u);
+
+  // 流的窗口足够, 连接的窗口(65535)限制发送量
+  WriteFrame(in_, Http2Session::WINDOW_UPDATE, 0, 1, U32(1 << 20));
+  frames = Process();
+  EXPECT_EQ(DataBytes(frames, 1), 65535u - 1100);
+  for (const Frame& frame : frames) {
+    EXPECT_LE(frame.payload.size(), static_cast<size_t>(Http2Session::kMaxFrameSize));
+    EXPECT_EQ(frame.flags & kEndStream, 0);
+  }
+
+  WriteFrame(in_, Http2Session::WINDOW_UPDATE, 0, 0, U32(1 << 20));
+  frames = Process();
+  EXPECT_EQ(DataBytes(frames, 1), kBigSize - 65535u);
+  ASSERT_FALSE(frames.empty());
+  EXPECT_EQ(frames.back().flags, kEndStream);
+
+  // 连接上增量为0是连接错误
+  WriteFrame(in_, Http2Session::WINDOW_UPDATE, 0, 0, U32(0));
+  EXPECT_EQ(GoAwayCode(Process()), Http2Session::PROTOCOL_ERROR);
+}
+
+TEST_F(TestHttp2Session, testContinuation) {
+  Start();
+  std::string block = Headers("GET", "/small");
+  WriteFrame(in_, Http2Session::HEADERS, kEndStream, 1, block.substr(0, 3));
+  WriteFrame(in_, Http2Session::CONTINUATION, 0, 1, block.substr(3, 2));
+  EXPECT_TRUE(Process().empty());  // 头部块还不完整
+  WriteFrame(in_, Http2Session::CONTINUATION, kEndHeaders, 1, block.substr(5));
+  std::vector<Frame> frames = Process();
+  ASSERT_EQ(frames.size(), 2u);
+  EXPECT_EQ(frames[0].type, Http2Session::HEADERS);
+  EXPECT_EQ(frames[1].payload, "hello");
+
+  // 头部块中间插入其他帧
+  WriteFrame(in_, Http2Session::HEADERS, kEndStream, 3, block.substr(0, 3));
+  WriteFrame(in_, Http2Session::PING, 0, 0, "12345678");
+  EXPECT_EQ(GoAwayCode(Process()), Http2Session::PROTOCOL_ERROR);
+}
+
+TEST_F(TestHttp2Session, testContinuationLimit) {
+  Start();
+  // 头部块超过kMaxHeaderBlock
+  WriteFrame(in_, Http2Session::HEADERS, kEndStream, 1, std::string(100, 'x'));
+  for (size_t sent = 100; sent <= Http2Session::kMaxHeaderBlock; sent += Http2Session::kMaxFrameSize) {
+    WriteFrame(in_, Http2Session::CONTINUATION, 0, 1, std::string(Http2Session::kMaxFrameSize, 'x'));
+  }
+  EXPECT_EQ(GoAwayCode(Process()), Http2Session::PROTOCOL_ERROR);
+  EXPECT_TRUE(session_.IsClosing());
+}
+
+TEST_F(TestHttp2Session, testResetStream) {
+  Start(Setting(0x4, 10));
+  Get(1, "/big");
+  EXPECT_EQ(DataBytes(Process(), 1), 10u);
+
+  // 重置后不再发送该流的数据
+  WriteFrame(in_, Http2Session::RST_STREAM, 0, 1, U32(Http2Session::CANCEL));
+  WriteFrame(in_, Http2Session::WINDOW_UPDATE, 0, 1, U32(1000));
+  EXPECT_TRUE(Process().empty());
+
+  // 重置还没有打开的流
+  WriteFrame(in_, Http2Session::RST_STREAM, 0, 7, U32(Http2Session::CANCEL));
+  EXPECT_EQ(GoAwayCode(Process()), Http2Session::PROTOCOL_ERROR);
+}
+
+TEST_F(TestHttp2Session, testGoAwayReceived) {
+  Start(Setting(0x4, 10));
+  Get(1, "/big");
+  Process();
+  // 对端发送GOAWAY后, 未完成的流发送完才关闭
+  WriteFrame(in_, Http2Session::GOAWAY, 0, 0, U32(1) + U32(Http2Session::NO_ERROR));
+  Process();
+  EXPECT_FALSE(session_.IsClosing());
+  WriteFrame(in_, Http2Session::WINDOW_UPDATE, 0, 1, U32(kBigSize));
+  WriteFrame(in_, Http2Session::WINDOW_UPDATE, 0, 0, U32(kBigSize));
+  EXPECT_EQ(DataBytes(Process(), 1), kBigSize - 10);
+  EXPECT_TRUE(session_.IsClosing());
+}
+
+TEST_F(TestHttp2Session, testRoundRobin) {
+  Start();
+  Get(1, "/big");
+  Get(3, "/big");
+  std::vector<Frame> frames = Process();
+  // 两个流的DATA帧交替发送, 直到连接的窗口用完
+  std::vector<uint32_t> order;
+  for (const Frame& frame : frames) {
+    if (frame.type == Http2Session::DATA) {
+      order.push_back(frame.stream_id);
+    }
+  }
+  EXPECT_EQ(order, (std::vector<uint32_t>{1, 3, 1, 3}));
+  EXPECT_EQ(DataBytes(frames, 1) + DataBytes(frames, 3), 65535u);
+}
+
+TEST_F(TestHttp2Session, testDeferBlocking) {
+  Start();
+  Get(1, "/db");
+  Get(3, "/small");
+  // 路由到DB执行器的流暂存, 其他流照常处理
+  std::vector<Frame> frames = Process(true);
+  EXPECT_TRUE(session_.HasDeferred());
+  EXPECT_EQ(session_.DeferredExecutor(), Router::DB);
+  ASSERT_EQ(frames.size(), 2u);
+  EXPECT_EQ(frames[0].stream_id, 3u);
+
+  session_.RunDeferred(out_);
+  frames = ReadFrames(out_);
+  EXPECT_FALSE(session_.HasDeferred());
+  ASSERT_EQ(frames.size(), 2u);
+  EXPECT_EQ(frames[0].stream_id, 1u);
+  EXPECT_EQ(frames[1].payload, "db");
+
+  // 线程池满时拒绝暂存的流
+  Get(5, "/db");
+  EXPECT_TRUE(Process(true).empty());
+  session_.RefuseDeferred(out_);
+  frames = ReadFrames(out_);
+  ASSERT_EQ(frames.size(), 1u);
+  EXPECT_EQ(frames[0].type, Http2Session::RST_STREAM);
+  EXPECT_EQ(frames[0].stream_id, 5u);
+  EXPECT_EQ(ReadU32(frames[0].payload, 0), static_cast<uint32_t>(Http2Session::REFUSED_STREAM));
+  EXPECT_EQ(session_.DeferredExecutor(), Router::IO);
+}
@@ -0,0 +1,73 @@
+// =============================================================================
+// Created by yangb on 2021/4/29.
+// =============================================================================
+
+#include <cstring>
+#include <string>
+#include "gtest/gtest.h"
+#include "../src/http/http_headers.h"
+
+namespace {
+
+void Set(HttpHeaders& headers, const std::string& name, const std::string& value) {
+  headers.Set(name.data(), name.size(), value.data(), value.size());
+}
+
+} // namespace
+
+TEST(TestHttpHeaders, testLookup) {
+  // 每个名称都映射到自己(哈希没有冲突), 不区分大小写
+  for (int id = 0; id < HttpHeaders::KNOWN_COUNT; ++id) {
+    std::string name = HttpHeaders::Name(static_cast<HttpHeaders::Id>(id));
+    EXPECT_EQ(HttpHeaders::Lookup(name.data(), name.size()), id) << name;
+    for (char& ch : name) {
+      ch = static_cast<char>(tolower(ch));
+    }
+    EXPECT_EQ(HttpHeaders::Lookup(name.data(), name.size()), id) << name;
+  }
+  EXPECT_EQ(HttpHeaders::Lookup("Hosts", 5), HttpHeaders::UNKNOWN);
+  EXPECT_EQ(HttpHeaders::Lookup("X-Forwarded-For", 15), HttpHeaders::UNKNOWN);
+  EXPECT_EQ(HttpHeaders::Lookup("", 0), HttpHeaders::UNKNOWN);
+}
+
+TEST(TestHttpHeaders, testSetGet) {
+  Arena arena;
+  HttpHeaders headers(&arena);
+  EXPECT_FALSE(headers.Has(HttpHeaders::HOST));
+  EXPECT_STREQ(headers.Get(HttpHeaders::HOST), "");
+
+  Set(headers, "host", "127.0.0.1:12345");
+  Set(headers, "CONNECTION", "keep-alive");
+  Set(headers, "X-Request-Id", "1");
+  Set(headers, "x-request-id", "2");  // 同名取最后一个
+  Set(headers, "Content-Length", "");
+  EXPECT_TRUE(headers.Has(HttpHeaders::HOST));
+  EXPECT_STREQ(headers.Get(HttpHeaders::HOST), "127.0.0.1:12345");
+  EXPECT_EQ(headers.Size(HttpHeaders::HOST), strlen("127.0.0.1:12345"));
+  EXPECT_STREQ(headers.Get("Connection", 10), "keep-alive");
+  EXPECT_STREQ(headers.Get("X-REQUEST-ID", 12), "2");
+  EXPECT_TRUE(headers.Has(HttpHeaders::CONTENT_LENGTH));
+  EXPECT_STREQ(headers.Get("Nope", 4), "");
+  EXPECT_EQ(headers.Count(), 5u);  // 未识别的同名头部不去重
+
+  headers.Clear();
+  arena.Reset();
+  EXPECT_EQ(headers.Count(), 0u);
+  EXPECT_FALSE(headers.Has(HttpHeaders::HOST));
+  EXPECT_STREQ(headers.Get("X-Request-Id", 12), "");
+  Set(headers, "Upgrade", "h2c");
+  EXPECT_STREQ(headers.Get(HttpHeaders::UPGRADE), "h2c");
+}
+
+TEST(TestHttpHeaders, testManyUnknownHeaders) {
+  // 大量未识别的头部: 添加是O(1), 查找取最后一个
+  Arena arena;
+  HttpHeaders headers(&arena);
+  const int kHeaders = 100000;
+  for (int i = 0; i < kHeaders; ++i) {
+    Set(headers, "X-Header-" + std::to_string(i % 1000), std::to_string(i));
+  }
+  EXPECT_EQ(headers.Count(), static_cast<size_t>(kHeaders));
+  EXPECT_STREQ(headers.Get("x-header-7", 10), std::to_string(kHeaders - 1000 + 7).c_str());
+  EXPECT_STREQ(headers.Get("X-Header-1000", 13), "");
+}
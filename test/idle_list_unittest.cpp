@@ -0,0 +1,63 @@
+// =============================================================================
+// Created by yangb on 2021/5/2.
+// =============================================================================
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "gtest/gtest.h"
+#include "../src/server/idle_list.h"
+#include "../src/buffer/buffer.h"
+
+TEST(TestIdleList, testLruOrder) {
+  IdleList idle;
+  EXPECT_EQ(idle.PopOldest(), -1);
+  idle.Add(5, 100);
+  idle.Add(9, 200);
+  idle.Add(7, 300);
+  EXPECT_EQ(idle.Size(), 3u);
+  EXPECT_EQ(idle.Bytes(), 600u);
+
+  idle.Add(5, 50);  // 再次空闲, 移到表尾
+  EXPECT_EQ(idle.Bytes(), 550u);
+  EXPECT_TRUE(idle.Remove(7));   // 收到请求
+  EXPECT_FALSE(idle.Remove(7));
+  EXPECT_FALSE(idle.Remove(100));
+
+  EXPECT_EQ(idle.PopOldest(), 9);
+  EXPECT_EQ(idle.PopOldest(), 5);
+  EXPECT_EQ(idle.PopOldest(), -1);
+  EXPECT_EQ(idle.Size(), 0u);
+  EXPECT_EQ(idle.Bytes(), 0u);
+}
+
+TEST(TestIdleList, testAddArmed) {
+  IdleList idle;
+  std::atomic<bool> armed(false);
+  std::thread evictor;
+  idle.Add(3, 100, [&]() {
+    // 模拟事件循环在重新注册读事件时淘汰: 要等注册完成才能取出
+    evictor = std::thread([&]() {
+      EXPECT_EQ(idle.PopOldest(), 3);
+      EXPECT_TRUE(armed);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    armed = true;
+  });
+  evictor.join();
+  EXPECT_EQ(idle.Size(), 0u);
+}
+
+TEST(TestIdleList, testBufferShrink) {
+  Buffer buff;
+  std::string data(64 * 1024, 'a');
+  buff.Append(data);
+  buff.Retrieve(data.size() - 3);
+  EXPECT_GE(buff.Capacity(), data.size());
+
+  buff.Shrink(Buffer::kMinReadSize);
+  EXPECT_EQ(buff.Capacity(), Buffer::kCheapPrepend + 3 + Buffer::kMinReadSize);
+  EXPECT_EQ(buff.RetrieveAllToStr(), "aaa");
+  buff.Append(data);  // 之后照常扩容
+  EXPECT_EQ(buff.ReadableBytes(), data.size());
+}
@@ -0,0 +1,85 @@
+// =============================================================================
+// Created by yangb on 2021/5/1.
+// =============================================================================
+
+#include <cstdint>
+#include "gtest/gtest.h"
+#include "../src/server/ip_limiter.h"
+
+namespace {
+
+const int64_t kMs = 1000000;  // 1ms, 单位: 纳秒
+
+} // namespace
+
+TEST(TestIpLimiter, testConnCap) {
+  IpLimiter limiter;
+  limiter.Init(2, 0, 1);
+  EXPECT_TRUE(limiter.LimitsConns());
+  EXPECT_FALSE(limiter.LimitsRate());
+
+  EXPECT_TRUE(limiter.AcquireConn(1, 0));
+  EXPECT_TRUE(limiter.AcquireConn(1, 0));
+  EXPECT_FALSE(limiter.AcquireConn(1, 0));  // 达到上限
+  EXPECT_TRUE(limiter.AcquireConn(2, 0));   // 其他IP不受影响
+  limiter.ReleaseConn(1, 0);
+  EXPECT_TRUE(limiter.AcquireConn(1, 0));
+  EXPECT_TRUE(limiter.AllowRequest(1, 0));  // 没有限制请求速率
+}
+
+TEST(TestIpLimiter, testTokenBucket) {
+  IpLimiter limiter;
+  limiter.Init(0, 10, 3);  // 每秒10个, 最多突发3个
+  int64_t now = 1000 * kMs;
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(limiter.AllowRequest(7, now));
+  }
+  EXPECT_FALSE(limiter.AllowRequest(7, now));
+  EXPECT_TRUE(limiter.AllowRequest(8, now));
+  EXPECT_FALSE(limiter.AllowRequest(7, now + 50 * kMs));   // 50ms只补充了半个令牌
+  EXPECT_TRUE(limiter.AllowRequest(7, now + 100 * kMs));
+  EXPECT_FALSE(limiter.AllowRequest(7, now + 100 * kMs));
+  // 长时间不请求, 最多积攒3个
+  now += 10000 * kMs;
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(limiter.AllowRequest(7, now));
+  }
+  EXPECT_FALSE(limiter.AllowRequest(7, now));
+}
+
+TEST(TestIpLimiter, testExpire) {
+  IpLimiter limiter;
+  limiter.Init(4, 10, 1);
+  // 大量只请求一次的IP: 令牌补满后条目过期, 表不会一直增长
+  int64_t now = 0;
+  for (uint32_t ip = 1; ip <= 100000; ++ip) {
+    now += kMs;
+    EXPECT_TRUE(limiter.AllowRequest(ip, now));
+  }
+  EXPECT_LT(limiter.Size(), 10000u);
+
+  // 有连接的条目不会过期
+  EXPECT_TRUE(limiter.AcquireConn(0xdeadbeef, now));
+  for (uint32_t ip = 200000; ip <= 300000; ++ip) {
+    now += kMs;
+    limiter.AllowRequest(ip, now);
+  }
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(limiter.AcquireConn(0xdeadbeef, now));
+  }
+  EXPECT_FALSE(limiter.AcquireConn(0xdeadbeef, now));
+}
+
+TEST(TestIpLimiter, testSubnetProbe) {
+  IpLimiter limiter;
+  limiter.Init(4, 0, 1);
+  // 同一个/16网段的4096个地址(网络字节序: 10.1.x.y, 低16位相同)
+  for (uint32_t x = 0; x < 16; ++x) {
+    for (uint32_t y = 0; y < 256; ++y) {
+      uint32_t ip = (y << 24) | (x << 16) | (1u << 8) | 10u;
+      EXPECT_TRUE(limiter.AcquireConn(ip, 0));
+    }
+  }
+  EXPECT_EQ(limiter.Size(), 4096u);
+  EXPECT_LT(limiter.MaxProbe(), 64u);
+}
@@ -0,0 +1,82 @@
+// =============================================================================
+// Created by yangb on 2021/5/2.
+// =============================================================================
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+#include <string>
+#include "gtest/gtest.h"
+#include "../src/metrics/metrics.h"
+
+namespace {
+
+/// 取出一行样本的值, 没有该样本时返回-1
+double Sample(const std::string& text, const std::string& key) {
+  std::istringstream in(text);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.compare(0, key.size() + 1, key + " ") == 0) {
+      return atof(line.c_str() + key.size() + 1);
+    }
+  }
+  return -1;
+}
+
+} // namespace
+
+TEST(TestMetrics, testRenderFormat) {
+  const int kObservations = 20000000;
+  for (int i = 0; i < kObservations; ++i) {
+    Metrics::Observe(Metrics::RESPONSE_BUILD, 1000000);
+  }
+  Metrics::Instance()->RegisterGauge("webserver_test_gauge_with_a_rather_long_name_for_the_fixed_line_buffer",
+                                     "Gauge registered by the unit test.", [] { return static_cast<int64_t>(-42); });
+  std::string text = Metrics::Instance()->Render();
+  Metrics::Instance()->ClearGauges();
+
+  // 每一行都是完整的注释或样本, 以换行结尾
+  ASSERT_FALSE(text.empty());
+  EXPECT_EQ(text.back(), '\n');
+  std::istringstream in(text);
+  std::string line;
+  while (std::getline(in, line)) {
+    ASSERT_FALSE(line.empty());
+    if (line[0] == '#') {
+      EXPECT_TRUE(line.compare(0, 7, "# HELP ") == 0 || line.compare(0, 7, "# TYPE ") == 0) << line;
+    } else {
+      EXPECT_EQ(line.find('#'), std::string::npos) << line;
+      EXPECT_EQ(std::count(line.begin(), line.end(), ' '), 1) << line;
+    }
+  }
+  EXPECT_GE(Sample(text, "webserver_response_build_seconds_count"), kObservations);
+  EXPECT_EQ(Sample(text, "webserver_response_build_seconds_count"),
+            Sample(text, "webserver_response_build_seconds_bucket{le=\"+Inf\"}"));
+  EXPECT_GE(Sample(text, "webserver_response_build_seconds_sum"), kObservations / 1000.0);
+  EXPECT_EQ(Sample(text, "webserver_test_gauge_with_a_rather_long_name_for_the_fixed_line_buffer"), -42);
+}
+
+TEST(TestMetrics, testObserveBucketUpperBound) {
+  // 桶的上界是le(小于等于): 1.999us不能落在1us的桶中
+  std::string before = Metrics::Instance()->Render();
+  Metrics::Observe(Metrics::SQL_ACQUIRE, 1999);
+  Metrics::Observe(Metrics::SQL_ACQUIRE, 1000);
+  std::string after = Metrics::Instance()->Render();
+  const std::string le1 = "webserver_sql_acquire_seconds_bucket{le=\"1e-06\"}";
+  const std::string le2 = "webserver_sql_acquire_seconds_bucket{le=\"2e-06\"}";
+  EXPECT_EQ(Sample(after, le1) - Sample(before, le1), 1);
+  EXPECT_EQ(Sample(after, le2) - Sample(before, le2), 2);
+}
+
+TEST(TestMetrics, testShardReuse) {
+  // 线程退出后分片由新线程复用, 计数不丢失
+  std::thread([] { Metrics::Add(Metrics::BAD_REQUESTS); }).join();
+  size_t shards = Metrics::Instance()->ShardCount();
+  uint64_t before = Metrics::Instance()->Get(Metrics::BAD_REQUESTS);
+  for (int i = 0; i < 100; ++i) {
+    std::thread([] { Metrics::Add(Metrics::BAD_REQUESTS, 2); }).join();
+  }
+  EXPECT_EQ(Metrics::Instance()->ShardCount(), shards);
+  EXPECT_EQ(Metrics::Instance()->Get(Metrics::BAD_REQUESTS), before + 200);
+}
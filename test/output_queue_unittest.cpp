@@ -0,0 +1,80 @@
+// =============================================================================
+// Created by yangb on 2021/4/29.
+// =============================================================================
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <string>
+#include "gtest/gtest.h"
+#include "../src/buffer/output_queue.h"
+
+namespace {
+
+/// @brief 读出socket中的所有数据
+std::string ReadAll(int fd) {
+  std::string data;
+  char buf[4096];
+  ssize_t len;
+  while ((len = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+    data.append(buf, len);
+  }
+  return data;
+}
+
+} // namespace
+
+TEST(TestOutputQueue, testPeekConsume) {
+  OutputQueue out;
+  auto shared = std::make_shared<std::string>("<body>");
+  out.Owned().Append("HTTP/1.1 200 OK\r\n");
+  out.Append("\r\n", 2);   // 与前面的自有数据合并为一个分段
+  out.AppendShared(shared, shared->data(), shared->size());
+  out.Owned().Append("next");
+  EXPECT_EQ(out.Bytes(), 19u + 6u + 4u);
+
+  struct iovec iov[8];
+  ASSERT_EQ(out.Peek(iov, 8), 3);
+  EXPECT_EQ(std::string(static_cast<char*>(iov[0].iov_base), iov[0].iov_len), "HTTP/1.1 200 OK\r\n\r\n");
+  EXPECT_EQ(iov[1].iov_base, shared->data());
+  EXPECT_EQ(std::string(static_cast<char*>(iov[2].iov_base), iov[2].iov_len), "next");
+
+  // 跨分段前移
+  out.Consume(21);
+  ASSERT_EQ(out.Peek(iov, 8), 2);
+  EXPECT_EQ(std::string(static_cast<char*>(iov[0].iov_base), iov[0].iov_len), "ody>");
+  out.Consume(8);
+  EXPECT_TRUE(out.Empty());
+  EXPECT_EQ(shared.use_count(), 1);  // 发送完后释放共享的数据
+}
+
+TEST(TestOutputQueue, testWriteFd) {
+  int sv[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+
+  char path[] = "/tmp/output_queue_XXXXXX";
+  int file = mkstemp(path);
+  ASSERT_GE(file, 0);
+  unlink(path);
+  const std::string content = "0123456789abcdef";
+  ASSERT_EQ(write(file, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+
+  OutputQueue out;
+  out.Owned().Append("head:");
+  out.AppendFile(file, 4, 8);   // 456789ab
+  out.Append(":tail", 5);
+
+  std::string received;
+  int save_errno = 0;
+  while (!out.Empty()) {
+    ASSERT_GT(out.WriteFd(sv[0], &save_errno), 0) << save_errno;
+    received += ReadAll(sv[1]);
+  }
+  EXPECT_EQ(received, "head:456789ab:tail");
+  EXPECT_FALSE(out.HasFile());
+  EXPECT_EQ(fcntl(file, F_GETFD), -1);  // 文件分段发送完后关闭
+
+  close(sv[0]);
+  close(sv[1]);
+}
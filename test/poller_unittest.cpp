@@ -0,0 +1,149 @@
+// =============================================================================
+// Created by yangb on 2021/4/24.
+// =============================================================================
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../src/server/poller.h"
+#include "../src/server/io_uring_poller.h"
+
+namespace {
+
+const uint32_t kConnEvent = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+
+/// @brief 等待一次, 返回(fd, events)列表
+/// 前一个测试关闭的io_uring在内核中异步退出, 可能打断本线程的epoll_wait(EINTR), 重新等待
+std::vector<std::pair<int, uint32_t>> WaitEvents(Poller* poller, int timeout) {
+  std::vector<std::pair<int, uint32_t>> events;
+  int n;
+  do {
+    n = poller->Wait(timeout);
+  } while (n < 0 && errno == EINTR);
+  for (int i = 0; i < n; ++i) {
+    events.emplace_back(poller->GetEventFd(i), poller->GetEvents(i));
+  }
+  return events;
+}
+
+///
+/// @brief 每个测试在io_uring和epoll两个后端上各跑一遍, 两者的语义应当一致
+///
+class TestPoller : public ::testing::TestWithParam<Poller::Backend> {
+ protected:
+  void SetUp() override {
+    if (GetParam() == Poller::IO_URING) {
+      std::unique_ptr<IoUringPoller> uring = IoUringPoller::Create(16);
+      if (!uring) {
+        GTEST_SKIP() << "io_uring is not available";
+      }
+      poller_ = std::move(uring);
+    } else {
+      poller_ = Poller::Create(Poller::EPOLL, 16);
+    }
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds_), 0);
+  }
+
+  void TearDown() override {
+    poller_.reset();
+    for (int fd : fds_) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+  }
+
+  void Send_(int fd) {
+    ASSERT_EQ(write(fd, "x", 1), 1);
+  }
+
+  std::unique_ptr<Poller> poller_;
+  int fds_[2] = {-1, -1};
+};
+
+} // namespace
+
+TEST_P(TestPoller, testOneshotRearm) {
+  int fd = fds_[0];
+  ASSERT_TRUE(poller_->AddFd(fd, kConnEvent));
+  EXPECT_TRUE(WaitEvents(poller_.get(), 0).empty());
+
+  Send_(fds_[1]);
+  auto events = WaitEvents(poller_.get(), 1000);
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].first, fd);
+  EXPECT_TRUE(events[0].second & EPOLLIN);
+
+  // oneshot: 没有读出数据也不会再触发, 直到ModFd重新注册
+  EXPECT_TRUE(WaitEvents(poller_.get(), 50).empty());
+  ASSERT_TRUE(poller_->ModFd(fd, kConnEvent));
+  events = WaitEvents(poller_.get(), 1000);
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].first, fd);
+  EXPECT_TRUE(events[0].second & EPOLLIN);
+}
+
+TEST_P(TestPoller, testDelThenAddSameFd) {
+  int fd = fds_[0];
+  ASSERT_TRUE(poller_->AddFd(fd, kConnEvent));
+  Send_(fds_[1]);  // 旧连接就绪, 但还没有Wait
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ASSERT_TRUE(poller_->DelFd(fd));
+
+  // 同一个fd号换成一个没有数据的新连接
+  int pair[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+  ASSERT_EQ(dup2(pair[0], fd), fd);
+  close(pair[0]);
+  close(fds_[1]);
+  fds_[1] = pair[1];
+  ASSERT_TRUE(poller_->AddFd(fd, kConnEvent));
+
+  // 旧连接的完成事件必须丢弃, 否则会被当成新连接的读事件
+  EXPECT_TRUE(WaitEvents(poller_.get(), 50).empty());
+  Send_(fds_[1]);
+  auto events = WaitEvents(poller_.get(), 1000);
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].first, fd);
+}
+
+TEST_P(TestPoller, testModFromOtherThread) {
+  int fd = fds_[0];
+  EXPECT_TRUE(WaitEvents(poller_.get(), 0).empty());  // 本线程成为事件循环线程
+  ASSERT_TRUE(poller_->AddFd(fd, kConnEvent));
+  Send_(fds_[1]);
+  ASSERT_EQ(WaitEvents(poller_.get(), 1000).size(), 1u);
+
+  // 工作线程在事件循环阻塞时重新注册, 应当立即提交并唤醒它
+  std::thread worker([this, fd]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_TRUE(poller_->ModFd(fd, kConnEvent));
+  });
+  auto start = std::chrono::steady_clock::now();
+  auto events = WaitEvents(poller_.get(), 5000);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  worker.join();
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].first, fd);
+  EXPECT_LT(elapsed, std::chrono::seconds(2));
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, TestPoller, ::testing::Values(Poller::IO_URING, Poller::EPOLL));
+
+TEST(TestPollerCreate, testFallback) {
+  std::unique_ptr<Poller> poller = Poller::Create(Poller::IO_URING);
+  ASSERT_TRUE(poller);
+  // 内核不支持io_uring时退回epoll
+  if (IoUringPoller::Create()) {
+    EXPECT_STREQ(poller->Name(), "io_uring");
+  } else {
+    EXPECT_STREQ(poller->Name(), "epoll");
+  }
+  EXPECT_STREQ(Poller::Create(Poller::EPOLL)->Name(), "epoll");
+}
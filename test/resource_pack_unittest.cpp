@@ -0,0 +1,70 @@
+// =============================================================================
+// Created by yangb on 2021/5/2.
+// =============================================================================
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "gtest/gtest.h"
+#include "../src/http/resource_pack.h"
+
+namespace {
+
+void WriteFile(const std::string& path, const std::string& data) {
+  FILE* fp = fopen(path.c_str(), "wb");
+  ASSERT_NE(fp, nullptr);
+  fwrite(data.data(), 1, data.size(), fp);
+  fclose(fp);
+  chmod(path.c_str(), 0644);
+}
+
+} // namespace
+
+TEST(TestResourcePack, testFindAndPackFile) {
+  char tmpl[] = "/tmp/resource_pack_XXXXXX";
+  ASSERT_NE(mkdtemp(tmpl), nullptr);
+  std::string root = std::string(tmpl) + "/";
+  mkdir((root + "css").c_str(), 0755);
+  const int kFiles = 500;
+  for (int i = 0; i < kFiles; ++i) {
+    WriteFile(root + "css/" + std::to_string(i) + ".css", "body{} /* " + std::to_string(i) + " */");
+  }
+  WriteFile(root + "index.html", "<html>hello</html>");
+  WriteFile(root + "big.jpg", std::string(4096, 'x'));
+  std::string pack_file = root + "pack.bin";
+
+  ResourcePack* pack = ResourcePack::Instance();
+  for (int round = 0; round < 2; ++round) {  // 第一次生成并保存, 第二次mmap已有的包文件
+    ASSERT_TRUE(pack->Init(root, pack_file.c_str(), 1024));
+    EXPECT_EQ(pack->Count(), static_cast<size_t>(kFiles + 1));  // big.jpg超过max_file
+
+    ResourcePack::File file{};
+    for (int i = 0; i < kFiles; ++i) {
+      ASSERT_TRUE(pack->Find("/css/" + std::to_string(i) + ".css", false, &file));
+      EXPECT_EQ(std::string(file.body, file.body_len), "body{} /* " + std::to_string(i) + " */");
+    }
+    ASSERT_TRUE(pack->Find("/index.html", true, &file));
+    std::string head(file.head, file.head_len);
+    EXPECT_NE(head.find("Content-Type: text/html\r\n"), std::string::npos);
+    EXPECT_NE(head.find("Content-Length:" + std::to_string(file.body_len) + "\r\n\r\n"), std::string::npos);
+    std::string if_none_match = "W/\"other\", " + std::string(file.etag, file.etag_len);
+    EXPECT_TRUE(ResourcePack::EtagMatches(if_none_match.c_str(), file));
+    EXPECT_FALSE(ResourcePack::EtagMatches("\"other\"", file));
+    EXPECT_FALSE(pack->Find("/big.jpg", false, &file));
+    EXPECT_FALSE(pack->Find("/missing.html", false, &file));
+  }
+  pack->Clear();
+  EXPECT_FALSE(pack->IsLoaded());
+  std::string cmd = "rm -rf " + std::string(tmpl);
+  EXPECT_EQ(system(cmd.c_str()), 0);
+}
+
+TEST(TestResourcePack, testAcceptsGzip) {
+  EXPECT_TRUE(ResourcePack::AcceptsGzip("gzip, deflate, br"));
+  EXPECT_TRUE(ResourcePack::AcceptsGzip("deflate, gzip;q=0.5"));
+  EXPECT_FALSE(ResourcePack::AcceptsGzip("gzip;q=0, deflate"));
+  EXPECT_FALSE(ResourcePack::AcceptsGzip("gzip;q=0.000"));
+  EXPECT_FALSE(ResourcePack::AcceptsGzip(""));
+}
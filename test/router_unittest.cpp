@@ -0,0 +1,49 @@
+// =============================================================================
+// Created by yangb on 2021/4/27.
+// =============================================================================
+
+#include "gtest/gtest.h"
+#include "../src/http/router.h"
+
+namespace {
+
+/// 返回匹配到的路由的file, 没有匹配时返回"<none>"
+std::string MatchFile(const Router& router, Router::Method method, const std::string& path) {
+  const Router::Route* route = router.Match(method, path);
+  return route ? route->file : "<none>";
+}
+
+} // namespace
+
+TEST(TestRouter, testMatch) {
+  Router* router = Router::Instance();
+  router->Clear();
+  EXPECT_EQ(MatchFile(*router, Router::GET, "/"), "<none>");
+
+  router->AddFile(Router::ANY, "/**", "static");
+  router->AddFile(Router::ANY, "/", "/index.html");
+  router->AddFile(Router::GET, "/login", "/login.html");
+  router->AddFile(Router::GET, "/images/**", "images");
+  router->AddFile(Router::GET, "/user/*/avatar", "avatar");
+  router->AddFile(Router::GET, "/user/admin/avatar", "admin");
+
+  EXPECT_EQ(MatchFile(*router, Router::GET, "/"), "/index.html");
+  EXPECT_EQ(MatchFile(*router, Router::GET, "/login"), "/login.html");
+  EXPECT_EQ(MatchFile(*router, Router::POST, "/login"), "static");  // 只注册了GET
+  EXPECT_EQ(MatchFile(*router, Router::GET, "/login/x"), "static");
+  EXPECT_EQ(MatchFile(*router, Router::GET, "/images"), "images");
+  EXPECT_EQ(MatchFile(*router, Router::GET, "/images/a/b.jpg"), "images");
+  EXPECT_EQ(MatchFile(*router, Router::GET, "/user/bob/avatar"), "avatar");
+  EXPECT_EQ(MatchFile(*router, Router::GET, "/user/admin/avatar"), "admin");
+  EXPECT_EQ(MatchFile(*router, Router::GET, "/user/bob/profile"), "static");
+  EXPECT_EQ(MatchFile(*router, Router::OTHER, "/css/style.css"), "static");
+  router->Clear();
+}
+
+TEST(TestRouter, testContentType) {
+  EXPECT_STREQ(Router::ContentType("/index.html"), "text/html");
+  EXPECT_STREQ(Router::ContentType("/images/a.jpeg"), "image/jpeg");
+  EXPECT_STREQ(Router::ContentType("/js/main.js"), "text/javascript");
+  EXPECT_STREQ(Router::ContentType("/v1.2/readme"), "text/plain");  // 目录中的'.'不算扩展名
+  EXPECT_STREQ(Router::ContentType("/noext"), "text/plain");
+}
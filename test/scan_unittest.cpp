@@ -0,0 +1,82 @@
+// =============================================================================
+// Created by yangb on 2021/4/28.
+// =============================================================================
+
+#include <random>
+#include "gtest/gtest.h"
+#include "../src/http/scan.h"
+
+namespace {
+
+const Scan::Kernel kKernels[] = {Scan::SCALAR, Scan::SSE42, Scan::AVX2};
+
+size_t FindCRLF(const std::string& str) {
+  return Scan::FindCRLF(str.data(), str.data() + str.size()) - str.data();
+}
+
+size_t FindHeaderEnd(const std::string& str) {
+  return Scan::FindHeaderEnd(str.data(), str.data() + str.size()) - str.data();
+}
+
+std::string UrlDecode(const std::string& str) {
+  return Scan::UrlDecode(str.data(), str.data() + str.size());
+}
+
+} // namespace
+
+TEST(TestScan, testFind) {
+  Scan::Kernel current = Scan::Current();
+  for (Scan::Kernel kernel : kKernels) {
+    if (!Scan::Use(kernel)) {
+      continue;
+    }
+    SCOPED_TRACE(Scan::Name(kernel));
+    // \r\n落在向量的边界上或跨过边界
+    for (size_t pos : {0, 1, 14, 15, 16, 30, 31, 32, 33, 63, 64, 100}) {
+      std::string str(pos, 'a');
+      str += "\r\n";
+      str += std::string(40, 'b');
+      EXPECT_EQ(FindCRLF(str), pos);
+      EXPECT_EQ(FindHeaderEnd(str), str.size());
+      str.insert(pos + 2, "\r\n");
+      EXPECT_EQ(FindHeaderEnd(str), pos);
+    }
+    EXPECT_EQ(FindCRLF(std::string(40, 'a') + "\r"), 41u);  // 结尾只有\r
+    EXPECT_EQ(FindCRLF(std::string(40, '\r') + "\n"), 39u);
+    EXPECT_EQ(FindHeaderEnd(std::string(40, 'a') + "\r\n\r"), 43u);
+    EXPECT_EQ(FindHeaderEnd("\r\n\r\r\n\r\n"), 3u);
+    EXPECT_EQ(FindHeaderEnd(""), 0u);
+  }
+  Scan::Use(current);
+}
+
+TEST(TestScan, testUrlDecode) {
+  Scan::Kernel current = Scan::Current();
+  std::mt19937 rng(2021);
+  const char kAlphabet[] = "ab%+2F0e";
+  for (Scan::Kernel kernel : kKernels) {
+    if (!Scan::Use(kernel)) {
+      continue;
+    }
+    SCOPED_TRACE(Scan::Name(kernel));
+    EXPECT_EQ(UrlDecode("a+b%20c"), "a b c");
+    EXPECT_EQ(UrlDecode("%E4%BD%A0%e5%a5%bd"), "\xE4\xBD\xA0\xE5\xA5\xBD");
+    EXPECT_EQ(UrlDecode("100%"), "100%");       // 不完整的转义原样保留
+    EXPECT_EQ(UrlDecode("%zz%4"), "%zz%4");
+    EXPECT_EQ(UrlDecode(std::string(31, 'x') + "%41" + std::string(40, 'y')),
+              std::string(31, 'x') + "A" + std::string(40, 'y'));
+
+    // 与标量实现的结果一致
+    for (int i = 0; i < 200; ++i) {
+      std::string str(rng() % 100, ' ');
+      for (char& ch : str) {
+        ch = kAlphabet[rng() % (sizeof(kAlphabet) - 1)];
+      }
+      std::string decoded = UrlDecode(str);
+      Scan::Use(Scan::SCALAR);
+      EXPECT_EQ(decoded, UrlDecode(str)) << str;
+      Scan::Use(kernel);
+    }
+  }
+  Scan::Use(current);
+}
@@ -0,0 +1,141 @@
+// =============================================================================
+// Created by yangb on 2021/4/30.
+// =============================================================================
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "gtest/gtest.h"
+#include "../src/pool/thread_pool.h"
+
+namespace {
+
+/// @brief 等待cond成立, 最多timeout_ms毫秒
+template <typename Cond>
+bool WaitFor(Cond cond, int timeout_ms = 2000) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  while (!cond()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+} // namespace
+
+TEST(TestThreadPool, testGrowShrink) {
+  ThreadPool::Options options;
+  options.min_threads = 1;
+  options.max_threads = 3;
+  options.grow_wait_us = 1000;
+  options.idle_timeout_ms = 50;
+  ThreadPool pool(options);
+  EXPECT_EQ(pool.ThreadCount(), 1u);
+
+  // 阻塞的任务占满线程后, 排队超过grow_wait_us的任务触发扩容, 但不超过max_threads
+  std::mutex mtx;
+  std::condition_variable cond;
+  bool release = false;
+  std::atomic<int> started{0};
+  auto blocking = [&] {
+    ++started;
+    std::unique_lock<std::mutex> locker(mtx);
+    cond.wait(locker, [&] { return release; });
+  };
+  for (int i = 0; i < 6; ++i) {
+    pool.AddTask(blocking);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_TRUE(WaitFor([&] { return started == 3; }));
+  EXPECT_EQ(pool.ThreadCount(), 3u);
+  EXPECT_EQ(pool.ActiveCount(), 3u);
+  EXPECT_EQ(pool.QueueSize(), 3u);
+
+  {
+    std::lock_guard<std::mutex> locker(mtx);
+    release = true;
+  }
+  cond.notify_all();
+  // 空闲后缩容到min_threads
+  EXPECT_TRUE(WaitFor([&] { return pool.ThreadCount() == 1; }));
+  EXPECT_EQ(started, 6);
+  EXPECT_EQ(pool.ActiveCount(), 0u);
+}
+
+TEST(TestThreadPool, testShutdownJoins) {
+  std::atomic<int> done{0};
+  {
+    ThreadPool pool(2);
+    for (int i = 0; i < 100; ++i) {
+      pool.AddTask([&] {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        ++done;
+      });
+    }
+  } // 析构时执行完剩余的任务并等待线程退出
+  EXPECT_EQ(done, 100);
+
+  ThreadPool moved(1);
+  ThreadPool pool(std::move(moved));  // 被移走的对象析构时不访问空的状态
+  pool.AddTask([&] { ++done; });
+}
+
+TEST(TestThreadPool, testSubmitAfterShutdown) {
+  std::atomic<int> done{0};
+  ThreadPool first(1);
+  ThreadPool second(1);
+  // 两个线程池的任务互相提交: 先关闭first, second中的任务再提交给first时被拒绝, 不会访问已退出的线程
+  first.AddTask([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_TRUE(second.TryAddTask([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      EXPECT_FALSE(first.TryAddTask([&] { ++done; }));
+      ++done;
+    }));
+    ++done;
+  });
+  first.Shutdown();
+  second.Shutdown();
+  EXPECT_EQ(done, 2);
+  EXPECT_FALSE(second.TryAddTask([&] { ++done; }));
+  first.Shutdown();  // 可以重复调用
+  EXPECT_EQ(first.ThreadCount(), 0u);
+}
+
+TEST(TestThreadPool, testCodelShed) {
+  ThreadPool::Options options;
+  options.min_threads = 1;
+  options.max_threads = 1;
+  options.codel_target_us = 1000;
+  options.codel_interval_us = 5000;
+  ThreadPool pool(options);
+
+  // 第一个任务阻塞30ms, 后面的任务排队时间都超过目标; 持续超过观察窗口后, 可丢弃的任务改为执行on_shed
+  std::atomic<int> ran{0}, shed{0};
+  std::atomic<bool> plain_ran{false};
+  pool.AddTask([] { std::this_thread::sleep_for(std::chrono::milliseconds(30)); });
+  for (int i = 0; i < 10; ++i) {
+    pool.AddTask([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      ++ran;
+    }, [&] { ++shed; });
+    if (i == 7) {
+      pool.AddTask([&] { plain_ran = true; });  // 不能丢弃的任务总是执行
+    }
+  }
+  EXPECT_TRUE(WaitFor([&] { return ran + shed == 10 && pool.QueueSize() == 0; }));
+  EXPECT_GT(shed, 0);
+  EXPECT_GT(ran, 0);
+  EXPECT_TRUE(WaitFor([&] { return plain_ran.load(); }));
+  EXPECT_FALSE(pool.IsOverloaded());  // 队列取空后退出过载状态
+
+  // 不过载时不丢弃
+  shed = 0;
+  pool.AddTask([] {}, [&] { ++shed; });
+  EXPECT_TRUE(WaitFor([&] { return pool.QueueSize() == 0 && pool.ActiveCount() == 0; }));
+  EXPECT_EQ(shed, 0);
+}